@@ -69,7 +69,7 @@ const int sector_offset[36] = {
  *   emulation is enabled
  */
 
-Job1541::Job1541(uint8 *ram1541) : ram(ram1541)
+Job1541::Job1541(Prefs *prefs, uint8 *ram1541) : the_prefs(prefs), ram(ram1541)
 {
 	the_file = NULL;
 
@@ -79,8 +79,8 @@ Job1541::Job1541(uint8 *ram1541) : ram(ram1541)
 
 	disk_changed = true;
 
-	if (ThePrefs.Emul1541Proc)
-		open_d64_file(ThePrefs.DrivePath[0]);
+	if (the_prefs->Emul1541Proc)
+		open_d64_file(the_prefs->DrivePath[0]);
 }
 
 
@@ -106,11 +106,11 @@ void Job1541::NewPrefs(Prefs *prefs)
 		close_d64_file();
 
 	// 1541 emulation turned on?
-	else if (!ThePrefs.Emul1541Proc && prefs->Emul1541Proc)
+	else if (!the_prefs->Emul1541Proc && prefs->Emul1541Proc)
 		open_d64_file(prefs->DrivePath[0]);
 
 	// .d64 file name changed?
-	else if (strcmp(ThePrefs.DrivePath[0], prefs->DrivePath[0])) {
+	else if (strcmp(the_prefs->DrivePath[0], prefs->DrivePath[0])) {
 		close_d64_file();
 		open_d64_file(prefs->DrivePath[0]);
 		disk_changed = true;
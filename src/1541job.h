@@ -14,7 +14,7 @@ struct Job1541State;
 
 class Job1541 {
 public:
-	Job1541(uint8 *ram1541);
+	Job1541(Prefs *prefs, uint8 *ram1541);
 	~Job1541();
 
 	void GetState(Job1541State *state);
@@ -40,6 +40,7 @@ private:
 	void sector2gcr(int track, int sector);
 	void disk2gcr(void);
 
+	Prefs *the_prefs;		// Pointer to active preferences
 	uint8 *ram;				// Pointer to 1541 RAM
 	FILE *the_file;			// File pointer for .d64 file
 	int image_header;		// Length of .d64/.x64 file header
@@ -709,7 +709,7 @@ uint8 T64Drive::conv_from_64(uint8 c, bool map_slash)
 		return c ^ 0x20;
 	if ((c >= 0xc1) && (c <= 0xda))
 		return c ^ 0x80;
-	if ((c == '/') && map_slash && ThePrefs.MapSlash)
+	if ((c == '/') && map_slash && the_prefs->MapSlash)
 		return '\\';
 	return c;
 }
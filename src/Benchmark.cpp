@@ -0,0 +1,494 @@
+/*
+ *  Benchmark.cpp - Benchmark suite of reproducible workloads
+ *
+ *  Frodo (C) 1994-1997,2002 Christian Bauer
+ *
+ *  A suite file lists one workload per line:
+ *
+ *    <name> <frames> <source>
+ *
+ *  source is either "builtin:<program>" or the path of a snapshot file
+ *  (relative to the suite file). Every workload runs on a fresh headless
+ *  C64 with default preferences. One CSV line with the timings per
+ *  subsystem is written to the report for each workload.
+ */
+
+#include "sysdeps.h"
+
+#include "Benchmark.h"
+#include "C64.h"
+#include "CPUC64.h"
+#include "VIC.h"
+#include "Prefs.h"
+
+#ifdef WIN32
+#include <process.h>
+#define getpid _getpid
+#endif
+
+
+// Frames to run after power-on before a builtin program is started
+static const uint32 BOOT_FRAMES = 150;
+
+// Disk image used by the drive workload, in the temporary directory
+// and named after the process so parallel suite runs don't share it
+static const char* DISK_IMAGE_NAME = "frodo_bench_%d.d64";
+
+
+/*
+ *  Builtin workloads, started with SYS49152 from the BASIC prompt
+ */
+
+// Change border and background color on every raster line
+static const uint8 prg_raster_split[] = {
+	0x78, 0xad, 0x12, 0xd0, 0x8d, 0x20, 0xd0, 0x8d,
+	0x21, 0xd0, 0x4c, 0x01, 0xc0
+};
+
+// 8 expanded multicolor sprites reused in 4 raster bands, moving and colliding
+static const uint8 prg_sprite_mux[] = {
+	0x78, 0xa9, 0xff, 0x8d, 0x15, 0xd0, 0x8d, 0x1c,
+	0xd0, 0x8d, 0x1d, 0xd0, 0x8d, 0x17, 0xd0, 0xa2,
+	0x3f, 0x9d, 0x40, 0x03, 0xca, 0x10, 0xfa, 0xa2,
+	0x07, 0xa9, 0x0d, 0x9d, 0xf8, 0x07, 0xca, 0x10,
+	0xfa, 0xa2, 0x0e, 0xa9, 0x90, 0x9d, 0x00, 0xd0,
+	0xca, 0xca, 0x10, 0xf9, 0xa2, 0x00, 0xbd, 0x6a,
+	0xc0, 0xcd, 0x12, 0xd0, 0xd0, 0xfb, 0x18, 0x69,
+	0x03, 0x8d, 0x01, 0xd0, 0x8d, 0x03, 0xd0, 0x8d,
+	0x05, 0xd0, 0x8d, 0x07, 0xd0, 0x8d, 0x09, 0xd0,
+	0x8d, 0x0b, 0xd0, 0x8d, 0x0d, 0xd0, 0x8d, 0x0f,
+	0xd0, 0xee, 0x00, 0xd0, 0xee, 0x04, 0xd0, 0xee,
+	0x08, 0xd0, 0xee, 0x0c, 0xd0, 0xad, 0x1e, 0xd0,
+	0xad, 0x1f, 0xd0, 0xe8, 0xe0, 0x04, 0xd0, 0xc6,
+	0xf0, 0xc2, 0x30, 0x60, 0x90, 0xc0
+};
+
+// All 3 voices playing through the filter, registers rewritten every frame
+static const uint8 prg_sid_music[] = {
+	0x78, 0xa9, 0x1f, 0x8d, 0x18, 0xd4, 0xa9, 0xf7,
+	0x8d, 0x17, 0xd4, 0xa9, 0x09, 0x8d, 0x05, 0xd4,
+	0x8d, 0x0c, 0xd4, 0x8d, 0x13, 0xd4, 0xa9, 0xf0,
+	0x8d, 0x06, 0xd4, 0x8d, 0x0d, 0xd4, 0x8d, 0x14,
+	0xd4, 0xa9, 0x08, 0x8d, 0x03, 0xd4, 0x8d, 0x0a,
+	0xd4, 0xa9, 0x80, 0xcd, 0x12, 0xd0, 0xd0, 0xfb,
+	0xe6, 0xfb, 0xa5, 0xfb, 0x8d, 0x01, 0xd4, 0x8d,
+	0x16, 0xd4, 0x8d, 0x02, 0xd4, 0x8d, 0x09, 0xd4,
+	0x0a, 0x8d, 0x08, 0xd4, 0x4a, 0x4a, 0x8d, 0x0f,
+	0xd4, 0xa5, 0xfb, 0x29, 0x70, 0x09, 0x01, 0x8d,
+	0x04, 0xd4, 0xa5, 0xfb, 0x29, 0x08, 0x09, 0x40,
+	0x8d, 0x0b, 0xd4, 0xa9, 0x81, 0x8d, 0x12, 0xd4,
+	0xa9, 0x81, 0xcd, 0x12, 0xd0, 0xd0, 0xfb, 0x4c,
+	0x29, 0xc0
+};
+
+// Multicolor bitmap screen, background color changed every frame
+static const uint8 prg_mc_bitmap[] = {
+	0x78, 0xa9, 0x3b, 0x8d, 0x11, 0xd0, 0xa9, 0x18,
+	0x8d, 0x16, 0xd0, 0x8d, 0x18, 0xd0, 0xa2, 0x00,
+	0x8a, 0x9d, 0x00, 0x04, 0x9d, 0x00, 0x05, 0x9d,
+	0x00, 0x06, 0x9d, 0x00, 0x07, 0x9d, 0x00, 0xd8,
+	0x9d, 0x00, 0xd9, 0x9d, 0x00, 0xda, 0x9d, 0x00,
+	0xdb, 0xe8, 0xd0, 0xe4, 0xa9, 0x20, 0x85, 0xfc,
+	0xa0, 0x00, 0x84, 0xfb, 0x98, 0x45, 0xfc, 0x91,
+	0xfb, 0xc8, 0xd0, 0xf8, 0xe6, 0xfc, 0xa5, 0xfc,
+	0xc9, 0x40, 0xd0, 0xf0, 0xad, 0x12, 0xd0, 0xd0,
+	0xfb, 0xee, 0x21, 0xd0, 0xad, 0x12, 0xd0, 0xf0,
+	0xfb, 0x4c, 0x44, 0xc0
+};
+
+typedef struct
+{
+    const char* name;
+    const uint8* code;      // Machine code at $c000 (NULL: none)
+    int code_size;
+    const char* keys;       // Typed at the BASIC prompt (max. 10 chars)
+    bool drive;             // Needs processor-level 1541 with disk image
+} builtin_t;
+
+static const builtin_t builtins[] =
+{
+    { "basic",   NULL,             0,                        "",             false },
+    { "raster",  prg_raster_split, sizeof(prg_raster_split), "SYS49152\r",   false },
+    { "sprites", prg_sprite_mux,   sizeof(prg_sprite_mux),   "SYS49152\r",   false },
+    { "sid",     prg_sid_music,    sizeof(prg_sid_music),    "SYS49152\r",   false },
+    { "bitmap",  prg_mc_bitmap,    sizeof(prg_mc_bitmap),    "SYS49152\r",   false },
+    { "drive",   NULL,             0,                        "LOAD\"*\",8\r", true  },
+    { NULL,      NULL,             0,                        NULL,           false }
+};
+
+static const builtin_t* find_builtin(const std::string& name)
+{
+    for (const builtin_t* b = builtins; b->name != NULL; b++)
+    {
+        if (name == b->name)
+        {
+            return b;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ *  Constructor/destructor
+ */
+
+BenchmarkSuite::BenchmarkSuite()
+{
+    const char* dir = getenv("TMPDIR");
+    #ifdef WIN32
+        if (NULL == dir)
+        {
+            dir = getenv("TEMP");
+        }
+    #endif
+    if (NULL == dir || 0 == dir[0])
+    {
+        #ifdef WIN32
+            dir = ".";
+        #else
+            dir = "/tmp";
+        #endif
+    }
+
+    char name[32];
+    sprintf(name, DISK_IMAGE_NAME, (int) getpid());
+    diskImage = std::string(dir) + "/" + name;
+}
+
+BenchmarkSuite::~BenchmarkSuite()
+{
+}
+
+
+/*
+ *  Read suite file
+ */
+
+bool BenchmarkSuite::load(const char* filename)
+{
+    FILE* f = fopen(filename, "r");
+    if (NULL == f)
+    {
+        fprintf(stderr, "Can't open benchmark suite %s\n", filename);
+        return false;
+    }
+
+    // Snapshot paths are relative to the suite file
+    std::string dir = filename;
+    size_t slash = dir.find_last_of("/\\");
+    dir = (slash == std::string::npos) ? "" : dir.substr(0, slash + 1);
+
+    char line[512];
+    int lineNumber = 0;
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        lineNumber++;
+
+        char name[64], source[256];
+        unsigned int frames;
+
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0)
+        {
+            continue;
+        }
+
+        if (sscanf(p, "%63s %u %255s", name, &frames, source) != 3 || 0 == frames)
+        {
+            fprintf(stderr, "%s:%d: syntax error\n", filename, lineNumber);
+            fclose(f);
+            return false;
+        }
+
+        workload_t workload;
+        workload.name = name;
+        workload.frames = frames;
+        workload.source = source;
+
+        if (0 != workload.source.compare(0, 8, "builtin:") && source[0] != '/')
+        {
+            workload.source = dir + workload.source;
+        }
+
+        workloads.push_back(workload);
+    }
+
+    fclose(f);
+
+    return true;
+}
+
+
+/*
+ *  Run all workloads, write CSV report
+ */
+
+bool BenchmarkSuite::run(FILE* report)
+{
+    fprintf(report, "workload,core,frames,seconds,fps,cycles_per_sec,ns_per_line");
+    for (int i=0; i<Profiler::SECTION_COUNT; i++)
+    {
+        if (Profiler::hasSection(i))
+        {
+            fprintf(report, ",%s_us_per_frame", Profiler::getName(i));
+        }
+    }
+    fprintf(report, ",other_us_per_frame\n");
+
+    bool ok = true;
+
+    for (size_t i=0; i<workloads.size(); i++)
+    {
+        if (!runWorkload(workloads[i], report))
+        {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+bool BenchmarkSuite::runWorkload(const workload_t& workload, FILE* report)
+{
+    bool builtin = (0 == workload.source.compare(0, 8, "builtin:"));
+    std::string builtinName = builtin ? workload.source.substr(8) : "";
+
+    fprintf(stderr, "Benchmark: %s (%s, %u frames)\n", workload.name.c_str(), workload.source.c_str(), workload.frames);
+
+    C64* c64 = new C64;
+
+    bool ok = true;
+
+    if (builtin)
+    {
+        ok = setupBuiltin(c64, builtinName, false);
+    }
+
+    if (ok)
+    {
+        ok = c64->init(true);
+    }
+
+    if (ok)
+    {
+        if (builtin)
+        {
+            c64->runFrames(BOOT_FRAMES);
+            ok = setupBuiltin(c64, builtinName, true);
+        }
+        else if (!c64->LoadSnapshot(workload.source.c_str()))
+        {
+            fprintf(stderr, "Couldn't load snapshot %s\n", workload.source.c_str());
+            ok = false;
+        }
+    }
+
+    if (ok)
+    {
+        c64->profiler.enable(true);
+
+        uint64 startTime = host_time_ns();
+        c64->runFrames(workload.frames);
+        uint64 elapsed = host_time_ns() - startTime;
+
+        double seconds = (double) elapsed / 1.0e9;
+        double lines = (double) workload.frames * TOTAL_RASTERS;
+
+        #ifdef FRODO_SC
+            const char* core = "sc";
+        #else
+            const char* core = "pc";
+        #endif
+
+        fprintf(report, "%s,%s,%u,%.6f,%.1f,%.0f,%.1f",
+            workload.name.c_str(), core, workload.frames, seconds,
+            workload.frames / seconds, lines * CYCLES_PER_LINE / seconds,
+            (double) elapsed / lines);
+
+        uint64 accounted = 0;
+        for (int i=0; i<Profiler::SECTION_COUNT; i++)
+        {
+            if (Profiler::hasSection(i))
+            {
+                accounted += c64->profiler.getTime(i);
+                fprintf(report, ",%.2f", c64->profiler.getTime(i) / 1000.0 / workload.frames);
+            }
+        }
+        fprintf(report, ",%.2f\n", (elapsed - accounted) / 1000.0 / workload.frames);
+        fflush(report);
+    }
+
+    delete c64;
+
+    if (builtin && find_builtin(builtinName) != NULL && find_builtin(builtinName)->drive)
+    {
+        remove(diskImage.c_str());
+    }
+
+    return ok;
+}
+
+
+/*
+ *  Prepare a builtin workload: set preferences before the C64 is
+ *  started, load the program and type the start command after boot
+ */
+
+bool BenchmarkSuite::setupBuiltin(C64* c64, const std::string& name, bool after_boot)
+{
+    const builtin_t* b = find_builtin(name);
+    if (NULL == b)
+    {
+        fprintf(stderr, "Unknown builtin workload %s\n", name.c_str());
+        return false;
+    }
+
+    if (!after_boot)
+    {
+        if (b->drive)
+        {
+            if (!writeDiskImage(diskImage.c_str()))
+            {
+                return false;
+            }
+
+            c64->ThePrefs.Emul1541Proc = true;
+            c64->ThePrefs.DriveType[0] = DRVTYPE_D64;
+            strncpy(c64->ThePrefs.DrivePath[0], diskImage.c_str(), 255);
+        }
+
+        return true;
+    }
+
+    if (NULL != b->code)
+    {
+        memcpy(c64->RAM + 0xc000, b->code, b->code_size);
+        #if BLOCK_CACHE
+            c64->TheCPU->FlushBlockCache();
+        #endif
+    }
+
+    // Fill keyboard buffer
+    int len = strlen(b->keys);
+    memcpy(c64->RAM + 0x0277, b->keys, len);
+    c64->RAM[0xc6] = len;
+
+    return true;
+}
+
+
+/*
+ *  Write a .d64 image with one 80 block program file for the drive workload
+ */
+
+static int sectors_per_track(int track)
+{
+    if (track <= 17) return 21;
+    if (track <= 24) return 19;
+    if (track <= 30) return 18;
+    return 17;
+}
+
+static int d64_offset(int track, int sector)
+{
+    int offset = 0;
+    for (int t=1; t<track; t++)
+    {
+        offset += sectors_per_track(t);
+    }
+
+    return (offset + sector) * 256;
+}
+
+bool BenchmarkSuite::writeDiskImage(const char* filename)
+{
+    const int image_size = 174848;
+    const int file_blocks = 80;
+    const int interleave = 10;
+
+    uint8* image = new uint8[image_size];
+    memset(image, 0, image_size);
+
+    // BAM (contents don't matter for loading)
+    uint8* bam = image + d64_offset(18, 0);
+    bam[0] = 18;
+    bam[1] = 1;
+    bam[2] = 0x41;
+    memset(bam + 0x90, 0xa0, 0x1b);
+    memcpy(bam + 0x90, "FRODO BENCH", 11);
+    memcpy(bam + 0xa2, "FB", 2);
+    memcpy(bam + 0xa5, "2A", 2);
+
+    // Directory with one PRG file starting at track 1, sector 0
+    uint8* dir = image + d64_offset(18, 1);
+    dir[0] = 0;
+    dir[1] = 0xff;
+    dir[2] = 0x82;
+    dir[3] = 1;
+    dir[4] = 0;
+    memset(dir + 5, 0xa0, 16);
+    memcpy(dir + 5, "BENCH", 5);
+    dir[0x1e] = file_blocks & 0xff;
+    dir[0x1f] = file_blocks >> 8;
+
+    // File blocks, linked with the usual sector interleave
+    int track = 1, sector = 0, step = 0;
+    for (int block=0; block<file_blocks; block++)
+    {
+        uint8* data = image + d64_offset(track, sector);
+
+        int next_track = track, next_sector;
+        step++;
+        if (step >= sectors_per_track(track))
+        {
+            next_track++;
+            step = 0;
+        }
+        next_sector = (step * interleave) % sectors_per_track(next_track);
+
+        if (block == file_blocks - 1)
+        {
+            data[0] = 0;
+            data[1] = 0xff;
+        }
+        else
+        {
+            data[0] = next_track;
+            data[1] = next_sector;
+        }
+
+        for (int i=2; i<256; i++)
+        {
+            data[i] = (uint8) (block + i);
+        }
+
+        if (0 == block)
+        {
+            data[2] = 0x01;     // Load address $0801
+            data[3] = 0x08;
+        }
+
+        track = next_track;
+        sector = next_sector;
+    }
+
+    FILE* f = fopen(filename, "wb");
+    bool ok = (NULL != f) && (fwrite(image, 1, image_size, f) == (size_t) image_size);
+    if (NULL != f)
+    {
+        fclose(f);
+    }
+
+    delete[] image;
+
+    if (!ok)
+    {
+        fprintf(stderr, "Can't write disk image %s\n", filename);
+    }
+
+    return ok;
+}
@@ -0,0 +1,42 @@
+/*
+ *  Benchmark.h - Benchmark suite of reproducible workloads
+ *
+ *  Frodo (C) 1994-1997,2002 Christian Bauer
+ */
+
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+#include <vector>
+#include <string>
+
+class C64;
+
+class BenchmarkSuite
+{
+    private:
+        typedef struct
+        {
+            std::string name;       // Workload name, first column of the report
+            std::string source;     // "builtin:<name>" or snapshot file
+            uint32 frames;          // Number of timed frames
+        } workload_t;
+
+        std::vector<workload_t> workloads;
+        std::string diskImage;      // Disk image of the drive workloads
+
+    public:
+        BenchmarkSuite();
+        ~BenchmarkSuite();
+
+    public:
+        bool load(const char* filename);
+        bool run(FILE* report);
+
+    private:
+        bool runWorkload(const workload_t& workload, FILE* report);
+        bool setupBuiltin(C64* c64, const std::string& name, bool after_boot);
+        bool writeDiskImage(const char* filename);
+};
+
+#endif /* _BENCHMARK_H */
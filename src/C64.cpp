@@ -32,7 +32,7 @@ bool IsFrodoSC = true;
 bool IsFrodoSC = false;
 #endif
 
-#define FRAME_INTERVAL		(1000/SCREEN_FREQ)	// in milliseconds
+#define FRAME_NS			((uint64)TOTAL_RASTERS*CYCLES_PER_LINE*1000000000/985248)	// PAL frame duration in nanoseconds
 #ifdef FRODO_SC
 #define SPEEDOMETER_INTERVAL	4000			// in milliseconds
 #else
@@ -44,12 +44,41 @@ bool IsFrodoSC = false;
 #define JOYSTICK_RANGE		(JOYSTICK_MAX - JOYSTICK_MIN)
 
 
+// ROM images, loaded once and shared by all C64 instances. Basic and Char
+// are used directly, Kernal and 1541 ROM are copied because they get patched.
+struct ROMImages
+{
+	uint8 Basic[0x2000];
+	uint8 Kernal[0x2000];
+	uint8 Char[0x1000];
+	uint8 ROM1541[0x4000];
+};
+
+static ROMImages *load_rom_images(void);
+
+
 /*
  *  Constructor: Allocate objects and memory
  */
 
 C64::C64()
 {
+    RAM = Basic = Kernal = Char = Color = NULL;
+    RAM1541 = ROM1541 = NULL;
+
+    TheDisplay = NULL;
+    TheInput = NULL;
+    TheJoystick = NULL;
+
+    TheCPU = NULL;
+    TheVIC = NULL;
+    TheSID = NULL;
+    TheCIA1 = NULL;
+    TheCIA2 = NULL;
+    TheIEC = NULL;
+    TheREU = NULL;
+    TheCPU1541 = NULL;
+    TheJob1541 = NULL;
 }
 
 
@@ -66,11 +95,15 @@ C64::~C64()
 /*
  * Init emulation
  */
-bool C64::init()
+bool C64::init(bool headless)
 {
 	int i,j;
 	uint8 *p;
 
+    this->headless = headless;
+    frameCount = 0;
+    frameLimit = 0;
+
 	// The thread is not yet running
 	quit_thyself = false;
 	have_a_break = false;
@@ -95,23 +128,33 @@ bool C64::init()
 
 	// Allocate RAM/ROM memory
 	RAM = new uint8[0x10000];
-	Basic = new uint8[0x2000];
 	Kernal = new uint8[0x2000];
-	Char = new uint8[0x1000];
 	Color = new uint8[0x0400];
 	RAM1541 = new uint8[0x0800];
 	ROM1541 = new uint8[0x4000];
 
+	// System-dependent things
+
+    if (!loadRomFiles())
+    {
+        return false;
+    }
+
 	// Create the chips
 	TheCPU = new MOS6510(this, RAM, Basic, Kernal, Char, Color);
-	TheJob1541 = new Job1541(RAM1541);
+	TheJob1541 = new Job1541(&ThePrefs, RAM1541);
 	TheCPU1541 = new MOS6502_1541(this, TheJob1541, TheDisplay, RAM1541, ROM1541);
 	TheVIC = TheCPU->TheVIC = new MOS6569(this, TheDisplay, TheCPU, RAM, Char, Color);
 	TheSID = TheCPU->TheSID = new MOS6581(this);
-	TheCIA1 = TheCPU->TheCIA1 = new MOS6526_1(TheCPU, TheVIC);
-	TheCIA2 = TheCPU->TheCIA2 = TheCPU1541->TheCIA2 = new MOS6526_2(TheCPU, TheVIC, TheCPU1541);
-	TheIEC = TheCPU->TheIEC = new IEC(TheDisplay);
-	TheREU = TheCPU->TheREU = new REU(TheCPU);
+	TheCIA1 = TheCPU->TheCIA1 = new MOS6526_1(TheCPU, TheVIC, &ThePrefs);
+	TheCIA2 = TheCPU->TheCIA2 = TheCPU1541->TheCIA2 = new MOS6526_2(TheCPU, TheVIC, TheCPU1541, &ThePrefs);
+	TheIEC = TheCPU->TheIEC = new IEC(&ThePrefs, TheDisplay);
+	TheREU = TheCPU->TheREU = new REU(TheCPU, &ThePrefs);
+
+    #ifdef FRODO_SC
+        TheCIA1->SetClock(&CycleCounter);
+        TheCIA2->SetClock(&CycleCounter);
+    #endif
 
 	// Initialize RAM with powerup pattern
 	for (i=0, p=RAM; i<512; i++) {
@@ -134,7 +177,7 @@ bool C64::init()
 
     TheJoystick = new VirtualJoystick(this);
     #ifdef WEBOS
-        TheJoystick->setMode(VirtualJoystick::MODE_MOUSE);
+        TheJoystick->setMode(headless ? VirtualJoystick::MODE_DISABLED : VirtualJoystick::MODE_MOUSE);
     #else
         TheJoystick->setMode(VirtualJoystick::MODE_DISABLED);
     #endif
@@ -143,13 +186,6 @@ bool C64::init()
 	    CycleCounter = 0;
     #endif
 
-	// System-dependent things
-
-    if (!loadRomFiles())
-    {
-        return false;
-    }
-
 	// Reset chips
 	TheCPU->Reset();
 	TheSID->Reset();
@@ -162,9 +198,9 @@ bool C64::init()
 	orig_kernal_1d85 = Kernal[0x1d85];
 	PatchKernal(ThePrefs.FastReset, ThePrefs.Emul1541Proc);
 
-    ThePrefs.SkipFrames = 2;
-
-    ticksPerFrame = 1000/SCREEN_FREQ;
+    skipFrames = 1;
+    drawCostNs = skipCostNs = 0;
+    drawnFrames = 0;
 
     sync(true);
 
@@ -199,9 +235,7 @@ void C64::shutdown()
     delete TheJoystick;
 
 	delete[] RAM;
-	delete[] Basic;
 	delete[] Kernal;
-	delete[] Char;
 	delete[] Color;
 	delete[] RAM1541;
 	delete[] ROM1541;
@@ -753,58 +787,99 @@ bool C64::LoadSnapshot(const char *filename)
 	}
 }
 
-bool C64::loadRomFiles()
+/*
+ *  Load ROM files into a ROMImages block
+ */
+
+static ROMImages *load_rom_images(void)
 {
 	FILE *file;
+	ROMImages *roms = new ROMImages;
 
 	// Load Basic ROM
 	if ((file = fopen(BASIC_ROM_FILE, "rb")) != NULL) {
-		if (fread(Basic, 1, 0x2000, file) != 0x2000) {
-			ShowRequester("Can't read 'Basic ROM'.", "Quit");
-			return false;
+		if (fread(roms->Basic, 1, 0x2000, file) != 0x2000) {
+			printf("Can't read 'Basic ROM'.\n");
+			fclose(file);
+			delete roms;
+			return NULL;
 		}
 		fclose(file);
 	} else {
-		ShowRequester("Can't find 'Basic ROM'.", "Quit");
-		return false;
+		printf("Can't find 'Basic ROM'.\n");
+		delete roms;
+		return NULL;
 	}
 
 	// Load Kernal ROM
 	if ((file = fopen(KERNAL_ROM_FILE, "rb")) != NULL) {
-		if (fread(Kernal, 1, 0x2000, file) != 0x2000) {
-			ShowRequester("Can't read 'Kernal ROM'.", "Quit");
-			return false;
+		if (fread(roms->Kernal, 1, 0x2000, file) != 0x2000) {
+			printf("Can't read 'Kernal ROM'.\n");
+			fclose(file);
+			delete roms;
+			return NULL;
 		}
 		fclose(file);
 	} else {
-		ShowRequester("Can't find 'Kernal ROM'.", "Quit");
-		return false;
+		printf("Can't find 'Kernal ROM'.\n");
+		delete roms;
+		return NULL;
 	}
 
 	// Load Char ROM
 	if ((file = fopen(CHAR_ROM_FILE, "rb")) != NULL) {
-		if (fread(Char, 1, 0x1000, file) != 0x1000) {
-			ShowRequester("Can't read 'Char ROM'.", "Quit");
-			return false;
+		if (fread(roms->Char, 1, 0x1000, file) != 0x1000) {
+			printf("Can't read 'Char ROM'.\n");
+			fclose(file);
+			delete roms;
+			return NULL;
 		}
 		fclose(file);
 	} else {
-		ShowRequester("Can't find 'Char ROM'.", "Quit");
-		return false;
+		printf("Can't find 'Char ROM'.\n");
+		delete roms;
+		return NULL;
 	}
 
 	// Load 1541 ROM
 	if ((file = fopen(FLOPPY_ROM_FILE, "rb")) != NULL) {
-		if (fread(ROM1541, 1, 0x4000, file) != 0x4000) {
-			ShowRequester("Can't read '1541 ROM'.", "Quit");
-			return false;
+		if (fread(roms->ROM1541, 1, 0x4000, file) != 0x4000) {
+			printf("Can't read '1541 ROM'.\n");
+			fclose(file);
+			delete roms;
+			return NULL;
 		}
 		fclose(file);
 	} else {
-		ShowRequester("Can't find '1541 ROM'.", "Quit");
-		return false;
+		printf("Can't find '1541 ROM'.\n");
+		delete roms;
+		return NULL;
 	}
 
+	return roms;
+}
+
+/*
+ *  Attach the shared ROM images (loaded on first use)
+ */
+
+bool C64::loadRomFiles()
+{
+    // Function-local static: initialized exactly once, even with
+    // several C64 instances starting up on different threads
+    static ROMImages *roms = load_rom_images();
+
+    if (NULL == roms)
+    {
+        ShowRequester("Can't load ROM files.", "Quit");
+        return false;
+    }
+
+    Basic = roms->Basic;
+    Char = roms->Char;
+    memcpy(Kernal, roms->Kernal, 0x2000);
+    memcpy(ROM1541, roms->ROM1541, 0x4000);
+
 	return true;
 }
 
@@ -842,6 +917,49 @@ bool C64::isPaused()
     return have_a_break;
 }
 
+bool C64::isHeadless() const
+{
+    return headless;
+}
+
+uint32 C64::getFrameCount() const
+{
+    return frameCount;
+}
+
+/*
+ *  Number of frames per drawn frame, read by the VIC at the end of
+ *  every drawn frame
+ */
+
+int C64::getSkipFrames() const
+{
+    return ThePrefs.SkipFrames > 0 ? ThePrefs.SkipFrames : skipFrames;
+}
+
+void C64::setFrameLimit(uint32 frames)
+{
+    frameLimit = frames;
+}
+
+/*
+ *  Run the emulation synchronously on the calling thread for the
+ *  given number of frames
+ */
+
+void C64::runFrames(uint32 frames)
+{
+    frameLimit = frameCount + frames;
+
+    while (!quit_thyself)
+    {
+        doStep();
+    }
+
+    quit_thyself = false;
+    frameLimit = 0;
+}
+
 /*
  *  Resume emulation
  */
@@ -854,14 +972,27 @@ void C64::Resume()
 }
 
 /*
- *  Vertical blank: Poll keyboard and joysticks, update window
+ *  Vertical blank: Poll keyboard and joysticks, update window if the
+ *  frame just finished was drawn
  */
 
 void C64::VBlank(bool draw_frame)
 {
     //Debug("C64::VBlank\n");
 
-    TheJoystick->update();
+    frameCount++;
+
+    profiler.endFrame();
+
+    if (frameLimit > 0 && frameCount >= frameLimit)
+    {
+        Quit();
+    }
+
+    if (!headless)
+    {
+        TheJoystick->update();
+    }
 
 	// Poll keyboard
 	TheInput->getState(TheCIA1->KeyMatrix, TheCIA1->RevMatrix);
@@ -890,7 +1021,7 @@ void C64::VBlank(bool draw_frame)
 		return;
     }
 
-    sync();
+    sync(false, draw_frame);
 
 	if (draw_frame) {
 	    // Perform the actual screen update exactly at the
@@ -903,42 +1034,52 @@ void C64::VBlank(bool draw_frame)
 
 
 #define ABSOLUTE_TIMING 1
-void C64::sync(bool init)
+#define MAX_SKIP_FRAMES 5       // Draw at least every 5th frame
+
+void C64::sync(bool init, bool drawn)
 {
     if (init)
     {
-        startTime = SDL_GetTicks();
-        nextVBlankTime = startTime + ticksPerFrame;
-        speedometerUpdateTime = 0;
+        frameStartNs = host_time_ns();
+        nextVBlankNs = frameStartNs + FRAME_NS;
+        speedometerUpdateNs = 0;
         return;
     }
 
     // measure elapsed time
-    uint32 currentTime = SDL_GetTicks();
+    uint64 currentNs = host_time_ns();
+    uint64 elapsedNs = currentNs - frameStartNs;
 
-    uint32 elapsedTime = currentTime - startTime;
+    adaptSkipFrames(drawn, elapsedNs);
 
-    //printf("ELAPSED: %d\n", elapsedTime);
+    if (drawn)
+    {
+        drawnFrames++;
+    }
 
-	int speed_index = elapsedTime <= 0 ? 999 : ticksPerFrame * 100 / ((int) elapsedTime + 1);
+    int speed_index = (int) (FRAME_NS * 100 / (elapsedNs + 1));
 
-	// limiting the speed to 100%
-	if (ThePrefs.LimitSpeed)
+    // limiting the speed to 100% (headless mode always runs unthrottled).
+    // Frames are paced at the exact PAL rate the SID renderer assumes, so
+    // its playback rate control only has to absorb the drift between the
+    // host and audio device clocks.
+    if (ThePrefs.LimitSpeed && !headless)
     {
-        if (currentTime <= nextVBlankTime) 
+        // Sleep whole milliseconds, the absolute deadline carries the rest
+        // over to the next frame
+        if (currentNs < nextVBlankNs)
         {
-            uint32 waitTime = nextVBlankTime - currentTime;
-            SDL_Delay(waitTime);
+            SDL_Delay((uint32) ((nextVBlankNs - currentNs) / 1000000));
         }
 
         #if ABSOLUTE_TIMING
-            nextVBlankTime += ticksPerFrame;
-            if (nextVBlankTime < currentTime)
+            nextVBlankNs += FRAME_NS;
+            if (nextVBlankNs < currentNs)
             {
-                nextVBlankTime = currentTime;
+                nextVBlankNs = currentNs;
             }
         #else
-            nextVBlankTime = currentTime + ticksPerFrame;
+            nextVBlankNs = currentNs + FRAME_NS;
         #endif
 
         if (speed_index > 100)
@@ -947,13 +1088,52 @@ void C64::sync(bool init)
         }
     }
 
-    if (speedometerUpdateTime == 0 || currentTime - speedometerUpdateTime >= 1000)
+    if (speedometerUpdateNs == 0 || currentNs - speedometerUpdateNs >= 1000000000)
+    {
+        TheDisplay->Speedometer(speed_index, drawnFrames, getSkipFrames());
+        speedometerUpdateNs = currentNs;
+        drawnFrames = 0;
+    }
+
+    frameStartNs = host_time_ns();
+}
+
+/*
+ *  Adaptive frame skipping: choose the smallest n so that one drawn
+ *  and n-1 skipped frames fit into n frame times with some headroom
+ *  left for the renderer. Skipped frames still run the whole emulation,
+ *  only the VIC pixel work is left out, so the cost of both kinds of
+ *  frames is averaged separately. Headless runs have no real time to
+ *  keep up with and draw every frame.
+ */
+
+void C64::adaptSkipFrames(bool drawn, uint64 frameNs)
+{
+    uint64& cost = drawn ? drawCostNs : skipCostNs;
+    cost = (0 == cost) ? frameNs : cost - cost/8 + frameNs/8;
+
+    if (headless || !ThePrefs.LimitSpeed)
+    {
+        skipFrames = 1;
+        return;
+    }
+
+    uint64 budgetNs = FRAME_NS;
+    uint64 skipNs = (0 != skipCostNs) ? skipCostNs : drawCostNs;
+
+    int n = 1;
+    while (n < MAX_SKIP_FRAMES && drawCostNs + (n-1) * skipNs > n * budgetNs * 9/10)
+    {
+        n++;
+    }
+
+    // Draw more frames again only if that leaves a clear margin
+    if (n < skipFrames && drawCostNs + (n-1) * skipNs > n * budgetNs * 8/10)
     {
-        TheDisplay->Speedometer((int) speed_index);
-        speedometerUpdateTime = currentTime;
+        n = skipFrames;
     }
 
-    startTime = SDL_GetTicks();
+    skipFrames = n;
 }
 
 /*
@@ -973,46 +1153,76 @@ void C64::emulationStep()
 		state_change = false;
 
     #else
+        PROFILE_START(profiler);
+
 		// The order of calls is important here
 		int cycles = TheVIC->EmulateLine();
+        PROFILE_SECTION(profiler, Profiler::SECTION_VIC);
+
 		TheSID->EmulateLine();
+        PROFILE_SECTION(profiler, Profiler::SECTION_SID);
 
         #if !PRECISE_CIA_CYCLES
 		    TheCIA1->EmulateLine(ThePrefs.CIACycles);
 		    TheCIA2->EmulateLine(ThePrefs.CIACycles);
+            PROFILE_SECTION(profiler, Profiler::SECTION_CIA);
         #endif
 
 		if (ThePrefs.Emul1541Proc) 
         {
 			int cycles_1541 = ThePrefs.FloppyCycles;
 			TheCPU1541->CountVIATimers(cycles_1541);
+            PROFILE_SECTION(profiler, Profiler::SECTION_DRIVE);
 
 			if (!TheCPU1541->Idle) 
             {
 				// 1541 processor active, alternately execute
 				//  6502 and 6510 instructions until both have
-				//  used up their cycles
+				//  used up their cycles. The processors switch too
+				//  often to read the clock every time, so every 16th
+				//  instruction of each one is timed and the time of
+				//  the loop is split in that ratio.
+                bool sample = profiler.isEnabled();
+                uint64 sampleNs[Profiler::SECTION_COUNT] = { 0 };
+                uint32 steps[Profiler::SECTION_COUNT] = { 0 };
 				while (cycles >= 0 || cycles_1541 >= 0)
                 {
-					if (cycles > cycles_1541)
+                    int section = (cycles > cycles_1541) ? Profiler::SECTION_CPU : Profiler::SECTION_DRIVE;
+                    bool timed = sample && 0 == (++steps[section] & 15);
+                    uint64 start = timed ? host_time_ns() : 0;
+
+					if (Profiler::SECTION_CPU == section)
                     {
 						cycles -= TheCPU->EmulateLine(1);
+                        PROFILE_COUNT(profiler, Profiler::SECTION_CPU);
                     }
 					else
                     {
 						cycles_1541 -= TheCPU1541->EmulateLine(1);
+                        PROFILE_COUNT(profiler, Profiler::SECTION_DRIVE);
+                    }
+
+                    if (timed)
+                    {
+                        sampleNs[section] += host_time_ns() - start;
                     }
+                }
+                if (sample)
+                {
+                    profile_t = profiler.split(profile_t, sampleNs);
                 }
 			} 
             else
             {
 				TheCPU->EmulateLine(cycles);
+                PROFILE_SECTION(profiler, Profiler::SECTION_CPU);
             }
 		}
         else
         {
 			// 1541 processor disabled, only emulate 6510
 			TheCPU->EmulateLine(cycles);
+            PROFILE_SECTION(profiler, Profiler::SECTION_CPU);
         }
     #endif
 }
@@ -1035,39 +1245,96 @@ void C64::EmulateCycles()
     bool emul1541 = ThePrefs.Emul1541Proc;
     bool vicCycleFinished = false;
 
+    // The VIC and the 6510 have work to do in every cycle. The CIAs and
+    // the VIA timers of an idle 1541 only when a timer underflows, until
+    // then they are scheduled to wake up in that cycle and count lazily.
+    uint32 viaCounted = CycleCounter;   // First cycle not counted by the VIAs
+    uint32 viaEvent = CycleCounter;     // Next cycle the VIAs must be counted
+
+    // The chips are interleaved every cycle, timing them costs more
+    // than emulating them, so only profiling builds do it. Otherwise,
+    // while the profiler is enabled (benchmark suite), every 256th cycle
+    // is timed and the time of the loop is split in that ratio.
+    #ifdef PROFILING
+        #define PROFILE_CYCLE_START()           PROFILE_START(profiler)
+        #define PROFILE_CYCLE_SECTION(section)  PROFILE_SECTION(profiler, section)
+    #else
+        bool sample = profiler.isEnabled();
+        uint64 sampleNs[Profiler::SECTION_COUNT] = { 0 };
+        uint64 loopStart = sample ? host_time_ns() : 0;
+
+        #define PROFILE_CYCLE_START()           bool sampled = sample && 0 == (CycleCounter & 255); \
+                                                uint64 profile_t = sampled ? host_time_ns() : 0
+        #define PROFILE_CYCLE_SECTION(section)  if (sampled) { uint64 t = host_time_ns(); sampleNs[section] += t - profile_t; profile_t = t; }
+    #endif
+
 	while (!state_change) 
     {
+        PROFILE_CYCLE_START();
 
 		// The order of calls is important here
         vicCycleFinished = TheVIC->EmulateCycle();
+        PROFILE_CYCLE_SECTION(Profiler::SECTION_VIC);
 
 		if (vicCycleFinished)
         {
 			TheSID->EmulateLine();
+            PROFILE_CYCLE_SECTION(Profiler::SECTION_SID);
         }
 
 		TheCIA1->CheckIRQs();
 		TheCIA2->CheckIRQs();
 
-        #ifndef BATCH_CIA_CYCLES
-		    TheCIA1->EmulateCycle();
-		    TheCIA2->EmulateCycle();
-        #endif
+        if (TheCIA1->EventDue(CycleCounter))
+        {
+            TheCIA1->EmulateEvent(CycleCounter);
+        }
+        if (TheCIA2->EventDue(CycleCounter))
+        {
+            TheCIA2->EmulateEvent(CycleCounter);
+        }
+        PROFILE_CYCLE_SECTION(Profiler::SECTION_CIA);
 
 		TheCPU->EmulateCycle();
+        PROFILE_CYCLE_SECTION(Profiler::SECTION_CPU);
 
-        if (emul1541)
+        if (emul1541 && (!TheCPU1541->Idle || (int32)(CycleCounter - viaEvent) >= 0))
         {
-		    TheCPU1541->CountVIATimers(1);
+		    TheCPU1541->CountVIATimers(CycleCounter + 1 - viaCounted);
+            viaCounted = CycleCounter + 1;
+
 		    if (!TheCPU1541->Idle)
             {
 			    TheCPU1541->EmulateCycle();
             }
+            if (TheCPU1541->Idle)
+            {
+                viaEvent = CycleCounter + 1 + TheCPU1541->CyclesToVIAUnderflow();
+            }
+            PROFILE_CYCLE_SECTION(Profiler::SECTION_DRIVE);
         }
 
 		CycleCounter++;
 	}
 
+    #ifndef PROFILING
+        if (sample)
+        {
+            profiler.split(loopStart, sampleNs);
+        }
+    #endif
+
+    // Bring the sleeping chips up to date for snapshots and the monitor
+    TheCIA1->Wake(CycleCounter);
+    TheCIA2->Wake(CycleCounter);
+    if (emul1541)
+    {
+        TheCPU1541->CountVIATimers(CycleCounter - viaCounted);
+    }
+
+    #undef PROFILE_CYCLE_START
+    #undef PROFILE_CYCLE_SECTION
+
 }
 
 #endif
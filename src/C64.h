@@ -8,6 +8,8 @@
 #define _C64_H
 
 #include <SDL.h>
+#include "Prefs.h"
+#include "Profiler.h"
 
 // false: Frodo, true: FrodoSC
 extern bool IsFrodoSC;
@@ -32,7 +34,7 @@ class C64 {
 	    C64();
 	    ~C64();
 
-        bool init(void);
+        bool init(bool headless=false);
         void shutdown();
         void doStep();
         bool isCancelled();
@@ -62,13 +64,21 @@ class C64 {
 	    bool LoadSIDState(FILE *f);
 	    bool LoadCIAState(FILE *f);
         bool isPaused();
+        bool isHeadless() const;
+        uint32 getFrameCount() const;
+        int getSkipFrames() const;
+        void setFrameLimit(uint32 frames);
+        void runFrames(uint32 frames);
 
         int ShowRequester(const char* text, const char* button1=NULL, const char* button2=NULL);
         void soundSync();
 
     public:
+	    Prefs ThePrefs;				// Active preferences of this C64
+        Profiler profiler;          // Host time per chip
+
 	    uint8 *RAM, *Basic, *Kernal,
-		      *Char, *Color;		// C64
+		      *Char, *Color;		// C64 (Basic and Char are shared, read-only)
 	    uint8 *RAM1541, *ROM1541;	// 1541
 
 	    C64Display* TheDisplay;
@@ -89,7 +99,8 @@ class C64 {
     private:
         bool loadRomFiles();
 	    void emulationStep(void);
-        void sync(bool init=false);
+        void sync(bool init, bool drawn=true);
+        void adaptSkipFrames(bool drawn, uint64 frameNs);
 
 	    bool quit_thyself;		// Emulation thread shall quit
 	    bool have_a_break;		// Emulation thread shall pause
@@ -100,12 +111,18 @@ class C64 {
 	    uint8 orig_kernal_1d84,	// Original contents of kernal locations $1d84 and $1d85
 		      orig_kernal_1d85;	// (for undoing the Fast Reset patch)
 
-        uint32 ticksPerFrame;
-        uint32 startTime;
-        uint32 speedometerUpdateTime;
-        uint32 nextVBlankTime;
+        uint64 speedometerUpdateNs;
+        uint64 nextVBlankNs;        // Host time the next frame is due
+        uint64 frameStartNs;        // Host time the current frame started, after the sync delay
+        uint64 drawCostNs;          // Average host time of a drawn/skipped frame
+        uint64 skipCostNs;
+        int skipFrames;             // Draw every n-th frame, adapted if ThePrefs.SkipFrames is 0
+        uint32 drawnFrames;         // Frames drawn since the last speedometer update
 	    uint8 joy_state;			// Current state of joystick
 	    bool state_change;
+        bool headless;          // No display/audio output, run unthrottled
+        uint32 frameCount;      // Number of emulated frames
+        uint32 frameLimit;      // Quit after this number of frames (0: no limit)
 
         SDL_Joystick *joystick1;     // joystick 1
         SDL_Joystick *joystick2;     // joystick 2
@@ -18,22 +18,28 @@ struct MOS6526State;
 
 class MOS6526 {
 public:
-	MOS6526(MOS6510 *CPU);
+	MOS6526(MOS6510 *CPU, Prefs *prefs);
 
 	void Reset(void);
 	void GetState(MOS6526State *cs);
 	void SetState(MOS6526State *cs);
 #ifdef FRODO_SC
+	void SetClock(const uint32 *cycle_counter);
 	void CheckIRQs(void);
 	void EmulateCycle(void);
+	bool EventDue(uint32 cycle);
+	void EmulateEvent(uint32 cycle);
+	void Wake(uint32 cycle);
 #else
 	void EmulateLine(int cycles);
+	int CyclesToUnderflow(void);
 #endif
 	void CountTOD(void);
 	virtual void TriggerInterrupt(int bit)=0;
 
 protected:
 	MOS6510 *the_cpu;	// Pointer to 6510
+	Prefs *the_prefs;	// Pointer to active preferences
 
 	uint8 pra, prb, ddra, ddrb;
 
@@ -59,13 +65,21 @@ protected:
 		 has_new_crb;			// Flag: New value for CRB pending
 	char ta_state, tb_state;	// Timer A/B states
 	uint8 new_cra, new_crb;		// New values for CRA/CRB
+
+	void sync(void);
+	void schedule(uint32 cycle);
+
+	const uint32 *clock;		// Pointer to C64 cycle counter
+	bool asleep;				// Flag: Timers are counted lazily
+	uint32 sleep_cycle;			// First cycle not emulated while asleep
+	uint32 next_event;			// Next cycle that needs EmulateCycle()
 #endif
 };
 
 
 class MOS6526_1 : public MOS6526 {
 public:
-	MOS6526_1(MOS6510 *CPU, MOS6569 *VIC);
+	MOS6526_1(MOS6510 *CPU, MOS6569 *VIC, Prefs *prefs);
 
 	void Reset(void);
 	uint8 ReadRegister(uint16 adr);
@@ -89,7 +103,7 @@ private:
 
 class MOS6526_2 : public MOS6526{
 public:
-	MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541);
+	MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541, Prefs *prefs);
 
 	void Reset(void);
 	uint8 ReadRegister(uint16 adr);
@@ -150,6 +164,29 @@ inline void MOS6526::CheckIRQs(void)
 		TriggerInterrupt(2);
 	}
 }
+
+
+/*
+ *  Does the CIA have to be emulated in this cycle?
+ */
+
+inline bool MOS6526::EventDue(uint32 cycle)
+{
+	return (int32)(cycle - next_event) >= 0;
+}
+
+
+/*
+ *  Bring lazily counted timers up to date before a register access
+ *  (registers are only accessed by the 6510, after the CIAs had their
+ *  share of the current cycle)
+ */
+
+inline void MOS6526::sync(void)
+{
+	if (asleep)
+		Wake(*clock + 1);
+}
 #else
 inline void MOS6526::EmulateLine(int cycles)
 {
@@ -191,6 +228,23 @@ tb_underflow:
 		}
 	}
 }
+
+
+/*
+ *  Number of cycles EmulateLine() can be given without a timer underflow
+ */
+
+inline int MOS6526::CyclesToUnderflow(void)
+{
+	int cycles = 0x10000;
+
+	if (ta_cnt_phi2 && ta < cycles)
+		cycles = ta;
+	if (tb_cnt_phi2 && tb < cycles)
+		cycles = tb;
+	return cycles;
+}
+
 #endif
 
 #endif
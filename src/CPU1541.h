@@ -56,6 +56,7 @@ public:
 	uint8 ExtReadByte(uint16 adr);
 	void ExtWriteByte(uint16 adr, uint8 byte);
 	void CountVIATimers(int cycles);
+	int CyclesToVIAUnderflow(void);
 	void NewATNState(void);
 	void IECInterrupt(void);
 	void TriggerJobIRQ(void);
@@ -244,6 +245,24 @@ inline void MOS6502_1541::CountVIATimers(int cycles)
 }
 
 
+/*
+ *  Number of cycles CountVIATimers() can be given without a timer underflow
+ */
+
+inline int MOS6502_1541::CyclesToVIAUnderflow(void)
+{
+	int cycles = via1_t1c;
+
+	if (!(via1_acr & 0x20) && via1_t2c < cycles)
+		cycles = via1_t2c;
+	if (via2_t1c < cycles)
+		cycles = via2_t1c;
+	if (!(via2_acr & 0x20) && via2_t2c < cycles)
+		cycles = via2_t2c;
+	return cycles;
+}
+
+
 /*
  *  ATN line probably changed state, recalc IECLines
  */
@@ -27,6 +27,29 @@
 #define PRECISE_CIA_CYCLES 0
 #endif
 
+// Set this to 1 to execute from a cache of pre-decoded instruction blocks
+// (line based emulation with a 16 bit PC only)
+#if defined(FRODO_SC) || PC_IS_POINTER
+#undef BLOCK_CACHE
+#endif
+#ifndef BLOCK_CACHE
+#define BLOCK_CACHE 0
+#endif
+
+// Set this to 1 to skip ahead in loops that only wait for an interrupt
+// or the next raster line (needs BLOCK_CACHE)
+#if !BLOCK_CACHE
+#undef SKIP_IDLE_LOOPS
+#endif
+#ifndef SKIP_IDLE_LOOPS
+#define SKIP_IDLE_LOOPS 0
+#endif
+
+#if BLOCK_CACHE
+const int BLOCK_UOPS = 16;			// Max. instructions per block
+const int BLOCK_CACHE_SIZE = 2048;	// Number of blocks, power of 2
+#endif
+
 
 // Interrupt types
 enum {
@@ -63,6 +86,9 @@ public:
 	void SetState(MOS6510State *s);
 	uint8 ExtReadByte(uint16 adr);
 	void ExtWriteByte(uint16 adr, uint8 byte);
+#if BLOCK_CACHE
+	void FlushBlockCache(void);			// RAM was modified behind the CPU's back
+#endif
 	uint8 REUReadByte(uint16 adr);
 	void REUWriteByte(uint16 adr, uint8 byte);
 
@@ -98,6 +124,7 @@ private:
 	void write_zp(uint16 adr, uint8 byte);
 
 	void new_config(void);
+	void map_pages(void);
 	void jump(uint16 adr);
 	void illegal_op(uint8 op, uint16 at);
 	void illegal_jump(uint16 at, uint16 to);
@@ -107,6 +134,46 @@ private:
 
 	uint8 read_emulator_id(uint16 adr);
 
+#if BLOCK_CACHE
+	// Pre-decoded instruction
+	struct uop_t {
+		uint8 op;			// Opcode
+		uint8 len;			// Instruction length, 0 terminates the block
+		uint16 operand;		// Operand byte or word
+	};
+
+	// Straight-line run of instructions within one page
+	struct block_t {
+		uint32 tag;			// Start address, BLOCK_ROM set if decoded from ROM
+		uint32 gen;			// page_gen[] of a RAM page at decoding time
+#if SKIP_IDLE_LOOPS
+		bool idle;			// Loop that doesn't change anything, see idle_loop()
+#endif
+		uop_t uop[BLOCK_UOPS + 1];
+	};
+
+	const uop_t *find_block(uint16 adr);
+	void decode_uop(uop_t *u, uint16 adr, uint8 op, int len);
+	void invalidate_code(uint16 adr);
+	void kill_block(void);
+#if SKIP_IDLE_LOOPS
+	bool idle_loop(const uop_t *u, int n, uint16 start, uint16 end);
+	int skip_idle(int cycles_left);
+#endif
+
+	block_t blocks[BLOCK_CACHE_SIZE];	// Direct mapped, indexed by start address
+	block_t *cur_block;		// Block being executed, NULL for a single instruction
+	const uop_t *cur_uop;	// Last executed instruction, kept between EmulateLine() calls
+	uop_t uop_single[2];	// Instruction that can't be cached and terminator
+	uop_t uop_restart[2];	// Forces a block lookup on the next opcode fetch
+	uint32 page_gen[256];	// Incremented on writes to cached code in a RAM page
+	uint8 code_map[0x2000];	// One bit per RAM byte that is part of a cached block
+#if SKIP_IDLE_LOOPS
+	block_t *idle_block;	// Idle loop entered by the last block lookup
+	int idle_cycles;		// cycles_left at its start, -1: not yet known
+#endif
+#endif
+
 	C64 *the_c64;		// Pointer to C64 object
 
 	uint8 *ram;			// Pointer to main RAM
@@ -140,6 +207,8 @@ private:
 #endif
 
 	bool basic_in, kernal_in, char_in, io_in;
+	uint8 *read_page[256];	// Memory of each page for reading, NULL: read_byte_io()
+	uint8 *write_page[256];	// Memory of each page for writing, NULL: write_byte_io()
 	uint8 dfff_byte;
 };
 
@@ -11,13 +11,41 @@
  *  Addressing mode macros
  */
 
+#if BLOCK_CACHE && !defined(IS_CPU_1541)
+#define USE_BLOCK_CACHE 1
+#else
+#define USE_BLOCK_CACHE 0
+#endif
+
+// Read opcode, with the block cache from the next pre-decoded
+// instruction (uses uop!), skipping ahead when entering an idle loop
+// (uses cycles_left!)
+#if USE_BLOCK_CACHE && SKIP_IDLE_LOOPS
+#define read_opcode() (((++uop)->len || (uop = find_block(pc), idle_block && (cycles_left -= skip_idle(cycles_left)))), pc++, uop->op)
+#elif USE_BLOCK_CACHE
+#define read_opcode() (((++uop)->len || (uop = find_block(pc))), pc++, uop->op)
+#else
+#define read_opcode() read_byte_imm()
+#endif
+
 // Read immediate operand
-#if PC_IS_POINTER
+#if USE_BLOCK_CACHE
+#define read_byte_imm() (pc++, (uint8)uop->operand)
+#elif PC_IS_POINTER
 #define read_byte_imm() (*pc++)
 #else
 #define read_byte_imm() read_byte(pc++)
 #endif
 
+// Read immediate operand without incrementing the PC
+#if USE_BLOCK_CACHE
+#define peek_byte_imm() ((uint8)uop->operand)
+#elif PC_IS_POINTER
+#define peek_byte_imm() (*pc)
+#else
+#define peek_byte_imm() read_byte(pc)
+#endif
+
 // Read zeropage operand address
 #define read_adr_zero() ((uint16)read_byte_imm())
 
@@ -28,7 +56,9 @@
 #define read_adr_zero_y() ((read_byte_imm() + y) & 0xff)
 
 // Read absolute operand address (uses adr!)
-#if PC_IS_POINTER
+#if USE_BLOCK_CACHE
+#define read_adr_abs() (adr = uop->operand, pc+=2, adr)
+#elif PC_IS_POINTER
 #if LITTLE_ENDIAN_UNALIGNED
 #define	read_adr_abs() (adr = *(UWORD *)pc, pc+=2, adr)
 #else
@@ -99,12 +129,61 @@
 #define set_nz(x) (z_flag = n_flag = (x))
 
 
+/*
+ *  Opcode dispatch: either a switch statement or, with THREADED_DISPATCH
+ *  (needs GCC's computed goto), a jump through a table of opcode labels.
+ *  The table jump has no range check and the cycle accounting after an
+ *  opcode branches straight to the next one instead of going through
+ *  the loop head.
+ */
+
+#if THREADED_DISPATCH && !defined(__GNUC__)
+#undef THREADED_DISPATCH
+#define THREADED_DISPATCH 0
+#endif
+
+#if THREADED_DISPATCH
+
+// Opcode label, the case label keeps the switch around for break
+#define OPCODE(op) case 0x##op: op_##op:
+
+#define OPCODE_TABLE { \
+		&&op_00, &&op_01, &&op_02, &&op_03, &&op_04, &&op_05, &&op_06, &&op_07, &&op_08, &&op_09, &&op_0a, &&op_0b, &&op_0c, &&op_0d, &&op_0e, &&op_0f, \
+		&&op_10, &&op_11, &&op_12, &&op_13, &&op_14, &&op_15, &&op_16, &&op_17, &&op_18, &&op_19, &&op_1a, &&op_1b, &&op_1c, &&op_1d, &&op_1e, &&op_1f, \
+		&&op_20, &&op_21, &&op_22, &&op_23, &&op_24, &&op_25, &&op_26, &&op_27, &&op_28, &&op_29, &&op_2a, &&op_2b, &&op_2c, &&op_2d, &&op_2e, &&op_2f, \
+		&&op_30, &&op_31, &&op_32, &&op_33, &&op_34, &&op_35, &&op_36, &&op_37, &&op_38, &&op_39, &&op_3a, &&op_3b, &&op_3c, &&op_3d, &&op_3e, &&op_3f, \
+		&&op_40, &&op_41, &&op_42, &&op_43, &&op_44, &&op_45, &&op_46, &&op_47, &&op_48, &&op_49, &&op_4a, &&op_4b, &&op_4c, &&op_4d, &&op_4e, &&op_4f, \
+		&&op_50, &&op_51, &&op_52, &&op_53, &&op_54, &&op_55, &&op_56, &&op_57, &&op_58, &&op_59, &&op_5a, &&op_5b, &&op_5c, &&op_5d, &&op_5e, &&op_5f, \
+		&&op_60, &&op_61, &&op_62, &&op_63, &&op_64, &&op_65, &&op_66, &&op_67, &&op_68, &&op_69, &&op_6a, &&op_6b, &&op_6c, &&op_6d, &&op_6e, &&op_6f, \
+		&&op_70, &&op_71, &&op_72, &&op_73, &&op_74, &&op_75, &&op_76, &&op_77, &&op_78, &&op_79, &&op_7a, &&op_7b, &&op_7c, &&op_7d, &&op_7e, &&op_7f, \
+		&&op_80, &&op_81, &&op_82, &&op_83, &&op_84, &&op_85, &&op_86, &&op_87, &&op_88, &&op_89, &&op_8a, &&op_8b, &&op_8c, &&op_8d, &&op_8e, &&op_8f, \
+		&&op_90, &&op_91, &&op_92, &&op_93, &&op_94, &&op_95, &&op_96, &&op_97, &&op_98, &&op_99, &&op_9a, &&op_9b, &&op_9c, &&op_9d, &&op_9e, &&op_9f, \
+		&&op_a0, &&op_a1, &&op_a2, &&op_a3, &&op_a4, &&op_a5, &&op_a6, &&op_a7, &&op_a8, &&op_a9, &&op_aa, &&op_ab, &&op_ac, &&op_ad, &&op_ae, &&op_af, \
+		&&op_b0, &&op_b1, &&op_b2, &&op_b3, &&op_b4, &&op_b5, &&op_b6, &&op_b7, &&op_b8, &&op_b9, &&op_ba, &&op_bb, &&op_bc, &&op_bd, &&op_be, &&op_bf, \
+		&&op_c0, &&op_c1, &&op_c2, &&op_c3, &&op_c4, &&op_c5, &&op_c6, &&op_c7, &&op_c8, &&op_c9, &&op_ca, &&op_cb, &&op_cc, &&op_cd, &&op_ce, &&op_cf, \
+		&&op_d0, &&op_d1, &&op_d2, &&op_d3, &&op_d4, &&op_d5, &&op_d6, &&op_d7, &&op_d8, &&op_d9, &&op_da, &&op_db, &&op_dc, &&op_dd, &&op_de, &&op_df, \
+		&&op_e0, &&op_e1, &&op_e2, &&op_e3, &&op_e4, &&op_e5, &&op_e6, &&op_e7, &&op_e8, &&op_e9, &&op_ea, &&op_eb, &&op_ec, &&op_ed, &&op_ee, &&op_ef, \
+		&&op_f0, &&op_f1, &&op_f2, &&op_f3, &&op_f4, &&op_f5, &&op_f6, &&op_f7, &&op_f8, &&op_f9, &&op_fa, &&op_fb, &&op_fc, &&op_fd, &&op_fe, &&op_ff \
+}
+
+/*
+ * End of opcode, decrement cycles left
+ */
+
+#define ENDOP(cyc) last_cycles = cyc; goto next_op;
+
+#else
+
+#define OPCODE(op) case 0x##op:
+
 /*
  * End of opcode, decrement cycles left
  */
 
 #define ENDOP(cyc) last_cycles = cyc; break;
 
+#endif
+
 
 	// Main opcode fetch/execute loop
 #if PRECISE_CPU_CYCLES
@@ -128,466 +207,498 @@
 	while ((cycles_left -= last_cycles) >= 0) {
 #endif
 
-		switch (read_byte_imm()) {
+#if THREADED_DISPATCH
+		static const void * const op_table[256] = OPCODE_TABLE;
+		goto *op_table[read_opcode()];
+
+		// Same as the loop head, but only reached from ENDOP
+next_op:
+#if PRECISE_CPU_CYCLES
+		last_cycles += page_cycles;
+		page_cycles = 0;
+#if PRECISE_CIA_CYCLES && !defined(IS_CPU_1541)
+		TheCIA1->EmulateLine(last_cycles);
+		TheCIA2->EmulateLine(last_cycles);
+#endif
+		if ((cycles_left -= last_cycles) < 0) {
+			borrowed_cycles = -cycles_left;
+#if USE_BLOCK_CACHE
+			cur_uop = uop;
+#endif
+			return last_cycles;
+		}
+#else
+		if ((cycles_left -= last_cycles) < 0) {
+#if USE_BLOCK_CACHE
+			cur_uop = uop;
+#endif
+			return last_cycles;
+		}
+#endif
+		goto *op_table[read_opcode()];
+		switch (0) {
+#else
+		switch (read_opcode()) {
+#endif
 
 
 		// Load group
-		case 0xa9:	// LDA #imm
+		OPCODE(a9)	// LDA #imm
 			set_nz(a = read_byte_imm());
 			ENDOP(2);
 
-		case 0xa5:	// LDA zero
+		OPCODE(a5)	// LDA zero
 			set_nz(a = read_byte_zero());
 			ENDOP(3);
 
-		case 0xb5:	// LDA zero,X
+		OPCODE(b5)	// LDA zero,X
 			set_nz(a = read_byte_zero_x());
 			ENDOP(4);
 
-		case 0xad:	// LDA abs
+		OPCODE(ad)	// LDA abs
 			set_nz(a = read_byte_abs());
 			ENDOP(4);
 
-		case 0xbd:	// LDA abs,X
+		OPCODE(bd)	// LDA abs,X
 			set_nz(a = read_byte_abs_x());
 			ENDOP(4);
 
-		case 0xb9:	// LDA abs,Y
+		OPCODE(b9)	// LDA abs,Y
 			set_nz(a = read_byte_abs_y());
 			ENDOP(4);
 
-		case 0xa1:	// LDA (ind,X)
+		OPCODE(a1)	// LDA (ind,X)
 			set_nz(a = read_byte_ind_x());
 			ENDOP(6);
 		
-		case 0xb1:	// LDA (ind),Y
+		OPCODE(b1)	// LDA (ind),Y
 			set_nz(a = read_byte_ind_y());
 			ENDOP(5);
 
-		case 0xa2:	// LDX #imm
+		OPCODE(a2)	// LDX #imm
 			set_nz(x = read_byte_imm());
 			ENDOP(2);
 
-		case 0xa6:	// LDX zero
+		OPCODE(a6)	// LDX zero
 			set_nz(x = read_byte_zero());
 			ENDOP(3);
 
-		case 0xb6:	// LDX zero,Y
+		OPCODE(b6)	// LDX zero,Y
 			set_nz(x = read_byte_zero_y());
 			ENDOP(4);
 
-		case 0xae:	// LDX abs
+		OPCODE(ae)	// LDX abs
 			set_nz(x = read_byte_abs());
 			ENDOP(4);
 
-		case 0xbe:	// LDX abs,Y
+		OPCODE(be)	// LDX abs,Y
 			set_nz(x = read_byte_abs_y());
 			ENDOP(4);
 
-		case 0xa0:	// LDY #imm
+		OPCODE(a0)	// LDY #imm
 			set_nz(y = read_byte_imm());
 			ENDOP(2);
 
-		case 0xa4:	// LDY zero
+		OPCODE(a4)	// LDY zero
 			set_nz(y = read_byte_zero());
 			ENDOP(3);
 
-		case 0xb4:	// LDY zero,X
+		OPCODE(b4)	// LDY zero,X
 			set_nz(y = read_byte_zero_x());
 			ENDOP(4);
 
-		case 0xac:	// LDY abs
+		OPCODE(ac)	// LDY abs
 			set_nz(y = read_byte_abs());
 			ENDOP(4);
 
-		case 0xbc:	// LDY abs,X
+		OPCODE(bc)	// LDY abs,X
 			set_nz(y = read_byte_abs_x());
 			ENDOP(4);
 
 
 		// Store group
-		case 0x85:	// STA zero
+		OPCODE(85)	// STA zero
 			write_byte(read_adr_zero(), a);
 			ENDOP(3);
 
-		case 0x95:	// STA zero,X
+		OPCODE(95)	// STA zero,X
 			write_byte(read_adr_zero_x(), a);
 			ENDOP(4);
 
-		case 0x8d:	// STA abs
+		OPCODE(8d)	// STA abs
 			write_byte(read_adr_abs(), a);
 			ENDOP(4);
 
-		case 0x9d:	// STA abs,X
+		OPCODE(9d)	// STA abs,X
 			write_byte(read_adr_abs_x(), a);
 			ENDOP(5);
 
-		case 0x99:	// STA abs,Y
+		OPCODE(99)	// STA abs,Y
 			write_byte(read_adr_abs_y(), a);
 			ENDOP(5);
 
-		case 0x81:	// STA (ind,X)
+		OPCODE(81)	// STA (ind,X)
 			write_byte(read_adr_ind_x(), a);
 			ENDOP(6);
 
-		case 0x91:	// STA (ind),Y
+		OPCODE(91)	// STA (ind),Y
 			write_byte(read_adr_ind_y(), a);
 			ENDOP(6);
 
-		case 0x86:	// STX zero
+		OPCODE(86)	// STX zero
 			write_byte(read_adr_zero(), x);
 			ENDOP(3);
 
-		case 0x96:	// STX zero,Y
+		OPCODE(96)	// STX zero,Y
 			write_byte(read_adr_zero_y(), x);
 			ENDOP(4);
 
-		case 0x8e:	// STX abs
+		OPCODE(8e)	// STX abs
 			write_byte(read_adr_abs(), x);
 			ENDOP(4);
 
-		case 0x84:	// STY zero
+		OPCODE(84)	// STY zero
 			write_byte(read_adr_zero(), y);
 			ENDOP(3);
 
-		case 0x94:	// STY zero,X
+		OPCODE(94)	// STY zero,X
 			write_byte(read_adr_zero_x(), y);
 			ENDOP(4);
 
-		case 0x8c:	// STY abs
+		OPCODE(8c)	// STY abs
 			write_byte(read_adr_abs(), y);
 			ENDOP(4);
 
 
 		// Transfer group
-		case 0xaa:	// TAX
+		OPCODE(aa)	// TAX
 			set_nz(x = a);
 			ENDOP(2);
 
-		case 0x8a:	// TXA
+		OPCODE(8a)	// TXA
 			set_nz(a = x);
 			ENDOP(2);
 
-		case 0xa8:	// TAY
+		OPCODE(a8)	// TAY
 			set_nz(y = a);
 			ENDOP(2);
 
-		case 0x98:	// TYA
+		OPCODE(98)	// TYA
 			set_nz(a = y);
 			ENDOP(2);
 
-		case 0xba:	// TSX
+		OPCODE(ba)	// TSX
 			set_nz(x = sp);
 			ENDOP(2);
 
-		case 0x9a:	// TXS
+		OPCODE(9a)	// TXS
 			sp = x;
 			ENDOP(2);
 
 
 		// Arithmetic group
-		case 0x69:	// ADC #imm
+		OPCODE(69)	// ADC #imm
 			do_adc(read_byte_imm());
 			ENDOP(2);
 
-		case 0x65:	// ADC zero
+		OPCODE(65)	// ADC zero
 			do_adc(read_byte_zero());
 			ENDOP(3);
 
-		case 0x75:	// ADC zero,X
+		OPCODE(75)	// ADC zero,X
 			do_adc(read_byte_zero_x());
 			ENDOP(4);
 
-		case 0x6d:	// ADC abs
+		OPCODE(6d)	// ADC abs
 			do_adc(read_byte_abs());
 			ENDOP(4);
 
-		case 0x7d:	// ADC abs,X
+		OPCODE(7d)	// ADC abs,X
 			do_adc(read_byte_abs_x());
 			ENDOP(4);
 
-		case 0x79:	// ADC abs,Y
+		OPCODE(79)	// ADC abs,Y
 			do_adc(read_byte_abs_y());
 			ENDOP(4);
 
-		case 0x61:	// ADC (ind,X)
+		OPCODE(61)	// ADC (ind,X)
 			do_adc(read_byte_ind_x());
 			ENDOP(6);
 
-		case 0x71:	// ADC (ind),Y
+		OPCODE(71)	// ADC (ind),Y
 			do_adc(read_byte_ind_y());
 			ENDOP(5);
 
-		case 0xe9:	// SBC #imm
-		case 0xeb:	// Undocumented opcode
+		OPCODE(e9)	// SBC #imm
+		OPCODE(eb)	// Undocumented opcode
 			do_sbc(read_byte_imm());
 			ENDOP(2);
 
-		case 0xe5:	// SBC zero
+		OPCODE(e5)	// SBC zero
 			do_sbc(read_byte_zero());
 			ENDOP(3);
 
-		case 0xf5:	// SBC zero,X
+		OPCODE(f5)	// SBC zero,X
 			do_sbc(read_byte_zero_x());
 			ENDOP(4);
 
-		case 0xed:	// SBC abs
+		OPCODE(ed)	// SBC abs
 			do_sbc(read_byte_abs());
 			ENDOP(4);
 
-		case 0xfd:	// SBC abs,X
+		OPCODE(fd)	// SBC abs,X
 			do_sbc(read_byte_abs_x());
 			ENDOP(4);
 
-		case 0xf9:	// SBC abs,Y
+		OPCODE(f9)	// SBC abs,Y
 			do_sbc(read_byte_abs_y());
 			ENDOP(4);
 
-		case 0xe1:	// SBC (ind,X)
+		OPCODE(e1)	// SBC (ind,X)
 			do_sbc(read_byte_ind_x());
 			ENDOP(6);
 
-		case 0xf1:	// SBC (ind),Y
+		OPCODE(f1)	// SBC (ind),Y
 			do_sbc(read_byte_ind_y());
 			ENDOP(5);
 
 
 		// Increment/decrement group
-		case 0xe8:	// INX
+		OPCODE(e8)	// INX
 			set_nz(++x);
 			ENDOP(2);
 
-		case 0xca:	// DEX
+		OPCODE(ca)	// DEX
 			set_nz(--x);
 			ENDOP(2);
 
-		case 0xc8:	// INY
+		OPCODE(c8)	// INY
 			set_nz(++y);
 			ENDOP(2);
 
-		case 0x88:	// DEY
+		OPCODE(88)	// DEY
 			set_nz(--y);
 			ENDOP(2);
 
-		case 0xe6:	// INC zero
+		OPCODE(e6)	// INC zero
 			adr = read_adr_zero();
 			write_zp(adr, set_nz(read_zp(adr) + 1));
 			ENDOP(5);
 
-		case 0xf6:	// INC zero,X
+		OPCODE(f6)	// INC zero,X
 			adr = read_adr_zero_x();
 			write_zp(adr, set_nz(read_zp(adr) + 1));
 			ENDOP(6);
 
-		case 0xee:	// INC abs
+		OPCODE(ee)	// INC abs
 			adr = read_adr_abs();
 			write_byte(adr, set_nz(read_byte(adr) + 1));
 			ENDOP(6);
 
-		case 0xfe:	// INC abs,X
+		OPCODE(fe)	// INC abs,X
 			adr = read_adr_abs_x();
 			write_byte(adr, set_nz(read_byte(adr) + 1));
 			ENDOP(7);
 
-		case 0xc6:	// DEC zero
+		OPCODE(c6)	// DEC zero
 			adr = read_adr_zero();
 			write_zp(adr, set_nz(read_zp(adr) - 1));
 			ENDOP(5);
 
-		case 0xd6:	// DEC zero,X
+		OPCODE(d6)	// DEC zero,X
 			adr = read_adr_zero_x();
 			write_zp(adr, set_nz(read_zp(adr) - 1));
 			ENDOP(6);
 
-		case 0xce:	// DEC abs
+		OPCODE(ce)	// DEC abs
 			adr = read_adr_abs();
 			write_byte(adr, set_nz(read_byte(adr) - 1));
 			ENDOP(6);
 
-		case 0xde:	// DEC abs,X
+		OPCODE(de)	// DEC abs,X
 			adr = read_adr_abs_x();
 			write_byte(adr, set_nz(read_byte(adr) - 1));
 			ENDOP(7);
 
 
 		// Logic group
-		case 0x29:	// AND #imm
+		OPCODE(29)	// AND #imm
 			set_nz(a &= read_byte_imm());
 			ENDOP(2);
 
-		case 0x25:	// AND zero
+		OPCODE(25)	// AND zero
 			set_nz(a &= read_byte_zero());
 			ENDOP(3);
 
-		case 0x35:	// AND zero,X
+		OPCODE(35)	// AND zero,X
 			set_nz(a &= read_byte_zero_x());
 			ENDOP(4);
 
-		case 0x2d:	// AND abs
+		OPCODE(2d)	// AND abs
 			set_nz(a &= read_byte_abs());
 			ENDOP(4);
 
-		case 0x3d:	// AND abs,X
+		OPCODE(3d)	// AND abs,X
 			set_nz(a &= read_byte_abs_x());
 			ENDOP(4);
 
-		case 0x39:	// AND abs,Y
+		OPCODE(39)	// AND abs,Y
 			set_nz(a &= read_byte_abs_y());
 			ENDOP(4);
 
-		case 0x21:	// AND (ind,X)
+		OPCODE(21)	// AND (ind,X)
 			set_nz(a &= read_byte_ind_x());
 			ENDOP(6);
 
-		case 0x31:	// AND (ind),Y
+		OPCODE(31)	// AND (ind),Y
 			set_nz(a &= read_byte_ind_y());
 			ENDOP(5);
 
-		case 0x09:	// ORA #imm
+		OPCODE(09)	// ORA #imm
 			set_nz(a |= read_byte_imm());
 			ENDOP(2);
 
-		case 0x05:	// ORA zero
+		OPCODE(05)	// ORA zero
 			set_nz(a |= read_byte_zero());
 			ENDOP(3);
 
-		case 0x15:	// ORA zero,X
+		OPCODE(15)	// ORA zero,X
 			set_nz(a |= read_byte_zero_x());
 			ENDOP(4);
 
-		case 0x0d:	// ORA abs
+		OPCODE(0d)	// ORA abs
 			set_nz(a |= read_byte_abs());
 			ENDOP(4);
 
-		case 0x1d:	// ORA abs,X
+		OPCODE(1d)	// ORA abs,X
 			set_nz(a |= read_byte_abs_x());
 			ENDOP(4);
 
-		case 0x19:	// ORA abs,Y
+		OPCODE(19)	// ORA abs,Y
 			set_nz(a |= read_byte_abs_y());
 			ENDOP(4);
 
-		case 0x01:	// ORA (ind,X)
+		OPCODE(01)	// ORA (ind,X)
 			set_nz(a |= read_byte_ind_x());
 			ENDOP(6);
 
-		case 0x11:	// ORA (ind),Y
+		OPCODE(11)	// ORA (ind),Y
 			set_nz(a |= read_byte_ind_y());
 			ENDOP(5);
 
-		case 0x49:	// EOR #imm
+		OPCODE(49)	// EOR #imm
 			set_nz(a ^= read_byte_imm());
 			ENDOP(2);
 
-		case 0x45:	// EOR zero
+		OPCODE(45)	// EOR zero
 			set_nz(a ^= read_byte_zero());
 			ENDOP(3);
 
-		case 0x55:	// EOR zero,X
+		OPCODE(55)	// EOR zero,X
 			set_nz(a ^= read_byte_zero_x());
 			ENDOP(4);
 
-		case 0x4d:	// EOR abs
+		OPCODE(4d)	// EOR abs
 			set_nz(a ^= read_byte_abs());
 			ENDOP(4);
 
-		case 0x5d:	// EOR abs,X
+		OPCODE(5d)	// EOR abs,X
 			set_nz(a ^= read_byte_abs_x());
 			ENDOP(4);
 
-		case 0x59:	// EOR abs,Y
+		OPCODE(59)	// EOR abs,Y
 			set_nz(a ^= read_byte_abs_y());
 			ENDOP(4);
 
-		case 0x41:	// EOR (ind,X)
+		OPCODE(41)	// EOR (ind,X)
 			set_nz(a ^= read_byte_ind_x());
 			ENDOP(6);
 
-		case 0x51:	// EOR (ind),Y
+		OPCODE(51)	// EOR (ind),Y
 			set_nz(a ^= read_byte_ind_y());
 			ENDOP(5);
 
 
 		// Compare group
-		case 0xc9:	// CMP #imm
+		OPCODE(c9)	// CMP #imm
 			set_nz(adr = a - read_byte_imm());
 			c_flag = adr < 0x100;
 			ENDOP(2);
 
-		case 0xc5:	// CMP zero
+		OPCODE(c5)	// CMP zero
 			set_nz(adr = a - read_byte_zero());
 			c_flag = adr < 0x100;
 			ENDOP(3);
 
-		case 0xd5:	// CMP zero,X
+		OPCODE(d5)	// CMP zero,X
 			set_nz(adr = a - read_byte_zero_x());
 			c_flag = adr < 0x100;
 			ENDOP(4);
 
-		case 0xcd:	// CMP abs
+		OPCODE(cd)	// CMP abs
 			set_nz(adr = a - read_byte_abs());
 			c_flag = adr < 0x100;
 			ENDOP(4);
 
-		case 0xdd:	// CMP abs,X
+		OPCODE(dd)	// CMP abs,X
 			set_nz(adr = a - read_byte_abs_x());
 			c_flag = adr < 0x100;
 			ENDOP(4);
 
-		case 0xd9:	// CMP abs,Y
+		OPCODE(d9)	// CMP abs,Y
 			set_nz(adr = a - read_byte_abs_y());
 			c_flag = adr < 0x100;
 			ENDOP(4);
 
-		case 0xc1:	// CMP (ind,X)
+		OPCODE(c1)	// CMP (ind,X)
 			set_nz(adr = a - read_byte_ind_x());
 			c_flag = adr < 0x100;
 			ENDOP(6);
 
-		case 0xd1:	// CMP (ind),Y
+		OPCODE(d1)	// CMP (ind),Y
 			set_nz(adr = a - read_byte_ind_y());
 			c_flag = adr < 0x100;
 			ENDOP(5);
 
-		case 0xe0:	// CPX #imm
+		OPCODE(e0)	// CPX #imm
 			set_nz(adr = x - read_byte_imm());
 			c_flag = adr < 0x100;
 			ENDOP(2);
 
-		case 0xe4:	// CPX zero
+		OPCODE(e4)	// CPX zero
 			set_nz(adr = x - read_byte_zero());
 			c_flag = adr < 0x100;
 			ENDOP(3);
 
-		case 0xec:	// CPX abs
+		OPCODE(ec)	// CPX abs
 			set_nz(adr = x - read_byte_abs());
 			c_flag = adr < 0x100;
 			ENDOP(4);
 
-		case 0xc0:	// CPY #imm
+		OPCODE(c0)	// CPY #imm
 			set_nz(adr = y - read_byte_imm());
 			c_flag = adr < 0x100;
 			ENDOP(2);
 
-		case 0xc4:	// CPY zero
+		OPCODE(c4)	// CPY zero
 			set_nz(adr = y - read_byte_zero());
 			c_flag = adr < 0x100;
 			ENDOP(3);
 
-		case 0xcc:	// CPY abs
+		OPCODE(cc)	// CPY abs
 			set_nz(adr = y - read_byte_abs());
 			c_flag = adr < 0x100;
 			ENDOP(4);
 
 
 		// Bit-test group
-		case 0x24:	// BIT zero
+		OPCODE(24)	// BIT zero
 			z_flag = a & (tmp = read_byte_zero());
 			n_flag = tmp;
 			v_flag = tmp & 0x40;
 			ENDOP(3);
 
-		case 0x2c:	// BIT abs
+		OPCODE(2c)	// BIT abs
 			z_flag = a & (tmp = read_byte_abs());
 			n_flag = tmp;
 			v_flag = tmp & 0x40;
@@ -595,126 +706,126 @@
 
 
 		// Shift/rotate group
-		case 0x0a:	// ASL A
+		OPCODE(0a)	// ASL A
 			c_flag = a & 0x80;
 			set_nz(a <<= 1);
 			ENDOP(2);
 
-		case 0x06:	// ASL zero
+		OPCODE(06)	// ASL zero
 			tmp = read_zp(adr = read_adr_zero());
 			c_flag = tmp & 0x80;
 			write_zp(adr, set_nz(tmp << 1));
 			ENDOP(5);
 
-		case 0x16:	// ASL zero,X
+		OPCODE(16)	// ASL zero,X
 			tmp = read_zp(adr = read_adr_zero_x());
 			c_flag = tmp & 0x80;
 			write_zp(adr, set_nz(tmp << 1));
 			ENDOP(6);
 
-		case 0x0e:	// ASL abs
+		OPCODE(0e)	// ASL abs
 			tmp = read_byte(adr = read_adr_abs());
 			c_flag = tmp & 0x80;
 			write_byte(adr, set_nz(tmp << 1));
 			ENDOP(6);
 
-		case 0x1e:	// ASL abs,X
+		OPCODE(1e)	// ASL abs,X
 			tmp = read_byte(adr = read_adr_abs_x());
 			c_flag = tmp & 0x80;
 			write_byte(adr, set_nz(tmp << 1));
 			ENDOP(7);
 
-		case 0x4a:	// LSR A
+		OPCODE(4a)	// LSR A
 			c_flag = a & 0x01;
 			set_nz(a >>= 1);
 			ENDOP(2);
 
-		case 0x46:	// LSR zero
+		OPCODE(46)	// LSR zero
 			tmp = read_zp(adr = read_adr_zero());
 			c_flag = tmp & 0x01;
 			write_zp(adr, set_nz(tmp >> 1));
 			ENDOP(5);
 
-		case 0x56:	// LSR zero,X
+		OPCODE(56)	// LSR zero,X
 			tmp = read_zp(adr = read_adr_zero_x());
 			c_flag = tmp & 0x01;
 			write_zp(adr, set_nz(tmp >> 1));
 			ENDOP(6);
 
-		case 0x4e:	// LSR abs
+		OPCODE(4e)	// LSR abs
 			tmp = read_byte(adr = read_adr_abs());
 			c_flag = tmp & 0x01;
 			write_byte(adr, set_nz(tmp >> 1));
 			ENDOP(6);
 
-		case 0x5e:	// LSR abs,X
+		OPCODE(5e)	// LSR abs,X
 			tmp = read_byte(adr = read_adr_abs_x());
 			c_flag = tmp & 0x01;
 			write_byte(adr, set_nz(tmp >> 1));
 			ENDOP(7);
 
-		case 0x2a:	// ROL A
+		OPCODE(2a)	// ROL A
 			tmp2 = a & 0x80;
 			set_nz(a = c_flag ? (a << 1) | 0x01 : a << 1);
 			c_flag = tmp2;
 			ENDOP(2);
 
-		case 0x26:	// ROL zero
+		OPCODE(26)	// ROL zero
 			tmp = read_zp(adr = read_adr_zero());
 			tmp2 = tmp & 0x80;
 			write_zp(adr, set_nz(c_flag ? (tmp << 1) | 0x01 : tmp << 1));
 			c_flag = tmp2;
 			ENDOP(5);
 
-		case 0x36:	// ROL zero,X
+		OPCODE(36)	// ROL zero,X
 			tmp = read_zp(adr = read_adr_zero_x());
 			tmp2 = tmp & 0x80;
 			write_zp(adr, set_nz(c_flag ? (tmp << 1) | 0x01 : tmp << 1));
 			c_flag = tmp2;
 			ENDOP(6);
 
-		case 0x2e:	// ROL abs
+		OPCODE(2e)	// ROL abs
 			tmp = read_byte(adr = read_adr_abs());
 			tmp2 = tmp & 0x80;
 			write_byte(adr, set_nz(c_flag ? (tmp << 1) | 0x01 : tmp << 1));
 			c_flag = tmp2;
 			ENDOP(6);
 
-		case 0x3e:	// ROL abs,X
+		OPCODE(3e)	// ROL abs,X
 			tmp = read_byte(adr = read_adr_abs_x());
 			tmp2 = tmp & 0x80;
 			write_byte(adr, set_nz(c_flag ? (tmp << 1) | 0x01 : tmp << 1));
 			c_flag = tmp2;
 			ENDOP(7);
 
-		case 0x6a:	// ROR A
+		OPCODE(6a)	// ROR A
 			tmp2 = a & 0x01;
 			set_nz(a = (c_flag ? (a >> 1) | 0x80 : a >> 1));
 			c_flag = tmp2;
 			ENDOP(2);
 
-		case 0x66:	// ROR zero
+		OPCODE(66)	// ROR zero
 			tmp = read_zp(adr = read_adr_zero());
 			tmp2 = tmp & 0x01;
 			write_zp(adr, set_nz(c_flag ? (tmp >> 1) | 0x80 : tmp >> 1));
 			c_flag = tmp2;
 			ENDOP(5);
 
-		case 0x76:	// ROR zero,X
+		OPCODE(76)	// ROR zero,X
 			tmp = read_zp(adr = read_adr_zero_x());
 			tmp2 = tmp & 0x01;
 			write_zp(adr, set_nz(c_flag ? (tmp >> 1) | 0x80 : tmp >> 1));
 			c_flag = tmp2;
 			ENDOP(6);
 
-		case 0x6e:	// ROR abs
+		OPCODE(6e)	// ROR abs
 			tmp = read_byte(adr = read_adr_abs());
 			tmp2 = tmp & 0x01;
 			write_byte(adr, set_nz(c_flag ? (tmp >> 1) | 0x80 : tmp >> 1));
 			c_flag = tmp2;
 			ENDOP(6);
 
-		case 0x7e:	// ROR abs,X
+		OPCODE(7e)	// ROR abs,X
 			tmp = read_byte(adr = read_adr_abs_x());
 			tmp2 = tmp & 0x01;
 			write_byte(adr, set_nz(c_flag ? (tmp >> 1) | 0x80 : tmp >> 1));
@@ -723,19 +834,19 @@
 
 
 		// Stack group
-		case 0x48:	// PHA
+		OPCODE(48)	// PHA
 			push_byte(a);
 			ENDOP(3);
 
-		case 0x68:	// PLA
+		OPCODE(68)	// PLA
 			set_nz(a = pop_byte());
 			ENDOP(4);
 
-		case 0x08:	// PHP
+		OPCODE(08)	// PHP
 			push_flags(true);
 			ENDOP(3);
 
-		case 0x28:	// PLP
+		OPCODE(28)	// PLP
 			pop_flags();
 			if (interrupt.intr_any && !i_flag)
 				goto handle_int;
@@ -743,16 +854,16 @@
 
 
 		// Jump/branch group
-		case 0x4c:	// JMP abs
+		OPCODE(4c)	// JMP abs
 			jump(read_adr_abs());
 			ENDOP(3);
 
-		case 0x6c:	// JMP (ind)
+		OPCODE(6c)	// JMP (ind)
 			adr = read_adr_abs();
 			jump(read_byte(adr) | (read_byte((adr + 1) & 0xff | adr & 0xff00) << 8));
 			ENDOP(5);
 
-		case 0x20:	// JSR abs
+		OPCODE(20)	// JSR abs
 #if PC_IS_POINTER
 			push_byte((pc-pc_base+1) >> 8); push_byte(pc-pc_base+1);
 #else
@@ -761,12 +872,12 @@
 			jump(read_adr_abs());
 			ENDOP(6);
 
-		case 0x60:	// RTS
+		OPCODE(60)	// RTS
 			adr = pop_byte();	// Split because of pop_byte ++sp side-effect
 			jump((adr | pop_byte() << 8) + 1);
 			ENDOP(6);
 
-		case 0x40:	// RTI
+		OPCODE(40)	// RTI
 			pop_flags();
 			adr = pop_byte();	// Split because of pop_byte ++sp side-effect
 			jump(adr | pop_byte() << 8);
@@ -774,7 +885,7 @@
 				goto handle_int;
 			ENDOP(6);
 
-		case 0x00:	// BRK
+		OPCODE(00)	// BRK
 #if PC_IS_POINTER
 			push_byte((pc+1-pc_base) >> 8); push_byte(pc+1-pc_base);
 #else
@@ -813,7 +924,7 @@
 #define Branch(flag) \
 	if (flag) { \
 		uint16 old_pc = pc; \
-		pc += (int8)read_byte(pc) + 1; \
+		pc += (int8)peek_byte_imm() + 1; \
 		if ((pc ^ old_pc) & 0xff00) { \
 			ENDOP(4); \
 		} else { \
@@ -825,73 +936,73 @@
 	}
 #endif
 
-		case 0xb0:	// BCS rel
+		OPCODE(b0)	// BCS rel
 			Branch(c_flag);
 
-		case 0x90:	// BCC rel
+		OPCODE(90)	// BCC rel
 			Branch(!c_flag);
 
-		case 0xf0:	// BEQ rel
+		OPCODE(f0)	// BEQ rel
 			Branch(!z_flag);
 
-		case 0xd0:	// BNE rel
+		OPCODE(d0)	// BNE rel
 			Branch(z_flag);
 
-		case 0x70:	// BVS rel
+		OPCODE(70)	// BVS rel
 #ifndef IS_CPU_1541
 			Branch(v_flag);
 #else
 			Branch((via2_pcr & 0x0e) == 0x0e ? 1 : v_flag);	// GCR byte ready flag
 #endif
 
-		case 0x50:	// BVC rel
+		OPCODE(50)	// BVC rel
 #ifndef IS_CPU_1541
 			Branch(!v_flag);
 #else
 			Branch(!((via2_pcr & 0x0e) == 0x0e) ? 0 : v_flag);	// GCR byte ready flag
 #endif
 
-		case 0x30:	// BMI rel
+		OPCODE(30)	// BMI rel
 			Branch(n_flag & 0x80);
 
-		case 0x10:	// BPL rel
+		OPCODE(10)	// BPL rel
 			Branch(!(n_flag & 0x80));
 
 
 		// Flags group
-		case 0x38:	// SEC
+		OPCODE(38)	// SEC
 			c_flag = true;
 			ENDOP(2);
 
-		case 0x18:	// CLC
+		OPCODE(18)	// CLC
 			c_flag = false;
 			ENDOP(2);
 
-		case 0xf8:	// SED
+		OPCODE(f8)	// SED
 			d_flag = true;
 			ENDOP(2);
 
-		case 0xd8:	// CLD
+		OPCODE(d8)	// CLD
 			d_flag = false;
 			ENDOP(2);
 
-		case 0x78:	// SEI
+		OPCODE(78)	// SEI
 			i_flag = true;
 			ENDOP(2);
 
-		case 0x58:	// CLI
+		OPCODE(58)	// CLI
 			i_flag = false;
 			if (interrupt.intr_any)
 				goto handle_int;
 			ENDOP(2);
 
-		case 0xb8:	// CLV
+		OPCODE(b8)	// CLV
 			v_flag = false;
 			ENDOP(2);
 
 
 		// NOP group
-		case 0xea:	// NOP
+		OPCODE(ea)	// NOP
 			ENDOP(2);
 
 
@@ -900,47 +1011,47 @@
  */
 
 		// NOP group
-		case 0x1a:	// NOP
-		case 0x3a:
-		case 0x5a:
-		case 0x7a:
-		case 0xda:
-		case 0xfa:
+		OPCODE(1a)	// NOP
+		OPCODE(3a)
+		OPCODE(5a)
+		OPCODE(7a)
+		OPCODE(da)
+		OPCODE(fa)
 			ENDOP(2);
 
-		case 0x80:	// NOP #imm
-		case 0x82:
-		case 0x89:
-		case 0xc2:
-		case 0xe2:
+		OPCODE(80)	// NOP #imm
+		OPCODE(82)
+		OPCODE(89)
+		OPCODE(c2)
+		OPCODE(e2)
 			pc++;
 			ENDOP(2);
 
-		case 0x04:	// NOP zero
-		case 0x44:
-		case 0x64:
+		OPCODE(04)	// NOP zero
+		OPCODE(44)
+		OPCODE(64)
 			pc++;
 			ENDOP(3);
 
-		case 0x14:	// NOP zero,X
-		case 0x34:
-		case 0x54:
-		case 0x74:
-		case 0xd4:
-		case 0xf4:
+		OPCODE(14)	// NOP zero,X
+		OPCODE(34)
+		OPCODE(54)
+		OPCODE(74)
+		OPCODE(d4)
+		OPCODE(f4)
 			pc++;
 			ENDOP(4);
 
-		case 0x0c:	// NOP abs
+		OPCODE(0c)	// NOP abs
 			pc+=2;
 			ENDOP(4);
 
-		case 0x1c:	// NOP abs,X
-		case 0x3c:
-		case 0x5c:
-		case 0x7c:
-		case 0xdc:
-		case 0xfc:
+		OPCODE(1c)	// NOP abs,X
+		OPCODE(3c)
+		OPCODE(5c)
+		OPCODE(7c)
+		OPCODE(dc)
+		OPCODE(fc)
 #if PRECISE_CPU_CYCLES
 			read_byte_abs_x();
 #else
@@ -950,45 +1061,45 @@
 
 
 		// Load A/X group
-		case 0xa7:	// LAX zero
+		OPCODE(a7)	// LAX zero
 			set_nz(a = x = read_byte_zero());
 			ENDOP(3);
 
-		case 0xb7:	// LAX zero,Y
+		OPCODE(b7)	// LAX zero,Y
 			set_nz(a = x = read_byte_zero_y());
 			ENDOP(4);
 
-		case 0xaf:	// LAX abs
+		OPCODE(af)	// LAX abs
 			set_nz(a = x = read_byte_abs());
 			ENDOP(4);
 
-		case 0xbf:	// LAX abs,Y
+		OPCODE(bf)	// LAX abs,Y
 			set_nz(a = x = read_byte_abs_y());
 			ENDOP(4);
 
-		case 0xa3:	// LAX (ind,X)
+		OPCODE(a3)	// LAX (ind,X)
 			set_nz(a = x = read_byte_ind_x());
 			ENDOP(6);
 
-		case 0xb3:	// LAX (ind),Y
+		OPCODE(b3)	// LAX (ind),Y
 			set_nz(a = x = read_byte_ind_y());
 			ENDOP(5);
 
 
 		// Store A/X group
-		case 0x87:	// SAX zero
+		OPCODE(87)	// SAX zero
 			write_byte(read_adr_zero(), a & x);
 			ENDOP(3);
 
-		case 0x97:	// SAX zero,Y
+		OPCODE(97)	// SAX zero,Y
 			write_byte(read_adr_zero_y(), a & x);
 			ENDOP(4);
 
-		case 0x8f:	// SAX abs
+		OPCODE(8f)	// SAX abs
 			write_byte(read_adr_abs(), a & x);
 			ENDOP(4);
 
-		case 0x83:	// SAX (ind,X)
+		OPCODE(83)	// SAX (ind,X)
 			write_byte(read_adr_ind_x(), a & x);
 			ENDOP(6);
 
@@ -999,43 +1110,43 @@
 	tmp <<= 1; \
 	set_nz(a |= tmp);
 
-		case 0x07:	// SLO zero
+		OPCODE(07)	// SLO zero
 			tmp = read_zp(adr = read_adr_zero());
 			ShiftLeftOr;
 			write_zp(adr, tmp);
 			ENDOP(5);
 
-		case 0x17:	// SLO zero,X
+		OPCODE(17)	// SLO zero,X
 			tmp = read_zp(adr = read_adr_zero_x());
 			ShiftLeftOr;
 			write_zp(adr, tmp);
 			ENDOP(6);
 
-		case 0x0f:	// SLO abs
+		OPCODE(0f)	// SLO abs
 			tmp = read_byte(adr = read_adr_abs());
 			ShiftLeftOr;
 			write_byte(adr, tmp);
 			ENDOP(6);
 
-		case 0x1f:	// SLO abs,X
+		OPCODE(1f)	// SLO abs,X
 			tmp = read_byte(adr = read_adr_abs_x());
 			ShiftLeftOr;
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0x1b:	// SLO abs,Y
+		OPCODE(1b)	// SLO abs,Y
 			tmp = read_byte(adr = read_adr_abs_y());
 			ShiftLeftOr;
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0x03:	// SLO (ind,X)
+		OPCODE(03)	// SLO (ind,X)
 			tmp = read_byte(adr = read_adr_ind_x());
 			ShiftLeftOr;
 			write_byte(adr, tmp);
 			ENDOP(8);
 
-		case 0x13:	// SLO (ind),Y
+		OPCODE(13)	// SLO (ind),Y
 			tmp = read_byte(adr = read_adr_ind_y());
 			ShiftLeftOr;
 			write_byte(adr, tmp);
@@ -1049,43 +1160,43 @@
 	set_nz(a &= tmp); \
 	c_flag = tmp2;
 
-		case 0x27:	// RLA zero
+		OPCODE(27)	// RLA zero
 			tmp = read_zp(adr = read_adr_zero());
 			RoLeftAnd;
 			write_zp(adr, tmp);
 			ENDOP(5);
 
-		case 0x37:	// RLA zero,X
+		OPCODE(37)	// RLA zero,X
 			tmp = read_zp(adr = read_adr_zero_x());
 			RoLeftAnd;
 			write_zp(adr, tmp);
 			ENDOP(6);
 
-		case 0x2f:	// RLA abs
+		OPCODE(2f)	// RLA abs
 			tmp = read_byte(adr = read_adr_abs());
 			RoLeftAnd;
 			write_byte(adr, tmp);
 			ENDOP(6);
 
-		case 0x3f:	// RLA abs,X
+		OPCODE(3f)	// RLA abs,X
 			tmp = read_byte(adr = read_adr_abs_x());
 			RoLeftAnd;
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0x3b:	// RLA abs,Y
+		OPCODE(3b)	// RLA abs,Y
 			tmp = read_byte(adr = read_adr_abs_y());
 			RoLeftAnd;
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0x23:	// RLA (ind,X)
+		OPCODE(23)	// RLA (ind,X)
 			tmp = read_byte(adr = read_adr_ind_x());
 			RoLeftAnd;
 			write_byte(adr, tmp);
 			ENDOP(8);
 
-		case 0x33:	// RLA (ind),Y
+		OPCODE(33)	// RLA (ind),Y
 			tmp = read_byte(adr = read_adr_ind_y());
 			RoLeftAnd;
 			write_byte(adr, tmp);
@@ -1098,43 +1209,43 @@
 	tmp >>= 1; \
 	set_nz(a ^= tmp);
 
-		case 0x47:	// SRE zero
+		OPCODE(47)	// SRE zero
 			tmp = read_zp(adr = read_adr_zero());
 			ShiftRightEor;
 			write_zp(adr, tmp);
 			ENDOP(5);
 
-		case 0x57:	// SRE zero,X
+		OPCODE(57)	// SRE zero,X
 			tmp = read_zp(adr = read_adr_zero_x());
 			ShiftRightEor;
 			write_zp(adr, tmp);
 			ENDOP(6);
 
-		case 0x4f:	// SRE abs
+		OPCODE(4f)	// SRE abs
 			tmp = read_byte(adr = read_adr_abs());
 			ShiftRightEor;
 			write_byte(adr, tmp);
 			ENDOP(6);
 
-		case 0x5f:	// SRE abs,X
+		OPCODE(5f)	// SRE abs,X
 			tmp = read_byte(adr = read_adr_abs_x());
 			ShiftRightEor;
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0x5b:	// SRE abs,Y
+		OPCODE(5b)	// SRE abs,Y
 			tmp = read_byte(adr = read_adr_abs_y());
 			ShiftRightEor;
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0x43:	// SRE (ind,X)
+		OPCODE(43)	// SRE (ind,X)
 			tmp = read_byte(adr = read_adr_ind_x());
 			ShiftRightEor;
 			write_byte(adr, tmp);
 			ENDOP(8);
 
-		case 0x53:	// SRE (ind),Y
+		OPCODE(53)	// SRE (ind),Y
 			tmp = read_byte(adr = read_adr_ind_y());
 			ShiftRightEor;
 			write_byte(adr, tmp);
@@ -1148,43 +1259,43 @@
 	c_flag = tmp2; \
 	do_adc(tmp);
 
-		case 0x67:	// RRA zero
+		OPCODE(67)	// RRA zero
 			tmp = read_zp(adr = read_adr_zero());
 			RoRightAdc;
 			write_zp(adr, tmp);
 			ENDOP(5);
 
-		case 0x77:	// RRA zero,X
+		OPCODE(77)	// RRA zero,X
 			tmp = read_zp(adr = read_adr_zero_x());
 			RoRightAdc;
 			write_zp(adr, tmp);
 			ENDOP(6);
 
-		case 0x6f:	// RRA abs
+		OPCODE(6f)	// RRA abs
 			tmp = read_byte(adr = read_adr_abs());
 			RoRightAdc;
 			write_byte(adr, tmp);
 			ENDOP(6);
 
-		case 0x7f:	// RRA abs,X
+		OPCODE(7f)	// RRA abs,X
 			tmp = read_byte(adr = read_adr_abs_x());
 			RoRightAdc;
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0x7b:	// RRA abs,Y
+		OPCODE(7b)	// RRA abs,Y
 			tmp = read_byte(adr = read_adr_abs_y());
 			RoRightAdc;
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0x63:	// RRA (ind,X)
+		OPCODE(63)	// RRA (ind,X)
 			tmp = read_byte(adr = read_adr_ind_x());
 			RoRightAdc;
 			write_byte(adr, tmp);
 			ENDOP(8);
 
-		case 0x73:	// RRA (ind),Y
+		OPCODE(73)	// RRA (ind),Y
 			tmp = read_byte(adr = read_adr_ind_y());
 			RoRightAdc;
 			write_byte(adr, tmp);
@@ -1196,43 +1307,43 @@
 	set_nz(adr = a - tmp); \
 	c_flag = adr < 0x100;
 
-		case 0xc7:	// DCP zero
+		OPCODE(c7)	// DCP zero
 			tmp = read_zp(adr = read_adr_zero()) - 1;
 			write_zp(adr, tmp);
 			DecCompare;
 			ENDOP(5);
 
-		case 0xd7:	// DCP zero,X
+		OPCODE(d7)	// DCP zero,X
 			tmp = read_zp(adr = read_adr_zero_x()) - 1;
 			write_zp(adr, tmp);
 			DecCompare;
 			ENDOP(6);
 
-		case 0xcf:	// DCP abs
+		OPCODE(cf)	// DCP abs
 			tmp = read_byte(adr = read_adr_abs()) - 1;
 			write_byte(adr, tmp);
 			DecCompare;
 			ENDOP(6);
 
-		case 0xdf:	// DCP abs,X
+		OPCODE(df)	// DCP abs,X
 			tmp = read_byte(adr = read_adr_abs_x()) - 1;
 			write_byte(adr, tmp);
 			DecCompare;
 			ENDOP(7);
 
-		case 0xdb:	// DCP abs,Y
+		OPCODE(db)	// DCP abs,Y
 			tmp = read_byte(adr = read_adr_abs_y()) - 1;
 			write_byte(adr, tmp);
 			DecCompare;
 			ENDOP(7);
 
-		case 0xc3:	// DCP (ind,X)
+		OPCODE(c3)	// DCP (ind,X)
 			tmp = read_byte(adr = read_adr_ind_x()) - 1;
 			write_byte(adr, tmp);
 			DecCompare;
 			ENDOP(8);
 
-		case 0xd3:	// DCP (ind),Y
+		OPCODE(d3)	// DCP (ind),Y
 			tmp = read_byte(adr = read_adr_ind_y()) - 1;
 			write_byte(adr, tmp);
 			DecCompare;
@@ -1240,43 +1351,43 @@
 
 
 		// INC/SBC group
-		case 0xe7:	// ISB zero
+		OPCODE(e7)	// ISB zero
 			tmp = read_zp(adr = read_adr_zero()) + 1;
 			do_sbc(tmp);
 			write_zp(adr, tmp);
 			ENDOP(5);
 
-		case 0xf7:	// ISB zero,X
+		OPCODE(f7)	// ISB zero,X
 			tmp = read_zp(adr = read_adr_zero_x()) + 1;
 			do_sbc(tmp);
 			write_zp(adr, tmp);
 			ENDOP(6);
 
-		case 0xef:	// ISB abs
+		OPCODE(ef)	// ISB abs
 			tmp = read_byte(adr = read_adr_abs()) + 1;
 			do_sbc(tmp);
 			write_byte(adr, tmp);
 			ENDOP(6);
 
-		case 0xff:	// ISB abs,X
+		OPCODE(ff)	// ISB abs,X
 			tmp = read_byte(adr = read_adr_abs_x()) + 1;
 			do_sbc(tmp);
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0xfb:	// ISB abs,Y
+		OPCODE(fb)	// ISB abs,Y
 			tmp = read_byte(adr = read_adr_abs_y()) + 1;
 			do_sbc(tmp);
 			write_byte(adr, tmp);
 			ENDOP(7);
 
-		case 0xe3:	// ISB (ind,X)
+		OPCODE(e3)	// ISB (ind,X)
 			tmp = read_byte(adr = read_adr_ind_x()) + 1;
 			do_sbc(tmp);
 			write_byte(adr, tmp);
 			ENDOP(8);
 
-		case 0xf3:	// ISB (ind),Y
+		OPCODE(f3)	// ISB (ind),Y
 			tmp = read_byte(adr = read_adr_ind_y()) + 1;
 			do_sbc(tmp);
 			write_byte(adr, tmp);
@@ -1284,19 +1395,19 @@
 
 
 		// Complex functions
-		case 0x0b:	// ANC #imm
-		case 0x2b:
+		OPCODE(0b)	// ANC #imm
+		OPCODE(2b)
 			set_nz(a &= read_byte_imm());
 			c_flag = n_flag & 0x80;
 			ENDOP(2);
 
-		case 0x4b:	// ASR #imm
+		OPCODE(4b)	// ASR #imm
 			a &= read_byte_imm();
 			c_flag = a & 0x01;
 			set_nz(a >>= 1);
 			ENDOP(2);
 
-		case 0x6b:	// ARR #imm
+		OPCODE(6b)	// ARR #imm
 			tmp2 = read_byte_imm() & a;
 			a = (c_flag ? (tmp2 >> 1) | 0x80 : tmp2 >> 1);
 			if (!d_flag) {
@@ -1314,11 +1425,11 @@
 			}
 			ENDOP(2);
 
-		case 0x8b:	// ANE #imm
+		OPCODE(8b)	// ANE #imm
 			set_nz(a = read_byte_imm() & x & (a | 0xee));
 			ENDOP(2);
 
-		case 0x93:	// SHA (ind),Y
+		OPCODE(93)	// SHA (ind),Y
 #if PC_IS_POINTER
 			tmp2 = read_zp(pc[0] + 1);
 #else
@@ -1327,7 +1438,7 @@
 			write_byte(read_adr_ind_y(), a & x & (tmp2+1));
 			ENDOP(6);
 
-		case 0x9b:	// SHS abs,Y
+		OPCODE(9b)	// SHS abs,Y
 #if PC_IS_POINTER
 			tmp2 = pc[1];
 #else
@@ -1337,7 +1448,7 @@
 			sp = a & x;
 			ENDOP(5);
 
-		case 0x9c:	// SHY abs,X
+		OPCODE(9c)	// SHY abs,X
 #if PC_IS_POINTER
 			tmp2 = pc[1];
 #else
@@ -1346,7 +1457,7 @@
 			write_byte(read_adr_abs_x(), y & (tmp2+1));
 			ENDOP(5);
 
-		case 0x9e:	// SHX abs,Y
+		OPCODE(9e)	// SHX abs,Y
 #if PC_IS_POINTER
 			tmp2 = pc[1];
 #else
@@ -1355,7 +1466,7 @@
 			write_byte(read_adr_abs_y(), x & (tmp2+1));
 			ENDOP(5);
 
-		case 0x9f:	// SHA abs,Y
+		OPCODE(9f)	// SHA abs,Y
 #if PC_IS_POINTER
 			tmp2 = pc[1];
 #else
@@ -1364,32 +1475,32 @@
 			write_byte(read_adr_abs_y(), a & x & (tmp2+1));
 			ENDOP(5);
 
-		case 0xab:	// LXA #imm
+		OPCODE(ab)	// LXA #imm
 			set_nz(a = x = (a | 0xee) & read_byte_imm());
 			ENDOP(2);
 
-		case 0xbb:	// LAS abs,Y
+		OPCODE(bb)	// LAS abs,Y
 			set_nz(a = x = sp = read_byte_abs_y() & sp);
 			ENDOP(4);
 
-		case 0xcb:	// SBX #imm
+		OPCODE(cb)	// SBX #imm
 			x &= a;
 			adr = x - read_byte_imm();
 			c_flag = adr < 0x100;
 			set_nz(x = adr);
 			ENDOP(2);
 
-		case 0x02:
-		case 0x12:
-		case 0x22:
-		case 0x32:
-		case 0x42:
-		case 0x52:
-		case 0x62:
-		case 0x72:
-		case 0x92:
-		case 0xb2:
-		case 0xd2:
+		OPCODE(02)
+		OPCODE(12)
+		OPCODE(22)
+		OPCODE(32)
+		OPCODE(42)
+		OPCODE(52)
+		OPCODE(62)
+		OPCODE(72)
+		OPCODE(92)
+		OPCODE(b2)
+		OPCODE(d2)
 #if PC_IS_POINTER
 			illegal_op(*(pc-1), pc-pc_base-1);
 #else
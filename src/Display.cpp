@@ -13,12 +13,14 @@
 #include "Input.h"
 #include "Prefs.h"
 #include "SAM.h"
-#include "osd.h"
 #include "virtual_joystick.h"
+#include "resources.h"
+#if USE_OPENGL
+#include "osd.h"
 #include "renderer.h"
 #include "texture.h"
 #include "font.h"
-#include "resources.h"
+#endif
 
 extern bool run_async_emulation;
 extern bool limitFramerate;
@@ -47,11 +49,7 @@ int toolbarHeight = 40;
 int toolbarWidgetWidth = 50;
 
 // Display surface
-static SDL_Surface *physicalScreen = NULL;
-
-// For LED error blinking
-static C64Display *c64_disp;
-static Uint32 lastLEDUpdate = 0;
+static SDL_Surface *physicalScreen = NULL;	// SDL 1.2 has a single video surface per process
 
 // LED states
 enum {
@@ -107,8 +105,50 @@ enum {
 	PALETTE_SIZE = 21
 };
 
-SDL_Color palette[PALETTE_SIZE];
-uint32 rgba_palette[PALETTE_SIZE];
+// C64 colors and speedometer/LED colors, as SDL colors and OpenGL RGBA
+struct c64_palette_t
+{
+    SDL_Color sdl[PALETTE_SIZE];
+    uint32 rgba[PALETTE_SIZE];
+};
+
+static c64_palette_t build_palette()
+{
+    c64_palette_t p;
+    memset(&p, 0, sizeof(p));
+    SDL_Color *palette = p.sdl;
+
+	for (int i=0; i<16; i++) 
+    {
+		palette[i].r = palette_red[i];
+		palette[i].g = palette_green[i];
+		palette[i].b = palette_blue[i];
+	}
+
+	palette[fill_gray].r    = palette[fill_gray].g      = palette[fill_gray].b   = 0xd0;
+	palette[shine_gray].r   = palette[shine_gray].g     = palette[shine_gray].b  = 0xf0;
+	palette[shadow_gray].r  = palette[shadow_gray].g    = palette[shadow_gray].b = 0x80;
+	palette[red].r          = 0xf0;
+	palette[red].g          = palette[red].b            = 0;
+	palette[green].g        = 0xf0;
+	palette[green].r        = palette[green].b          = 0;
+
+    for (int i=0; i<PALETTE_SIZE; i++)
+    {
+        // precompute openGl rgba palette
+        p.rgba[i] = 0xff000000|((uint32)palette[i].b<<16) | ((uint32)palette[i].g << 8) | ((uint32)palette[i].r);
+    }
+    return p;
+}
+
+// Shared by all displays and read-only once built; the function-local
+// static is initialized exactly once, even with several displays being
+// constructed on different threads
+static const c64_palette_t& c64_palette()
+{
+    static const c64_palette_t palette = build_palette();
+    return palette;
+}
 
 /*
   C64 keyboard matrix:
@@ -136,7 +176,9 @@ C64Display::C64Display(C64 *the_c64) : TheC64(the_c64)
 	speedometer_string[0] = 0;
 
     // opengl renderer
-    renderer = NULL;
+    #if USE_OPENGL
+        renderer = NULL;
+    #endif
     lastDrawTime = 0;
     antialiasing = false;
 
@@ -150,15 +192,25 @@ C64Display::C64Display(C64 *the_c64) : TheC64(the_c64)
     }
 
 	// Start timer for LED error blinking
-	c64_disp = this;
 
     osd = NULL;
+    headless = false;
+
+    memset(buffers, 0, sizeof(buffers));
+    backIndex = 0;
+    midState = 1;
+    frontIndex = 2;
+
+    rowChanged = NULL;
+    textureDirty = NULL;
+    frameSequence = shownSequence = textureSequence = 0;
+    droppedFrames = duplicatedFrames = 0;
+    speedometerDropped = speedometerDuplicated = 0;
 
     framesPerSecond = 0;
     frameCounter = 0;
 
     backgroundInvalid = true;
-    invalidated = true;
 }
 
 /*
@@ -167,77 +219,81 @@ C64Display::C64Display(C64 *the_c64) : TheC64(the_c64)
 
 C64Display::~C64Display()
 {
-    if (NULL != renderer)
-    {
-        doFreeGL();
-        renderer->shutdown();
-        delete renderer;
-        renderer = NULL;
-    }
-
-    if (NULL != back_buffer)
-    {
-        delete [] back_buffer;
-        back_buffer = NULL;
-    }
-
-    if (NULL != mid_buffer)
-    {
-        delete [] mid_buffer;
-        mid_buffer = NULL;
-    }
+    #if USE_OPENGL
+        if (NULL != renderer)
+        {
+            doFreeGL();
+            renderer->shutdown();
+            delete renderer;
+            renderer = NULL;
+        }
+    #endif
 
-    if (NULL != front_buffer)
+    for (int i=0; i<3; i++)
     {
-        delete [] front_buffer;
-        front_buffer = NULL;
+        delete [] buffers[i].pixels;
+        delete [] buffers[i].dirty;
+        delete [] buffers[i].changed;
+        buffers[i].pixels = NULL;
+        buffers[i].dirty = NULL;
+        buffers[i].changed = NULL;
     }
 
-    if (NULL != bufferLock)
-    {
-        SDL_DestroyMutex(bufferLock);
-        bufferLock = NULL;
-    }
+    delete [] rowChanged;
+    rowChanged = NULL;
+    delete [] textureDirty;
+    textureDirty = NULL;
 
-    if (NULL != osd)
-    {
-        delete osd;
-        osd = NULL;
-    }
+    #if USE_OPENGL
+        if (NULL != osd)
+        {
+            delete osd;
+            osd = NULL;
+        }
+    #endif
 
 }
 
 bool C64Display::init()
 {
-	// Open window
-    
-    #ifdef WEBOS
+    headless = TheC64->isHeadless();
 
-        #if USE_OPENGL
-            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 1);
-	        physicalScreen = SDL_SetVideoMode(0, 0, 0, SDL_OPENGL);
-        #else
-	        physicalScreen = SDL_SetVideoMode(0, 0, bitsPerPixel, 0);
-        #endif
+	// Open window (headless mode renders into the buffers only)
 
-    #else
-        SDL_WM_SetCaption(VERSION_STRING, "Frodo");
+    if (headless)
+    {
+        physicalScreen = NULL;
+    }
+    else
+    {
+        #ifdef WEBOS
+
+            #if USE_OPENGL
+                SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 1);
+    	        physicalScreen = SDL_SetVideoMode(0, 0, 0, SDL_OPENGL);
+            #else
+    	        physicalScreen = SDL_SetVideoMode(0, 0, bitsPerPixel, 0);
+            #endif
 
-        #if USE_OPENGL
-    	    physicalScreen = SDL_SetVideoMode(initialWidth,
-                                              initialHeight,
-                                              32,
-                                              SDL_HWSURFACE|SDL_GL_DOUBLEBUFFER|SDL_OPENGL);
         #else
-    	    physicalScreen = SDL_SetVideoMode(initialWidth,
-                                              initialHeight,
-                                              bitsPerPixel,
-                                              SDL_HWSURFACE|SDL_DOUBLEBUF|SDL_RESIZABLE);
-        #endif
+            SDL_WM_SetCaption(VERSION_STRING, "Frodo");
+
+            #if USE_OPENGL
+        	    physicalScreen = SDL_SetVideoMode(initialWidth,
+                                                  initialHeight,
+                                                  32,
+                                                  SDL_HWSURFACE|SDL_GL_DOUBLEBUFFER|SDL_OPENGL);
+            #else
+        	    physicalScreen = SDL_SetVideoMode(initialWidth,
+                                                  initialHeight,
+                                                  bitsPerPixel,
+                                                  SDL_HWSURFACE|SDL_DOUBLEBUF|SDL_RESIZABLE);
+            #endif
 
-	#endif
+    	#endif
+    }
 
-    if (NULL == physicalScreen) 
+    if (NULL == physicalScreen && !headless)
     {
         fprintf(stderr, "Couldn't initialize physical SDL screen (%s)\n", SDL_GetError());
         return 0;
@@ -245,32 +301,42 @@ bool C64Display::init()
 
     bufferWidth         = DISPLAY_X;
     bufferHeight        = DISPLAY_Y;
-    bufferBitsPerPixel  = bitsPerPixel;
-    bufferPitch         = DISPLAY_X * bitsPerPixel / 8;
+    bufferBitsPerPixel  = rgba_output ? 32 : bitsPerPixel;
+    bufferPitch         = DISPLAY_X * bufferBitsPerPixel / 8;
     bufferSize          = bufferPitch * bufferHeight;
 
     viewX = 0.0f; viewY = 0.0f; viewW = -1.0f; viewH = -1.0f;
 
-    front_buffer        = new uint8[bufferSize];
-    back_buffer         = new uint8[bufferSize];
-    mid_buffer          = new uint8[bufferSize];
-
-    if (NULL == front_buffer || NULL == back_buffer || NULL == mid_buffer) 
+    for (int i=0; i<3; i++)
     {
-        fprintf(stderr, "Couldn't initialize buffers\n");
-        return false;
+        buffers[i].pixels   = new uint8[bufferSize];
+        buffers[i].dirty    = new uint8[bufferHeight];
+        buffers[i].changed  = new uint32[bufferHeight];
+
+        if (NULL == buffers[i].pixels || NULL == buffers[i].dirty || NULL == buffers[i].changed)
+        {
+            fprintf(stderr, "Couldn't initialize buffers\n");
+            return false;
+        }
+
+        memset(buffers[i].pixels, 0, bufferSize);
+
+        // all rows are dirty unless the VIC reports unchanged ones
+        memset(buffers[i].dirty, 1, bufferHeight);
+        memset(buffers[i].changed, 0, bufferHeight * sizeof(uint32));
+        buffers[i].sequence = 0;
     }
 
-    bufferLock = SDL_CreateMutex();
-    if (NULL == bufferLock)
+    rowChanged          = new uint32[bufferHeight];
+    textureDirty        = new uint8[bufferHeight];
+
+    if (NULL == rowChanged || NULL == textureDirty)
     {
-        fprintf(stderr, "Couldn't initialize buffer lock (%s)\n", SDL_GetError());
+        fprintf(stderr, "Couldn't initialize buffers\n");
         return false;
     }
 
-    memset(front_buffer, 0, bufferSize);
-    memset(back_buffer,  0, bufferSize);
-    memset(mid_buffer,   0, bufferSize);
+    memset(rowChanged, 0, bufferHeight * sizeof(uint32));
 
     statusText = "";
     statusTextTimeout = 0.0f;
@@ -278,9 +344,12 @@ bool C64Display::init()
     InitColors(NULL);
 
     #if USE_OPENGL
-        renderer = new Renderer();
-        renderer->init(physicalScreen->w, physicalScreen->h);
-        doInitGL();
+        if (!headless)
+        {
+            renderer = new Renderer();
+            renderer->init(physicalScreen->w, physicalScreen->h);
+            doInitGL();
+        }
     #endif
 
     return true;
@@ -290,10 +359,12 @@ void C64Display::setAntialiasing(bool antialiasing)
 {
     this->antialiasing = antialiasing;
 
-    if (NULL != res.screenTexture)
-    {
-        res.screenTexture->setAntialias(antialiasing);
-    }
+    #if USE_OPENGL
+        if (NULL != res.screenTexture)
+        {
+            res.screenTexture->setAntialias(antialiasing);
+        }
+    #endif
 }
 
 bool C64Display::getAntialiasing() const
@@ -315,57 +386,84 @@ void C64Display::NewPrefs(Prefs *prefs)
 
 void C64Display::Update()
 {
-    //if (invalidated) printf("STILL INVALID!\n");
-    if (run_async_emulation)
+    if (run_async_emulation && swapBuffers)
     {
-        if (swapBuffers)
-        { // make mid buffer to back buffer for input
-            if (-1 != SDL_LockMutex(bufferLock))
-            {
-                uint8* swap_ptr = back_buffer;
-                back_buffer = mid_buffer;
-                mid_buffer = swap_ptr;
+        frame_buffer_t* frame = &buffers[backIndex];
 
-                SDL_UnlockMutex(bufferLock);
+        frame->sequence = ++frameSequence;
+        for (int i=0; i<bufferHeight; i++)
+        {
+            if (frame->dirty[i])
+            {
+                rowChanged[i] = frameSequence;
             }
         }
+        memcpy(frame->changed, rowChanged, bufferHeight * sizeof(uint32));
 
-        invalidated = true;
+        // make back buffer to mid buffer and continue with the old mid
+        // buffer, whether it was shown or not (never waits for the renderer)
+        backIndex = atomic_swap32(&midState, backIndex | MID_FRESH) & MID_INDEX;
     }
 }
 
 void C64Display::redraw()
 {
-    if (!invalidated && !TheC64->isPaused() && limitFramerate)
+    if (headless)
     {
         return;
     }
 
-    if (invalidated && swapBuffers)
-    { // make mid buffer to front buffer for display
-        if (-1 != SDL_LockMutex(bufferLock))
+    if (!swapFrontBuffer())
+    {
+        if (!TheC64->isPaused() && limitFramerate)
         {
-            uint8* swap_ptr = front_buffer;
-            front_buffer = mid_buffer;
-            mid_buffer = swap_ptr;
-
-            SDL_UnlockMutex(bufferLock);
+            return;
         }
-    }
 
-    invalidated = false;
+        duplicatedFrames++;
+    }
 
     #if USE_OPENGL
         doRedrawGL();
-    #else
-        doRedraw();
     #endif
     
 }
 
+/*
+ *  Make the newest completed frame the front buffer, returns false if
+ *  there was no new frame since the last call (render thread only)
+ */
+
+bool C64Display::swapFrontBuffer()
+{
+    if (!swapBuffers || !(atomic_load32(&midState) & MID_FRESH))
+    {
+        return false;
+    }
+
+    // only this thread clears MID_FRESH, so the mid buffer is still new
+    frontIndex = atomic_swap32(&midState, frontIndex) & MID_INDEX;
+
+    uint32 sequence = buffers[frontIndex].sequence;
+    if (shownSequence > 0)
+    {
+        droppedFrames += sequence - shownSequence - 1;
+    }
+    shownSequence = sequence;
+
+    return true;
+}
+
+#if USE_OPENGL
 void C64Display::doInitGL()
 {
-    res.screenTexture           = new Texture(bufferWidth, bufferHeight, 32);
+    // 8 bit frames are uploaded as they are and colored by a shader,
+    // where that is not available they are converted to RGBA
+    res.screenTexture           = new Texture();
+    if (8 != bufferBitsPerPixel || !res.screenTexture->createIndexed(bufferWidth, bufferHeight, c64_palette().rgba, 16))
+    {
+        res.screenTexture->create(bufferWidth, bufferHeight, 32);
+    }
     res.screenTexture->setAntialias(antialiasing);
 
     res.backgroundTexture       = new Texture(RES_BACKGROUND);
@@ -523,20 +621,28 @@ void C64Display::drawScreen()
 
     res.screenTexture->bind();
 
+    // upload only the rows that changed since the frame in the texture
+    frame_buffer_t* frame = &buffers[frontIndex];
+    for (int i=0; i<bufferHeight; i++)
+    {
+        textureDirty[i] = (textureSequence == 0 || (int32) (frame->changed[i] - textureSequence) > 0);
+    }
+    textureSequence = frame->sequence;
+
     if (res.screenTexture->getBitsPerPixel() != bufferBitsPerPixel)
     {
-        res.screenTexture->updateData(front_buffer, bufferBitsPerPixel, rgba_palette);
+        res.screenTexture->updateData(frame->pixels, bufferBitsPerPixel, c64_palette().rgba, textureDirty);
     }
     else
     {
-        res.screenTexture->updateData(front_buffer);
+        res.screenTexture->updateData(frame->pixels, textureDirty);
     }
 
-    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-    //renderer->fillRectangle(outX, outY, outW, outH);
-    renderer->fillRectangle(viewX, viewY, viewW, viewH);
-
     res.screenTexture->unbind();
+
+    renderer->setColor(1.0f, 1.0f, 1.0f, 1.0f);
+    //renderer->drawTexture(res.screenTexture, outX, outY, outW, outH);
+    renderer->drawTexture(res.screenTexture, viewX, viewY, viewW, viewH);
 }
 
 void C64Display::drawVirtualJoystick()
@@ -544,6 +650,8 @@ void C64Display::drawVirtualJoystick()
     TheC64->TheJoystick->draw(renderer, &res);
 }
 
+#endif
+
 void C64Display::setStatusMessage(const std::string& message, float timeOut)
 {
     statusText = message;
@@ -552,13 +660,14 @@ void C64Display::setStatusMessage(const std::string& message, float timeOut)
     statusTextTimeout = timeOut;
 }
 
+#if USE_OPENGL
 void C64Display::drawStatusBar()
 {
     int width = getWidth();
     int height = getHeight();
 
     renderer->setFont(res.fontTiny);
-    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    renderer->setColor(1.0f, 1.0f, 1.0f, 1.0f);
 
     int textPos = 8;
 
@@ -589,7 +698,15 @@ void C64Display::drawStatusBar()
                            speedometer_string,
                            Renderer::ALIGN_BOTTOM);
 
-        textPos += 100;
+        textPos += 240;
+
+        #ifdef PROFILING
+            renderer->drawText(textPos, height-6,
+                               TheC64->profiler.getStatusText(),
+                               Renderer::ALIGN_BOTTOM);
+
+            textPos += 300;
+        #endif
     }
 
     if (statusTextTimeout > 0.0f)
@@ -613,7 +730,7 @@ void C64Display::drawAbout()
 
     int ofs = (clientWidth - width) / 2;
 
-    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    renderer->setColor(1.0f, 1.0f, 1.0f, 1.0f);
 
     renderer->drawTiledTexture(res.backgroundTexture, ofs, (getHeight()-height)/2, width, height);
 
@@ -636,6 +753,7 @@ void C64Display::drawAbout()
     //renderer->setFont(res.fontTiny);
     //renderer->drawText(ofs+20, (getHeight()-height)/2 + height - 5 - res.fontTiny->getHeight(), "v1.0.4", Renderer::ALIGN_BOTTOM);
 }
+#endif
 
 void C64Display::showAbout(bool show)
 {
@@ -661,13 +779,13 @@ void C64Display::update_led_blinking()
 {
 	for (int i=0; i<4; i++)
     {
-		switch (c64_disp->led_state[i]) 
+		switch (led_state[i]) 
         {
 			case LED_ERROR_ON:
-				c64_disp->led_state[i] = LED_ERROR_OFF;
+				led_state[i] = LED_ERROR_OFF;
 				break;
 			case LED_ERROR_OFF:
-				c64_disp->led_state[i] = LED_ERROR_ON;
+				led_state[i] = LED_ERROR_ON;
 				break;
             default:
                 break;
@@ -679,26 +797,41 @@ void C64Display::update_led_blinking()
  *  Draw speedometer
  */
 
-void C64Display::Speedometer(int speed)
+void C64Display::Speedometer(int speed, int drawn, int skip)
 {
     // assumes speedometer is updated every second
     framesPerSecond = frameCounter;
     frameCounter = 0;
 
-	sprintf(speedometer_string, "%d%% %dfps", speed, framesPerSecond);
+    // frames dropped and shown twice by the renderer in the last second
+    uint32 dropped = droppedFrames;
+    uint32 duplicated = duplicatedFrames;
+
+    // drawn: frames the VIC drew in the last second, skip: current
+    // frame skip (draw every n-th frame)
+	sprintf(speedometer_string, "%d%% %d/%dfps 1:%d %u drop %u dup", speed, framesPerSecond, drawn, skip,
+            dropped - speedometerDropped, duplicated - speedometerDuplicated);
+
+    speedometerDropped = dropped;
+    speedometerDuplicated = duplicated;
 
     // printf("SPEED: %s\n", speedometer_string);
 }
 
 uint8* C64Display::BitmapBase(void)
 {
-    uint8* ptr = NULL;
+    return buffers[backIndex].pixels;
+}
 
-    SDL_LockMutex(bufferLock);
-	ptr = (uint8*) back_buffer;
-    SDL_UnlockMutex(bufferLock);
+/*
+ *  Dirty row flags of the bitmap returned by BitmapBase(): the
+ *  line-based VIC stores for every drawn row if it differs from
+ *  the previous frame, all other rows are always uploaded
+ */
 
-    return ptr;
+uint8* C64Display::BitmapDirtyRows(void)
+{
+    return buffers[backIndex].dirty;
 }
 
 int C64Display::BitmapXMod(void)
@@ -706,6 +839,11 @@ int C64Display::BitmapXMod(void)
 	return bufferPitch;
 }
 
+int C64Display::BitmapBitsPerPixel(void)
+{
+    return bufferBitsPerPixel;
+}
+
 void C64Display::invalidateBackground()
 {
     backgroundInvalid = true;
@@ -713,12 +851,12 @@ void C64Display::invalidateBackground()
 
 int C64Display::getWidth()
 {
-    return physicalScreen->w;
+    return (NULL != physicalScreen) ? physicalScreen->w : bufferWidth;
 }
 
 int C64Display::getHeight()
 {
-    return physicalScreen->h;
+    return (NULL != physicalScreen) ? physicalScreen->h : bufferHeight;
 }
 
 /*
@@ -727,31 +865,10 @@ int C64Display::getHeight()
 
 void C64Display::InitColors(uint8 *colors)
 {
-	for (int i=0; i<16; i++) 
-    {
-		palette[i].r = palette_red[i];
-		palette[i].g = palette_green[i];
-		palette[i].b = palette_blue[i];
-	}
-
-	palette[fill_gray].r    = palette[fill_gray].g      = palette[fill_gray].b   = 0xd0;
-	palette[shine_gray].r   = palette[shine_gray].g     = palette[shine_gray].b  = 0xf0;
-	palette[shadow_gray].r  = palette[shadow_gray].g    = palette[shadow_gray].b = 0x80;
-	palette[red].r          = 0xf0;
-	palette[red].g          = palette[red].b            = 0;
-	palette[green].g        = 0xf0;
-	palette[green].r        = palette[green].b          = 0;
-
-    for (int i=0; i<PALETTE_SIZE; i++)
-    {
-        // precompute openGl rgba palette
-        rgba_palette[i] = 0xff000000|((uint32)palette[i].b<<16) | ((uint32)palette[i].g << 8) | ((uint32)palette[i].r);
-    }
-    
     #if !USE_OPENGL
-        if (physicalScreen->format->BitsPerPixel == 8)
+        if (NULL != physicalScreen && physicalScreen->format->BitsPerPixel == 8)
         {
-	        SDL_SetColors(physicalScreen, palette, 0, PALETTE_SIZE);
+	        SDL_SetColors(physicalScreen, const_cast<SDL_Color*>(c64_palette().sdl), 0, PALETTE_SIZE);
         }
     #endif
 
@@ -764,6 +881,19 @@ void C64Display::InitColors(uint8 *colors)
     }
 }
 
+/*
+ *  RGBA pixel for every value in the frame buffer (used by the VIC
+ *  when the frame buffer has 32 bits per pixel)
+ */
+
+void C64Display::InitRGBAColors(uint32 *rgba_colors)
+{
+    for (int i=0; i<256; i++)
+    {
+        rgba_colors[i] = c64_palette().rgba[i & 0x0f];
+    }
+}
+
 void C64Display::resize(int w, int h)
 {
     #if USE_OPENGL
@@ -777,40 +907,60 @@ void C64Display::resize(int w, int h)
 		physicalScreen = newPhysicalSurface;
 
         #if !USE_OPENGL
-		    SDL_SetColors(physicalScreen, palette, 0, PALETTE_SIZE);
+		    SDL_SetColors(physicalScreen, const_cast<SDL_Color*>(c64_palette().sdl), 0, PALETTE_SIZE);
         #endif
 	}
 
-    if (NULL != renderer)
-    {
-        renderer->resize(w, h);
-    }
+    #if USE_OPENGL
+        if (NULL != renderer)
+        {
+            renderer->resize(w, h);
+        }
+    #endif
 
     invalidateBackground();
 }
 
 void C64Display::openOsd()
 {
-    #ifdef WEBOS
-        if (TheC64->TheInput->isVirtualKeyboardEnabled())
+    #if USE_OPENGL
+        if (NULL == osd)
         {
-            TheC64->TheInput->toggleVirtualKeyboard();
+            return;
         }
-    #endif
 
-    osd->show(true);
-    invalidateBackground();
+        #ifdef WEBOS
+            if (TheC64->TheInput->isVirtualKeyboardEnabled())
+            {
+                TheC64->TheInput->toggleVirtualKeyboard();
+            }
+        #endif
+
+        osd->show(true);
+        invalidateBackground();
+    #endif
 }
 
 void C64Display::closeOsd()
 {
-    osd->show(false);
-    invalidateBackground();
+    #if USE_OPENGL
+        if (NULL == osd)
+        {
+            return;
+        }
+
+        osd->show(false);
+        invalidateBackground();
+    #endif
 }
 
 bool C64Display::isOsdActive()
 {
-    return osd->isShown();
+    #if USE_OPENGL
+        return (NULL != osd && osd->isShown());
+    #else
+        return false;
+    #endif
 }
 
 OSD* C64Display::getOsd()
@@ -41,7 +41,6 @@ class C64Display
 	    C64 *TheC64;
 	    volatile bool quit_requested;
         volatile bool backgroundInvalid;
-        volatile bool invalidated;
 
     public:
         resource_list_t res;
@@ -49,10 +48,32 @@ class C64Display
     private:
         // use tripple buffering to make
         // input and display fully independent
-        uint8* back_buffer;
-        uint8* mid_buffer;
-        uint8* front_buffer;
-        SDL_mutex* bufferLock;
+        typedef struct
+        {
+            uint8* pixels;
+            uint8* dirty;                   // per row: changed since the previous frame (set by the VIC)
+            uint32* changed;                // per row: sequence number of the last change
+            uint32 sequence;                // frame number
+        } frame_buffer_t;
+
+        enum
+        {
+            MID_INDEX = 0x03,
+            MID_FRESH = 0x04                // mid buffer holds a frame that was not shown yet
+        };
+
+        frame_buffer_t buffers[3];
+        uint32 backIndex;                   // emulation thread only
+        uint32 frontIndex;                  // render thread only
+        volatile uint32 midState;           // mid buffer index and MID_FRESH, swapped atomically
+
+        uint32* rowChanged;                 // emulation thread: last change of each row
+        uint32 frameSequence;               // emulation thread: frames completed
+        uint32 shownSequence;               // render thread: frame in front buffer
+        uint32 textureSequence;             // render thread: frame in screen texture
+        uint8* textureDirty;                // render thread: rows to upload
+        volatile uint32 droppedFrames;      // frames replaced before they were shown
+        volatile uint32 duplicatedFrames;   // redraws without a new frame
 
         int bufferSize;
         int bufferWidth;
@@ -72,10 +93,13 @@ class C64Display
 	    int led_state[4];
 	    int old_led_state[4];
         OSD* osd;
-	    char speedometer_string[16];		// Speedometer text
+	    char speedometer_string[64];		// Speedometer text
+        uint32 speedometerDropped;          // droppedFrames at the last speedometer update
+        uint32 speedometerDuplicated;       // duplicatedFrames at the last speedometer update
         int framesPerSecond;
         int frameCounter;
         bool antialiasing;
+        bool headless;                      // No window, GL context or OSD
 
     public:
 	    C64Display(C64 *the_c64);
@@ -91,10 +115,13 @@ class C64Display
         void redraw();
 
 	    void UpdateLEDs(int l0, int l1, int l2, int l3);
-	    void Speedometer(int speed);
+	    void Speedometer(int speed, int drawn, int skip);
 	    uint8 *BitmapBase(void);
+	    uint8 *BitmapDirtyRows(void);
 	    int BitmapXMod(void);
+	    int BitmapBitsPerPixel(void);
 	    void InitColors(uint8 *colors);
+	    void InitRGBAColors(uint32 *rgba_colors);
 	    void NewPrefs(Prefs *prefs);
 
         void setAntialiasing(bool antialiasing);
@@ -121,6 +148,7 @@ class C64Display
         void update_led_blinking();
 
     private:
+        bool swapFrontBuffer();
         void doRedrawGL();
         void doInitGL();
         void doFreeGL();
@@ -138,6 +166,10 @@ class C64Display
     public:
         void setStatusMessage(const std::string& message, float timeOut=0.0f);
 
+    public:
+        uint32 getDroppedFrames() const { return droppedFrames; }
+        uint32 getDuplicatedFrames() const { return duplicatedFrames; }
+
 
     #if USE_OPENGL
         Renderer* renderer;
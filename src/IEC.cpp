@@ -42,7 +42,7 @@
  *  Constructor: Initialize variables
  */
 
-IEC::IEC(C64Display *display) : the_display(display)
+IEC::IEC(Prefs *prefs, C64Display *display) : the_prefs(prefs), the_display(display)
 {
 	int i;
 
@@ -50,14 +50,14 @@ IEC::IEC(C64Display *display) : the_display(display)
 	for (i=0; i<4; i++)
 		drive[i] = NULL;	// Important because UpdateLEDs is called from the drive constructors (via set_error)
 
-	if (!ThePrefs.Emul1541Proc)
+	if (!the_prefs->Emul1541Proc)
 		for (i=0; i<4; i++) {
-			if (ThePrefs.DriveType[i] == DRVTYPE_DIR)
-				drive[i] = new FSDrive(this, ThePrefs.DrivePath[i]);
-			else if (ThePrefs.DriveType[i] == DRVTYPE_D64)
-				drive[i] = new D64Drive(this, ThePrefs.DrivePath[i]);
+			if (the_prefs->DriveType[i] == DRVTYPE_DIR)
+				drive[i] = new FSDrive(this, the_prefs->DrivePath[i]);
+			else if (the_prefs->DriveType[i] == DRVTYPE_D64)
+				drive[i] = new D64Drive(this, the_prefs->DrivePath[i]);
 			else
-				drive[i] = new T64Drive(this, ThePrefs.DrivePath[i]);
+				drive[i] = new T64Drive(this, the_prefs->DrivePath[i]);
 		}
 
 	listener_active = talker_active = false;
@@ -103,7 +103,7 @@ void IEC::NewPrefs(Prefs *prefs)
 
     // Delete and recreate all changed drives
 	for (int i=0; i<4; i++)
-		if ((ThePrefs.DriveType[i] != prefs->DriveType[i]) || strcmp(ThePrefs.DrivePath[i], prefs->DrivePath[i]) || ThePrefs.Emul1541Proc != prefs->Emul1541Proc) {
+		if ((the_prefs->DriveType[i] != prefs->DriveType[i]) || strcmp(the_prefs->DrivePath[i], prefs->DrivePath[i]) || the_prefs->Emul1541Proc != prefs->Emul1541Proc) {
 			delete drive[i];
 			drive[i] = NULL;	// Important because UpdateLEDs is called from drive constructors (via set_error())
 			if (!prefs->Emul1541Proc) {
@@ -391,6 +391,7 @@ uint8 IEC::data_in(uint8 *byte)
 Drive::Drive(IEC *iec)
 {
 	the_iec = iec;
+	the_prefs = iec->GetPrefs();
 	LED = DRVLED_OFF;
 	Ready = false;
 	set_error(ERR_STARTUP);
@@ -71,12 +71,13 @@ class Prefs;
 // Class for complete IEC bus system with drives 8..11
 class IEC {
 public:
-	IEC(C64Display *display);
+	IEC(Prefs *prefs, C64Display *display);
 	~IEC();
 
 	void Reset(void);
 	void NewPrefs(Prefs *prefs);
 	void UpdateLEDs(void);
+	Prefs *GetPrefs(void) { return the_prefs; }
 
 	uint8 Out(uint8 byte, bool eoi);
 	uint8 OutATN(uint8 byte);
@@ -98,6 +99,7 @@ private:
 	uint8 data_out(uint8 byte, bool eoi);
 	uint8 data_in(uint8 *byte);
 
+	Prefs *the_prefs;			// Pointer to active preferences
 	C64Display *the_display;	// Pointer to display object (for drive LEDs)
 
 	char name_buf[NAMEBUF_LENGTH];	// Buffer for file names and command strings
@@ -139,6 +141,8 @@ protected:
 	char *error_ptr;	// Pointer within error message	
 	int error_len;		// Remaining length of error message
 
+	Prefs *the_prefs;	// Pointer to active preferences
+
 private:
 	IEC *the_iec;		// Pointer to IEC object
 };
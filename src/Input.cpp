@@ -33,12 +33,6 @@ extern int toolbarWidgetWidth;
 */
 
 
-static const int key_queue_size = 512;
-static int key_queue_elements = 0;
-static int key_queue_inptr = 0;
-static int key_queue_outptr = 0;
-static int key_queue[key_queue_size];
-
 int SEQUENCE_LOAD[] = { 108, -108, 111, -111, 97, -97, 100, -100, 32, -32, 304, 50, -50, 52, -52, 50, -50, -304, 44, -44, 56, -56, 13, -13 };
 int SEQUENCE_LIST[] = { 108, -108, 105, -105, 115, -115, 116, -116, 13, -13 };
 int SEQUENCE_LOADPGM[] = { 273, -273, 273, -273, 273, -273, 108, -108, 111, -111, 97, -97, 100, -100, 275, -275, 275, -275, 275, -275, 275, -275,
@@ -57,6 +51,10 @@ C64Input::C64Input(C64 *the_c64, C64Display* the_display)
 	quit_requested = false;
     enableVirtualKeyboard = false;
 
+    key_queue_elements = 0;
+    key_queue_inptr = 0;
+    key_queue_outptr = 0;
+
     inputLock = SDL_CreateMutex();
 }
 
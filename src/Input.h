@@ -20,6 +20,12 @@ class C64Input : public InputHandler
 
         SDL_mutex* inputLock;
 
+        static const int key_queue_size = 512;
+        int key_queue_elements;
+        int key_queue_inptr;
+        int key_queue_outptr;
+        int key_queue[key_queue_size];
+
     public:
 	    C64 *TheC64;
         C64Display* TheDisplay;
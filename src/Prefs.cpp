@@ -13,9 +13,6 @@
 #include "main.h"
 
 
-// These are the active preferences
-Prefs ThePrefs;
-
 // These are the preferences on disk
 Prefs ThePrefsOnDisk;
 
@@ -30,12 +27,13 @@ Prefs::Prefs()
 	BadLineCycles = 23;
 	CIACycles = 63;
 	FloppyCycles = 64;
-	SkipFrames = 1;
+	SkipFrames = 0;
 	LatencyMin = 80;
 	LatencyMax = 120;
 	LatencyAvg = 280;
 	ScalingNumerator = 2;
 	ScalingDenominator = 2;
+	SIDOversample = 1;
 
 	for (int i=0; i<4; i++)
     {
@@ -65,6 +63,7 @@ Prefs::Prefs()
 	MapSlash = true;
 	Emul1541Proc = false;
 	SIDFilters = true;
+	SIDBandLimit = false;
 	DoubleScan = true;
 	HideCursor = false;
 	DirectSound = true;	
@@ -95,6 +94,7 @@ bool Prefs::operator==(const Prefs &rhs) const
 		&& LatencyAvg == rhs.LatencyAvg
 		&& ScalingNumerator == rhs.ScalingNumerator
 		&& ScalingDenominator == rhs.ScalingNumerator
+		&& SIDOversample == rhs.SIDOversample
 		&& DriveType[0] == rhs.DriveType[0]
 		&& DriveType[1] == rhs.DriveType[1]
 		&& DriveType[2] == rhs.DriveType[2]
@@ -119,6 +119,7 @@ bool Prefs::operator==(const Prefs &rhs) const
 		&& MapSlash == rhs.MapSlash
 		&& Emul1541Proc == rhs.Emul1541Proc
 		&& SIDFilters == rhs.SIDFilters
+		&& SIDBandLimit == rhs.SIDBandLimit
 		&& DoubleScan == rhs.DoubleScan
 		&& HideCursor == rhs.HideCursor
 		&& DirectSound == rhs.DirectSound
@@ -144,11 +145,14 @@ bool Prefs::operator!=(const Prefs &rhs) const
 
 void Prefs::Check(void)
 {
-	if (SkipFrames <= 0) SkipFrames = 1;
+	if (SkipFrames < 0) SkipFrames = 0;
 
 	if (SIDType < SIDTYPE_NONE || SIDType > SIDTYPE_SIDCARD)
 		SIDType = SIDTYPE_NONE;
 
+	if (SIDOversample != 1 && SIDOversample != 2 && SIDOversample != 4)
+		SIDOversample = 1;
+
 	if (REUSize < REU_NONE || REUSize > REU_512K)
 		REUSize = REU_NONE;
 
@@ -193,6 +197,8 @@ void Prefs::Load(char *filename)
 					ScalingNumerator = atoi(value);
 				else if (!strcmp(keyword, "ScalingDenominator"))
 					ScalingDenominator = atoi(value);
+				else if (!strcmp(keyword, "SIDOversample"))
+					SIDOversample = atoi(value);
 				else if (!strcmp(keyword, "DriveType8"))
 					if (!strcmp(value, "DIR"))
 						DriveType[0] = DRVTYPE_DIR;
@@ -273,6 +279,8 @@ void Prefs::Load(char *filename)
 					Emul1541Proc = !strcmp(value, "TRUE");
 				else if (!strcmp(keyword, "SIDFilters"))
 					SIDFilters = !strcmp(value, "TRUE");
+				else if (!strcmp(keyword, "SIDBandLimit"))
+					SIDBandLimit = !strcmp(value, "TRUE");
 				else if (!strcmp(keyword, "DoubleScan"))
 					DoubleScan = !strcmp(value, "TRUE");
 				else if (!strcmp(keyword, "HideCursor"))
@@ -323,6 +331,7 @@ bool Prefs::Save(char *filename)
 		fprintf(file, "LatencyAvg = %d\n", LatencyAvg);
 		fprintf(file, "ScalingNumerator = %d\n", ScalingNumerator);
 		fprintf(file, "ScalingDenominator = %d\n", ScalingDenominator);
+		fprintf(file, "SIDOversample = %d\n", SIDOversample);
 		for (int i=0; i<4; i++) {
 			fprintf(file, "DriveType%d = ", i+8);
 			switch (DriveType[i]) {
@@ -379,6 +388,7 @@ bool Prefs::Save(char *filename)
 		fprintf(file, "MapSlash = %s\n", MapSlash ? "TRUE" : "FALSE");
 		fprintf(file, "Emul1541Proc = %s\n", Emul1541Proc ? "TRUE" : "FALSE");
 		fprintf(file, "SIDFilters = %s\n", SIDFilters ? "TRUE" : "FALSE");
+		fprintf(file, "SIDBandLimit = %s\n", SIDBandLimit ? "TRUE" : "FALSE");
 		fprintf(file, "DoubleScan = %s\n", DoubleScan ? "TRUE" : "FALSE");
 		fprintf(file, "HideCursor = %s\n", HideCursor ? "TRUE" : "FALSE");
 		fprintf(file, "DirectSound = %s\n", DirectSound ? "TRUE" : "FALSE");
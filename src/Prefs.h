@@ -55,7 +55,7 @@ class Prefs {
 	    int BadLineCycles;		// Available CPU cycles in Bad Lines
 	    int CIACycles;			// CIA timer ticks per raster line
 	    int FloppyCycles;		// Available 1541 CPU cycles per line
-	    int SkipFrames;			// Draw every n-th frame
+	    int SkipFrames;			// Draw every n-th frame, 0: adaptive
 
 	    int DriveType[4];		// Type of drive 8..11
 
@@ -72,6 +72,7 @@ class Prefs {
 	    int LatencyAvg;			// Averaging interval in msecs (Win32)
 	    int ScalingNumerator;	// Window scaling numerator (Win32)
 	    int ScalingDenominator;	// Window scaling denominator (Win32)
+	    int SIDOversample;		// Internal oversampling factor of digital SID (1, 2, 4)
 
 	    bool SpritesOn;			// Sprite display is on
 	    bool SpriteCollisions;	// Sprite collision detection is on
@@ -84,6 +85,7 @@ class Prefs {
 	    bool MapSlash;			// Map '/' in C64 filenames
 	    bool Emul1541Proc;		// Enable processor-level 1541 emulation
 	    bool SIDFilters;		// Emulate SID filters
+	    bool SIDBandLimit;		// Band-limited SID waveforms
 	    bool DoubleScan;		// Double scan lines (if DisplayType == DISPTYPE_SCREEN)
 	    bool HideCursor;		// Hide mouse cursor when visible (Win32)
 	    bool DirectSound;		// Use direct sound (instead of wav) (Win32)
@@ -97,10 +99,8 @@ class Prefs {
 };
 
 
-// These are the active preferences
-extern Prefs ThePrefs;
-
 // Theses are the preferences on disk
+// (the active preferences are owned by each C64 instance, see C64::ThePrefs)
 extern Prefs ThePrefsOnDisk;
 
 #endif
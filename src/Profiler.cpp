@@ -0,0 +1,171 @@
+/*
+ *  Profiler.cpp - Host time accounting per emulated chip
+ *
+ *  Frodo (C) 1994-1997,2002 Christian Bauer
+ */
+
+#include "sysdeps.h"
+
+#include "Profiler.h"
+#include "VIC.h"
+
+
+/*
+ *  Constructor/destructor
+ */
+
+Profiler::Profiler()
+{
+    dumpFile = NULL;
+    statusText[0] = 0;
+
+    #ifdef PROFILING
+        enable(true);
+    #else
+        enable(false);
+    #endif
+}
+
+Profiler::~Profiler()
+{
+    if (NULL != dumpFile)
+    {
+        fclose(dumpFile);
+        dumpFile = NULL;
+    }
+}
+
+
+/*
+ *  Enable accounting, resets all counters
+ */
+
+void Profiler::enable(bool enable)
+{
+    #ifdef PROFILING
+        enabled = true;     // Always on when compiled in
+    #else
+        enabled = enable;
+    #endif
+
+    frame = 0;
+
+    for (int i=0; i<SECTION_COUNT; i++)
+    {
+        frameNs[i] = totalNs[i] = windowNs[i] = 0;
+        frameCalls[i] = 0;
+        totalCalls[i] = 0;
+    }
+}
+
+
+/*
+ *  Frame is complete: dump it, add it to the totals and update the
+ *  status text once per second
+ */
+
+void Profiler::endFrame()
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    if (NULL != dumpFile)
+    {
+        fprintf(dumpFile, "%u", frame);
+        for (int i=0; i<SECTION_COUNT; i++)
+        {
+            if (hasSection(i))
+            {
+                fprintf(dumpFile, ",%llu,%u", (unsigned long long) frameNs[i], frameCalls[i]);
+            }
+        }
+        fprintf(dumpFile, "\n");
+    }
+
+    for (int i=0; i<SECTION_COUNT; i++)
+    {
+        totalNs[i] += frameNs[i];
+        totalCalls[i] += frameCalls[i];
+        windowNs[i] += frameNs[i];
+        frameNs[i] = 0;
+        frameCalls[i] = 0;
+    }
+
+    frame++;
+
+    if (frame % SCREEN_FREQ == 0)
+    {
+        uint64 sum = 0;
+        for (int i=0; i<SECTION_COUNT; i++)
+        {
+            sum += windowNs[i];
+        }
+
+        int len = 0;
+        for (int i=0; i<SECTION_COUNT; i++)
+        {
+            if (hasSection(i))
+            {
+                int percent = sum > 0 ? (int) (windowNs[i] * 100 / sum) : 0;
+                len += sprintf(statusText + len, "%s%s %d%%", len > 0 ? " " : "", getName(i), percent);
+            }
+            windowNs[i] = 0;
+        }
+    }
+}
+
+
+/*
+ *  Accumulated values since enable(), including the current frame
+ */
+
+uint64 Profiler::getTime(int section) const
+{
+    return totalNs[section] + frameNs[section];
+}
+
+uint64 Profiler::getCalls(int section) const
+{
+    return totalCalls[section] + frameCalls[section];
+}
+
+const char* Profiler::getName(int section)
+{
+    static const char* names[SECTION_COUNT] = { "vic", "sid", "cia", "cpu", "drive" };
+
+    return names[section];
+}
+
+
+/*
+ *  Write one CSV line per frame to the given file
+ */
+
+bool Profiler::openDump(const char* filename)
+{
+    if (NULL != dumpFile)
+    {
+        fclose(dumpFile);
+    }
+
+    dumpFile = fopen(filename, "w");
+    if (NULL == dumpFile)
+    {
+        fprintf(stderr, "Can't open profile dump %s\n", filename);
+        return false;
+    }
+
+    fprintf(dumpFile, "frame");
+    for (int i=0; i<SECTION_COUNT; i++)
+    {
+        if (hasSection(i))
+        {
+            fprintf(dumpFile, ",%s_ns,%s_calls", getName(i), getName(i));
+        }
+    }
+    fprintf(dumpFile, "\n");
+
+    return true;
+}
@@ -0,0 +1,120 @@
+/*
+ *  Profiler.h - Host time accounting per emulated chip
+ *
+ *  Frodo (C) 1994-1997,2002 Christian Bauer
+ */
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+/*
+ *  Build with -DPROFILING to count host time and calls per section in
+ *  every frame, show the shares in the status bar and optionally dump
+ *  one CSV line per frame. Without PROFILING only the host time of the
+ *  line-based emulation is accumulated, and only while enabled (for
+ *  the benchmark suite). In that case the sections cost a single
+ *  predictable branch each.
+ *
+ *  In the line-based emulation with PRECISE_CIA_CYCLES the CPU clocks
+ *  the CIAs while it executes, so their time is included in the "cpu"
+ *  (or "drive") section and there is no "cia" section.
+ */
+
+class Profiler
+{
+    public:
+        enum
+        {
+            SECTION_VIC,
+            SECTION_SID,
+            SECTION_CIA,
+            SECTION_CPU,
+            SECTION_DRIVE,      // 6510 and 1541 6502 interleaved, drive VIA timers
+            SECTION_COUNT
+        };
+
+    public:
+        Profiler();
+        ~Profiler();
+
+    public:
+        void enable(bool enable);
+        bool isEnabled() const { return enabled; }
+
+        // Add time since start to section, returns current time
+        uint64 account(int section, uint64 start)
+        {
+            uint64 now = host_time_ns();
+            frameNs[section] += now - start;
+            frameCalls[section]++;
+            return now;
+        }
+
+        // Count a call without measuring it
+        void count(int section) { frameCalls[section]++; }
+
+        // Distribute the time since start over the sections in the ratio
+        // of their sampled times, returns current time
+        uint64 split(uint64 start, const uint64* sample)
+        {
+            uint64 now = host_time_ns();
+            uint64 sum = 0;
+            for (int i=0; i<SECTION_COUNT; i++)
+            {
+                sum += sample[i];
+            }
+            for (int i=0; sum > 0 && i<SECTION_COUNT; i++)
+            {
+                frameNs[i] += (now - start) * sample[i] / sum;
+            }
+            return now;
+        }
+
+        void endFrame();
+
+        uint64 getTime(int section) const;
+        uint64 getCalls(int section) const;
+        static const char* getName(int section);
+
+        // Section is measured in this build
+        static bool hasSection(int section)
+        {
+            #if !defined(FRODO_SC) && PRECISE_CIA_CYCLES
+                return section != SECTION_CIA;
+            #else
+                return true;
+            #endif
+        }
+
+        bool openDump(const char* filename);
+        const char* getStatusText() const { return statusText; }
+
+    private:
+        bool enabled;
+        uint32 frame;
+
+        uint64 frameNs[SECTION_COUNT];      // Current frame
+        uint32 frameCalls[SECTION_COUNT];
+        uint64 totalNs[SECTION_COUNT];      // Since enable()
+        uint64 totalCalls[SECTION_COUNT];
+        uint64 windowNs[SECTION_COUNT];     // Since last status text update
+
+        FILE* dumpFile;
+        char statusText[64];
+};
+
+#ifdef PROFILING
+
+#define PROFILE_START(profiler)             uint64 profile_t = host_time_ns()
+#define PROFILE_SECTION(profiler, section)  profile_t = (profiler).account(section, profile_t)
+#define PROFILE_COUNT(profiler, section)    (profiler).count(section)
+
+#else
+
+#define PROFILE_START(profiler)             uint64 profile_t = (profiler).isEnabled() ? host_time_ns() : 0
+#define PROFILE_SECTION(profiler, section)  if ((profiler).isEnabled()) profile_t = (profiler).account(section, profile_t)
+#define PROFILE_COUNT(profiler, section)
+
+#endif
+
+#endif /* _PROFILER_H */
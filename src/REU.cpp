@@ -24,7 +24,7 @@
  *  Constructor
  */
 
-REU::REU(MOS6510 *CPU) : the_cpu(CPU)
+REU::REU(MOS6510 *CPU, Prefs *prefs) : the_cpu(CPU), the_prefs(prefs)
 {
 	int i;
 
@@ -39,7 +39,7 @@ REU::REU(MOS6510 *CPU) : the_cpu(CPU)
 	ram_size = ram_mask = 0;
 
 	// Allocate RAM
-	open_close_reu(REU_NONE, ThePrefs.REUSize);
+	open_close_reu(REU_NONE, the_prefs->REUSize);
 }
 
 
@@ -50,7 +50,7 @@ REU::REU(MOS6510 *CPU) : the_cpu(CPU)
 REU::~REU()
 {
 	// Free RAM
-	open_close_reu(ThePrefs.REUSize, REU_NONE);
+	open_close_reu(the_prefs->REUSize, REU_NONE);
 }
 
 
@@ -60,7 +60,7 @@ REU::~REU()
 
 void REU::NewPrefs(Prefs *prefs)
 {
-	open_close_reu(ThePrefs.REUSize, prefs->REUSize);
+	open_close_reu(the_prefs->REUSize, prefs->REUSize);
 }
 
 
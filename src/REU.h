@@ -13,7 +13,7 @@ class Prefs;
 
 class REU {
 public:
-	REU(MOS6510 *CPU);
+	REU(MOS6510 *CPU, Prefs *prefs);
 	~REU();
 
 	void NewPrefs(Prefs *prefs);
@@ -27,6 +27,7 @@ private:
 	void execute_dma(void);
 
 	MOS6510 *the_cpu;	// Pointer to 6510
+	Prefs *the_prefs;	// Pointer to active preferences
 
 	uint8 *ex_ram;		// REU expansion RAM
 
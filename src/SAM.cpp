@@ -15,47 +15,8 @@
 #include "CIA.h"
 
 
-// Pointers to chips
-static MOS6510 *TheCPU;
-static MOS6502_1541 *TheCPU1541;
-static MOS6569 *TheVIC;
-static MOS6581 *TheSID;
-static MOS6526_1 *TheCIA1;
-static MOS6526_2 *TheCIA2;
-
-// 6510/6502 registers
-static MOS6510State R64;
-static MOS6502State R1541;
-
-static bool access_1541;	// false: accessing C64, true: accessing 1541
-
-// Access to 6510/6502 address space
-static inline uint8 SAMReadByte(uint16 adr)
-{
-	if (access_1541)
-		return TheCPU1541->ExtReadByte(adr);
-	else
-		return TheCPU->ExtReadByte(adr);
-}
-
-static inline void SAMWriteByte(uint16 adr, uint8 byte)
-{
-	if (access_1541)
-		TheCPU1541->ExtWriteByte(adr, byte);
-	else
-		TheCPU->ExtWriteByte(adr, byte);
-}
-
-
-// Streams for input, output and error messages
-static FILE *fin, *fout, *ferr;
-
 // Input line
 #define INPUT_LENGTH 80
-static char input[INPUT_LENGTH];
-static char *in_ptr;
-
-static uint16 address, end_address;
 
 
 // Input tokens
@@ -82,9 +43,6 @@ enum Token {
 	T_PR		// 'pr'	(get_reg_token() only)
 };
 
-static enum Token the_token;			// Last token read
-static uint16 the_number;				// Contains the number if the_token==T_NUMBER
-static char the_string[INPUT_LENGTH];	// Contains the string if the_token==T_STRING
 
 
 // Addressing modes
@@ -203,64 +161,122 @@ static const char mnem_3[] = "cdlcsqtielkcscdivpxycxyrcxypraxyrpaapaplrisccdiaxy
 static const char adr_length[] = {1, 1, 2, 2, 2, 2, 2, 3, 3, 3, 3, 2, 2};
 
 
-// Prototypes
-static void error(char *s);
+// CTRL-C handling (SIGINT is process-wide)
 static void handle_abort(...);
 static void init_abort(void);
 static void exit_abort(void);
 static bool aborted(void);
 
-static void read_line(void);			// Scanner
-static char get_char(void);
-static void put_back(char c);
-static enum Token get_token(void);
-static enum Token get_reg_token(void);
-static uint16 get_number(void);
-static enum Token get_string(char *str);
-
-static bool expression(uint16 *number);	// Parser
-static bool term(uint16 *number);
-static bool factor(uint16 *number);
-static bool address_args(void);
-static bool range_args(int def_range);
-static bool instr_args(uint16 *number, char *mode);
-
-static void help(void);				// Routines for commands
-static void registers(void);
-static void display_registers(void);
-static void memory_dump(void);
-static void ascii_dump(void);
-static char conv_from_64(char c);
-static void screen_dump(void);
-static char conv_from_scode(char c);
-static void binary_dump(void);
-static void sprite_dump(void);
-static void byte_to_bin(uint8 byte, char *str);
-static void disassemble(void);
-static int disass_line(uint16 adr, uint8 op, uint8 lo, uint8 hi);
-static void assemble(void);
-static char find_mnemonic(char op1, char op2, char op3);
-static bool find_opcode(char mnem, char mode, uint8 *opcode);
-static void mem_config(void);
-static void fill(void);
-static void compare(void);
-static void transfer(void);
-static void modify(void);
-static void print_expr(void);
-static void redir_output(void);
-static void int_vectors(void);
-static void view_state(void);
-static void view_cia_state(void);
-static void dump_cia_ints(uint8 i);
-static void view_sid_state(void);
-static void dump_sid_waveform(uint8 wave);
-static void view_vic_state(void);
-static void dump_spr_flags(uint8 f);
-static void dump_vic_ints(uint8 i);
-static void view_1541_state(void);
-static void dump_via_ints(uint8 i);
-static void load_data(void);
-static void save_data(void);
+
+// Monitor session, bound to one C64 instance
+class SAMMonitor {
+public:
+	SAMMonitor(C64 *the_c64);
+	void Run(void);
+
+private:
+	uint8 SAMReadByte(uint16 adr);
+	void SAMWriteByte(uint16 adr, uint8 byte);
+
+	void error(char *s);
+
+	void read_line(void);			// Scanner
+	char get_char(void);
+	void put_back(char c);
+	enum Token get_token(void);
+	enum Token get_reg_token(void);
+	uint16 get_number(void);
+	enum Token get_string(char *str);
+
+	bool expression(uint16 *number);	// Parser
+	bool term(uint16 *number);
+	bool factor(uint16 *number);
+	bool address_args(void);
+	bool range_args(int def_range);
+	bool instr_args(uint16 *number, char *mode);
+
+	void help(void);				// Routines for commands
+	void registers(void);
+	void display_registers(void);
+	void memory_dump(void);
+	void ascii_dump(void);
+	char conv_from_64(char c);
+	void screen_dump(void);
+	char conv_from_scode(char c);
+	void binary_dump(void);
+	void sprite_dump(void);
+	void byte_to_bin(uint8 byte, char *str);
+	void disassemble(void);
+	int disass_line(uint16 adr, uint8 op, uint8 lo, uint8 hi);
+	void assemble(void);
+	char find_mnemonic(char op1, char op2, char op3);
+	bool find_opcode(char mnem, char mode, uint8 *opcode);
+	void mem_config(void);
+	void fill(void);
+	void compare(void);
+	void transfer(void);
+	void modify(void);
+	void print_expr(void);
+	void redir_output(void);
+	void int_vectors(void);
+	void view_state(void);
+	void view_cia_state(void);
+	void dump_cia_ints(uint8 i);
+	void view_sid_state(void);
+	void dump_sid_waveform(uint8 wave);
+	void view_vic_state(void);
+	void dump_spr_flags(uint8 f);
+	void dump_vic_ints(uint8 i);
+	void view_1541_state(void);
+	void dump_via_ints(uint8 i);
+	void load_data(void);
+	void save_data(void);
+
+	// Pointers to chips
+	MOS6510 *TheCPU;
+	MOS6502_1541 *TheCPU1541;
+	MOS6569 *TheVIC;
+	MOS6581 *TheSID;
+	MOS6526_1 *TheCIA1;
+	MOS6526_2 *TheCIA2;
+
+	// 6510/6502 registers
+	MOS6510State R64;
+	MOS6502State R1541;
+
+	bool access_1541;	// false: accessing C64, true: accessing 1541
+
+	// Streams for input, output and error messages
+	FILE *fin, *fout, *ferr;
+
+	// Input line
+	char input[INPUT_LENGTH];
+	char *in_ptr;
+
+	uint16 address, end_address;
+
+	enum Token the_token;			// Last token read
+	uint16 the_number;				// Contains the number if the_token==T_NUMBER
+	char the_string[INPUT_LENGTH];	// Contains the string if the_token==T_STRING
+};
+
+
+// Access to 6510/6502 address space
+inline uint8 SAMMonitor::SAMReadByte(uint16 adr)
+{
+	if (access_1541)
+		return TheCPU1541->ExtReadByte(adr);
+	else
+		return TheCPU->ExtReadByte(adr);
+}
+
+inline void SAMMonitor::SAMWriteByte(uint16 adr, uint8 byte)
+{
+	if (access_1541)
+		TheCPU1541->ExtWriteByte(adr, byte);
+	else
+		TheCPU->ExtWriteByte(adr, byte);
+}
 
 
 /*
@@ -269,15 +285,24 @@ static void save_data(void);
 
 void SAM(C64 *the_c64)
 {
-	bool done = false;
-	char c;
+	SAMMonitor sam(the_c64);
+	sam.Run();
+}
 
+SAMMonitor::SAMMonitor(C64 *the_c64)
+{
 	TheCPU = the_c64->TheCPU;
 	TheCPU1541 = the_c64->TheCPU1541;
 	TheVIC = the_c64->TheVIC;
 	TheSID = the_c64->TheSID;
 	TheCIA1 = the_c64->TheCIA1;
 	TheCIA2 = the_c64->TheCIA2;
+}
+
+void SAMMonitor::Run(void)
+{
+	bool done = false;
+	char c;
 
 	// Get CPU registers and current memory configuration
 	TheCPU->GetState(&R64);
@@ -438,7 +463,7 @@ void SAM(C64 *the_c64)
  *  Print error message
  */
 
-static void error(char *s)
+void SAMMonitor::error(char *s)
 {
 	fprintf(ferr, "*** %s\n", s);
 }
@@ -498,7 +523,7 @@ static bool aborted(void)
  *  Read a line from the keyboard
  */
 
-static void read_line(void)
+void SAMMonitor::read_line(void)
 {
 	fgets(in_ptr = input, INPUT_LENGTH, fin);
 }
@@ -508,7 +533,7 @@ static void read_line(void)
  *  Read a character from the input line
  */
 
-static char get_char(void)
+char SAMMonitor::get_char(void)
 {
 	return *in_ptr++;
 }
@@ -518,7 +543,7 @@ static char get_char(void)
  *  Stuff back a character into the input line
  */
 
-static void put_back(char c)
+void SAMMonitor::put_back(char c)
 {
 	*(--in_ptr) = c;
 }
@@ -528,7 +553,7 @@ static void put_back(char c)
  *  Scanner: Get a token from the input line
  */
 
-static enum Token get_token(void)
+enum Token SAMMonitor::get_token(void)
 {
 	char c;
 
@@ -586,7 +611,7 @@ static enum Token get_token(void)
 	}
 }
 
-static enum Token get_reg_token(void)
+enum Token SAMMonitor::get_reg_token(void)
 {
 	char c;
 
@@ -631,7 +656,7 @@ static enum Token get_reg_token(void)
 	}
 }
 
-static uint16 get_number(void)
+uint16 SAMMonitor::get_number(void)
 {
 	char c;
 	uint16 i = 0;
@@ -646,7 +671,7 @@ static uint16 get_number(void)
 	return i;
 }
 
-static enum Token get_string(char *str)
+enum Token SAMMonitor::get_string(char *str)
 {
 	char c;
 
@@ -668,7 +693,7 @@ static enum Token get_string(char *str)
  *  true: OK, false: Error
  */
 
-static bool expression(uint16 *number)
+bool SAMMonitor::expression(uint16 *number)
 {
 	uint16 accu, trm;
 
@@ -703,7 +728,7 @@ static bool expression(uint16 *number)
  *  true: OK, false: Error
  */
 
-static bool term(uint16 *number)
+bool SAMMonitor::term(uint16 *number)
 {
 	uint16 accu, fact;
 
@@ -742,7 +767,7 @@ static bool term(uint16 *number)
  *  true: OK, false: Error
  */
 
-static bool factor(uint16 *number)
+bool SAMMonitor::factor(uint16 *number)
 {
 	switch (the_token) {
 		case T_NUMBER:
@@ -794,7 +819,7 @@ static bool factor(uint16 *number)
  *  true: OK, false: Error
  */
 
-static bool address_args(void)
+bool SAMMonitor::address_args(void)
 {
 	if (the_token == T_END)
 		return true;
@@ -814,7 +839,7 @@ static bool address_args(void)
  *  true: OK, false: Error
  */
 
-static bool range_args(int def_range)
+bool SAMMonitor::range_args(int def_range)
 {
 	end_address = address + def_range;
 
@@ -847,7 +872,7 @@ static bool range_args(int def_range)
  *  true: OK, false: Error
  */
 
-static bool instr_args(uint16 *number, char *mode)
+bool SAMMonitor::instr_args(uint16 *number, char *mode)
 {
 	switch (the_token) {
 
@@ -977,7 +1002,7 @@ static bool instr_args(uint16 *number, char *mode)
  *  h
  */
 
-static void help(void)
+void SAMMonitor::help(void)
 {
 	fprintf(fout, "a [start]           Assemble\n"
 				"b [start] [end]     Binary dump\n"
@@ -1013,7 +1038,7 @@ static void help(void)
  *  r [reg value]
  */
 
-static void registers(void)
+void SAMMonitor::registers(void)
 {
 	enum Token the_reg;
 	uint16 value;
@@ -1082,7 +1107,7 @@ static void registers(void)
 	display_registers();
 }
 
-static void display_registers(void)
+void SAMMonitor::display_registers(void)
 {
 	if (access_1541) {
 		fprintf(fout, " PC  A  X  Y   SP  NVDIZC  Instruction\n");
@@ -1109,7 +1134,7 @@ static void display_registers(void)
 
 #define MEMDUMP_BPL 16  // Bytes per line
 
-static void memory_dump(void)
+void SAMMonitor::memory_dump(void)
 {
 	bool done = false;
 	short i;
@@ -1144,7 +1169,7 @@ static void memory_dump(void)
 
 #define ASCIIDUMP_BPL 64  // Bytes per line
 
-static void ascii_dump(void)
+void SAMMonitor::ascii_dump(void)
 {
 	bool done = false;
 	short i;
@@ -1176,7 +1201,7 @@ static void ascii_dump(void)
  *  Convert PETSCII->ASCII
  */
 
-static char conv_from_64(char c)
+char SAMMonitor::conv_from_64(char c)
 {
 	if ((c >= 'A') && (c <= 'Z') || (c >= 'a') && (c <= 'z'))
 		return c ^ 0x20;
@@ -1192,7 +1217,7 @@ static char conv_from_64(char c)
 
 #define SCRDUMP_BPL 64  // Bytes per line
 
-static void screen_dump(void)
+void SAMMonitor::screen_dump(void)
 {
 	bool done = false;
 	short i;
@@ -1224,7 +1249,7 @@ static void screen_dump(void)
  *  Convert screen code->ASCII
  */
 
-static char conv_from_scode(char c)
+char SAMMonitor::conv_from_scode(char c)
 {
 	c &= 0x7f;
 
@@ -1243,7 +1268,7 @@ static char conv_from_scode(char c)
  *  b [start] [end]
  */
 
-static void binary_dump(void)
+void SAMMonitor::binary_dump(void)
 {
 	bool done = false;
 	char bin[10];
@@ -1267,7 +1292,7 @@ static void binary_dump(void)
  *  p [start] [end]
  */
 
-static void sprite_dump(void)
+void SAMMonitor::sprite_dump(void)
 {
 	bool done = false;
 	short i;
@@ -1295,7 +1320,7 @@ static void sprite_dump(void)
  *  Convert byte to binary representation
  */
 
-static void byte_to_bin(uint8 byte, char *str)
+void SAMMonitor::byte_to_bin(uint8 byte, char *str)
 {
 	short i;
 
@@ -1312,7 +1337,7 @@ static void byte_to_bin(uint8 byte, char *str)
  *  d [start] [end]
  */
 
-static void disassemble(void)
+void SAMMonitor::disassemble(void)
 {
 	bool done = false;
 	short i;
@@ -1337,7 +1362,7 @@ static void disassemble(void)
  *  Disassemble one instruction, return length
  */
 
-static int disass_line(uint16 adr, uint8 op, uint8 lo, uint8 hi)
+int SAMMonitor::disass_line(uint16 adr, uint8 op, uint8 lo, uint8 hi)
 {
 	char mode = adr_mode[op], mnem = mnemonic[op];
 
@@ -1429,7 +1454,7 @@ static int disass_line(uint16 adr, uint8 op, uint8 lo, uint8 hi)
  *  a [start]
  */
 
-static void assemble(void)
+void SAMMonitor::assemble(void)
 {
 	bool done = false;
 	char c1, c2, c3;
@@ -1520,7 +1545,7 @@ static void assemble(void)
  *  M_ILLEGAL: No matching mnemonic found
  */
 
-static char find_mnemonic(char op1, char op2, char op3)
+char SAMMonitor::find_mnemonic(char op1, char op2, char op3)
 {
 	int i;
 
@@ -1537,7 +1562,7 @@ static char find_mnemonic(char op1, char op2, char op3)
  *  true: OK, false: Mnemonic can't have specified addressing mode
  */
 
-static bool find_opcode(char mnem, char mode, uint8 *opcode)
+bool SAMMonitor::find_opcode(char mnem, char mode, uint8 *opcode)
 {
 	int i;
 
@@ -1556,7 +1581,7 @@ static bool find_opcode(char mnem, char mode, uint8 *opcode)
  *  k [config]
  */
 
-static void mem_config(void)
+void SAMMonitor::mem_config(void)
 {
 	uint16 con;
 
@@ -1580,7 +1605,7 @@ static void mem_config(void)
  *  f start end byte
  */
 
-static void fill(void)
+void SAMMonitor::fill(void)
 {
 	bool done = false;
 	uint16 adr, end_adr, value;
@@ -1605,7 +1630,7 @@ static void fill(void)
  *  c start end dest
  */
 
-static void compare(void)
+void SAMMonitor::compare(void)
 {
 	bool done = false;
 	uint16 adr, end_adr, dest;
@@ -1641,7 +1666,7 @@ static void compare(void)
  *  t start end dest
  */
 
-static void transfer(void)
+void SAMMonitor::transfer(void)
 {
 	bool done = false;
 	uint16 adr, end_adr, dest;
@@ -1673,7 +1698,7 @@ static void transfer(void)
  *  : addr {byte}
  */
 
-static void modify(void)
+void SAMMonitor::modify(void)
 {
 	uint16 adr, val;
 
@@ -1693,7 +1718,7 @@ static void modify(void)
  *  ? expression
  */
 
-static void print_expr(void)
+void SAMMonitor::print_expr(void)
 {
 	uint16 val;
 
@@ -1709,7 +1734,7 @@ static void print_expr(void)
  *  o [file]
  */
 
-static void redir_output(void)
+void SAMMonitor::redir_output(void)
 {
 	// Close old file
 	if (fout != ferr) {
@@ -1735,7 +1760,7 @@ static void redir_output(void)
  *  Display interrupt vectors
  */
 
-static void int_vectors(void)
+void SAMMonitor::int_vectors(void)
 {
 	fprintf(fout, "        IRQ  BRK  NMI\n");
 	fprintf(fout, "%d  : %04lx %04lx %04lx\n",
@@ -1756,7 +1781,7 @@ static void int_vectors(void)
  *  Display state of custom chips
  */
 
-static void view_state(void)
+void SAMMonitor::view_state(void)
 {
 	switch (get_char()) {
 		case 'c':		// CIA
@@ -1781,7 +1806,7 @@ static void view_state(void)
 	}
 }
 
-static void view_cia_state(void)
+void SAMMonitor::view_cia_state(void)
 {
 	MOS6526State cs;
 
@@ -1855,7 +1880,7 @@ static void view_cia_state(void)
 	dump_cia_ints(cs.int_mask);
 }
 
-static void dump_cia_ints(uint8 i)
+void SAMMonitor::dump_cia_ints(uint8 i)
 {
 	if (i & 0x1f) {
 		if (i & 1) fprintf(fout, "TA ");
@@ -1868,7 +1893,7 @@ static void dump_cia_ints(uint8 i)
 	fputc('\n', fout);
 }
 
-static void view_sid_state(void)
+void SAMMonitor::view_sid_state(void)
 {
 	MOS6581State ss;
 
@@ -1917,7 +1942,7 @@ static void view_sid_state(void)
 	fprintf(fout, "\n Volume   : %lx\n", ss.mode_vol & 0x0f);
 }
 
-static void dump_sid_waveform(uint8 wave)
+void SAMMonitor::dump_sid_waveform(uint8 wave)
 {
 	if (wave & 0xf0) {
 		if (wave & 0x10) fprintf(fout, "Triangle ");
@@ -1929,7 +1954,7 @@ static void dump_sid_waveform(uint8 wave)
 	fputc('\n', fout);
 }
 
-static void view_vic_state(void)
+void SAMMonitor::view_vic_state(void)
 {
 	MOS6569State vs;
 	short i;
@@ -2014,7 +2039,7 @@ static void view_vic_state(void)
 	dump_vic_ints(vs.irq_mask);
 }
 
-static void dump_spr_flags(uint8 f)
+void SAMMonitor::dump_spr_flags(uint8 f)
 {
 	short i;
 
@@ -2027,7 +2052,7 @@ static void dump_spr_flags(uint8 f)
 	fputc('\n', fout);
 }
 
-static void dump_vic_ints(uint8 i)
+void SAMMonitor::dump_vic_ints(uint8 i)
 {
 	if (i & 0x1f) {
 		if (i & 1) fprintf(fout, "Raster ");
@@ -2039,7 +2064,7 @@ static void dump_vic_ints(uint8 i)
 	fputc('\n', fout);
 }
 
-static void view_1541_state(void)
+void SAMMonitor::view_1541_state(void)
 {
 	fprintf(fout, "VIA 1:\n");
 	fprintf(fout, " Timer 1 Counter: %04x  Latch: %04x\n", R1541.via1_t1c, R1541.via1_t1l);
@@ -2062,7 +2087,7 @@ static void view_1541_state(void)
 	dump_via_ints(R1541.via2_ier);
 }
 
-static void dump_via_ints(uint8 i)
+void SAMMonitor::dump_via_ints(uint8 i)
 {
 	if (i & 0x7f) {
 		if (i & 0x40) fprintf(fout, "T1 ");
@@ -2083,7 +2108,7 @@ static void dump_via_ints(uint8 i)
  *  l start "file"
  */
 
-static void load_data(void)
+void SAMMonitor::load_data(void)
 {
 	uint16 adr;
 	FILE *file;
@@ -2115,7 +2140,7 @@ static void load_data(void)
  *  s start end "file"
  */
 
-static void save_data(void)
+void SAMMonitor::save_data(void)
 {
 	bool done = false;
 	uint16 adr, end_adr;
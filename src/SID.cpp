@@ -48,9 +48,8 @@ class DigitalPlayer;
  *  Random number generator for noise waveform
  */
 
-static uint8 sid_random(void)
+static uint8 sid_random(uint32 &seed)
 {
-	static uint32 seed = 1;
 	seed = seed * 1103515245 + 12345;
 	return seed >> 16;
 }
@@ -66,7 +65,7 @@ MOS6581::MOS6581(C64 *c64) : the_c64(c64)
 		regs[i] = 0;
 
 	// Open the renderer
-	open_close_renderer(SIDTYPE_NONE, ThePrefs.SIDType);
+	open_close_renderer(SIDTYPE_NONE, the_c64->ThePrefs.SIDType);
 }
 
 
@@ -77,7 +76,7 @@ MOS6581::MOS6581(C64 *c64) : the_c64(c64)
 MOS6581::~MOS6581()
 {
 	// Close the renderer
-	open_close_renderer(ThePrefs.SIDType, SIDTYPE_NONE);
+	open_close_renderer(the_c64->ThePrefs.SIDType, SIDTYPE_NONE);
 }
 
 
@@ -103,7 +102,7 @@ void MOS6581::Reset(void)
 
 void MOS6581::NewPrefs(Prefs *prefs)
 {
-	open_close_renderer(ThePrefs.SIDType, prefs->SIDType);
+	open_close_renderer(the_c64->ThePrefs.SIDType, prefs->SIDType);
 	if (the_renderer != NULL)
 		the_renderer->NewPrefs(prefs);
 }
@@ -221,9 +220,17 @@ void MOS6581::SetState(MOS6581State *ss)
 
 const uint32 SAMPLE_FREQ = 44100;	// Sample output frequency in Hz
 const uint32 SID_FREQ = 985248;		// SID frequency in Hz
-const uint32 CALC_FREQ = 50;			// Frequency at which calc_buffer is called in Hz (should be 50Hz)
+const uint32 CALC_FREQ = 50;			// Frequency at which the null sink calls calc_buffer in Hz (should be 50Hz)
+const int DEVICE_SAMPLES = 512;		// Audio device buffer size in sample frames
 const uint32 SID_CYCLES = SID_FREQ/SAMPLE_FREQ;	// # of SID clocks per sample frame
-const int SAMPLE_BUF_SIZE = 0x138*2;// Size of buffer for sampled voice (double buffered)
+const uint32 FRAME_CYCLES = TOTAL_RASTERS*CYCLES_PER_LINE;	// # of emulated cycles per frame
+const uint32 PLAY_STEP = (uint32)(((uint64)SID_FREQ << 16) / SAMPLE_FREQ);	// Nominal emulated cycles per sample, 16.16 fixed
+const int32 MAX_STEP_DEV = PLAY_STEP / 200;	// Max. deviation of the playback rate from nominal (0.5%)
+const int WRITE_RING_SIZE = 4096;	// Queued register writes, power of 2
+const int BLOCK_SIZE = 64;			// Max. # of samples rendered at once by calc_buffer()
+const int FILTER_RAMP = 64;			// # of samples for the filter coefficients to follow a change
+const int MAX_OVERSAMPLE = 4;		// Max. internal oversampling factor
+const int DEC_TAPS = 24;			// Decimation filter taps per phase
 
 // SID waveforms (some of them :-)
 enum {
@@ -289,6 +296,19 @@ struct DRVoice {
 	bool sync;		// Sync modulation bit
 };
 
+// Register write, queued by the emulation for the audio thread
+struct DRWrite {
+	uint32 cycle;	// Emulated cycle of the write
+	uint8 adr;		// SID register or DRW_* command
+	uint8 byte;
+};
+
+// Commands in the write queue
+enum {
+	DRW_RESET = 0x80,	// Reset the voices and the filter
+	DRW_NEW_PREFS		// Preferences changed
+};
+
 // Renderer class
 class DigitalRenderer : public SIDRenderer {
 public:
@@ -303,13 +323,35 @@ public:
 	virtual void Resume(void);
 
 private:
+	static bool init_static_tables(void);
 	void init_sound(void);
+	void reset_state(void);
+	void set_register(uint8 adr, uint8 byte);
+	void queue_write(uint8 adr, uint8 byte);
+	uint32 emulated_cycle(void) const;
+	void apply_prefs(void);
+	void calc_add(int v);
+	void calc_decimator(void);
 	void calc_filter(void);
+	void glide_filter(void);
+	void filter_block(int n);
 	void calc_buffer(int16 *buf, long count);
+	void calc_counters(int n);
+	void calc_wave(int v, int n);
+	void calc_envelope(int v, int n, uint8 master_volume);
+	void decimate(int32 *dst, int b, int n);
 
 	bool ready;						// Flag: Renderer has initialized and is ready
+	bool null_sink;					// Flag: No audio device, buffers are calculated and discarded
+	int16 *null_buffer;				// Scratch buffer for null_sink
+	int null_lines;					// Lines emulated since null_sink pulled a buffer
 	uint8 volume;					// Master volume
 	bool v3_mute;					// Voice 3 muted
+	uint32 noise_seed;				// Random generator state for noise waveform
+	int oversample;					// Internal samples per output sample
+	bool band_limit;				// Flag: Band-limited sawtooth and pulse
+	int new_oversample;				// Set by NewPrefs(), taken over by apply_prefs()
+	bool new_band_limit;
 
 	static uint16 TriTable[0x1000*2];	// Tables for certain waveforms
 	static const uint16 TriSawTable[0x100];
@@ -329,6 +371,8 @@ private:
 	FixPoint f_ampl;
 	FixPoint d1, d2, g1, g2;
 	int32 xn1, xn2, yn1, yn2;		// can become very large
+	FixPoint fc_ampl, fc_d1, fc_d2, fc_g1, fc_g2;
+	FixPoint fs_ampl, fs_d1, fs_d2, fs_g1, fs_g2;
 	FixPoint sidquot;
 #ifdef PRECOMPUTE_RESONANCE
 	FixPoint resonanceLP[256];
@@ -338,14 +382,53 @@ private:
 	float f_ampl;					// IIR filter input attenuation
 	float d1, d2, g1, g2;			// IIR filter coefficients
 	float xn1, xn2, yn1, yn2;		// IIR filter previous input/output signal
+	float fc_ampl, fc_d1, fc_d2, fc_g1, fc_g2;	// Coefficients in use, glide to the ones above
+	float fs_ampl, fs_d1, fs_d2, fs_g1, fs_g2;	// Glide step per sample
 #ifdef PRECOMPUTE_RESONANCE
 	float resonanceLP[256];			// shortcut for calc_filter
 	float resonanceHP[256];
 #endif
+#endif
+	bool f_changed;					// Flag: calc_filter() was called, start a glide
+	int f_ramp;						// # of samples left in the glide
+
+	// Register writes are queued with their cycle by the emulation
+	// and applied by calc_buffer() at the matching sample, so the
+	// audio thread owns all of the state above
+	DRWrite write_ring[WRITE_RING_SIZE];
+	volatile uint32 write_head;		// Next entry to fill, written by the emulation
+	volatile uint32 write_tail;		// Next entry to apply, written by calc_buffer()
+	uint8 shadow_regs[25];			// Last values written, resent after an overflow
+	bool write_overflow;			// Flag: Ring was full, registers must be resent
+	bool resend_reset;				// Flag: DRW_RESET was dropped by an overflow
+	bool resend_prefs;				// Flag: DRW_NEW_PREFS was dropped by an overflow
+
+	// calc_buffer() renders blocks of samples one stage at a time,
+	// with one row per voice. Oscillators and waveforms run at the
+	// internal (oversampled) rate.
+	uint32 blk_count[3][BLOCK_SIZE*MAX_OVERSAMPLE+1];	// Oscillator counters, [0] is the value before the block
+	int32 blk_wave[3][BLOCK_SIZE*MAX_OVERSAMPLE];		// Waveform outputs
+	int32 blk_env[3][BLOCK_SIZE];		// Envelopes, scaled by the master volume
+	int32 blk_out[BLOCK_SIZE];			// Unfiltered voices and sampled voice
+	int32 blk_filt[BLOCK_SIZE];			// Filtered voices
+
+	// Oversampled sums of the unfiltered and filtered voices, one row
+	// per phase (internal sample within an output sample), each after
+	// DEC_TAPS samples of history
+	int32 os_bus[2][MAX_OVERSAMPLE][DEC_TAPS + BLOCK_SIZE];
+	int os_live[2];					// # of output samples until a bus is silent
+#ifdef USE_FIXPOINT_MATHS
+	int32 dec_coef[DEC_TAPS*MAX_OVERSAMPLE];	// Decimation filter, 16.16 fixed
+#else
+	float dec_coef[DEC_TAPS*MAX_OVERSAMPLE];	// Decimation filter
 #endif
 
-	uint8 sample_buf[SAMPLE_BUF_SIZE]; // Buffer for sampled voice
-	int sample_in_ptr;				// Index in sample_buf for writing
+	uint32 line_cycle;				// Emulated cycle at the start of the current line
+	volatile uint32 emul_cycle;		// Emulated cycle, published for calc_buffer()
+	uint32 play_cycle;				// Emulated cycle of the next output sample
+	uint32 play_frac;				// Fraction of play_cycle, 16 bit
+	uint32 play_step;				// Emulated cycles per output sample, 16.16 fixed
+	int32 fill_error;				// Averaged deviation of the fill level from its target, in cycles
 
 public:
 	void VBlank(void);
@@ -359,6 +442,24 @@ public:
 // Static data members
 uint16 DigitalRenderer::TriTable[0x1000*2];
 
+/*
+ *  Calculate the tables shared by all renderers (only called once)
+ */
+
+bool DigitalRenderer::init_static_tables(void)
+{
+	for (int i=0; i<0x1000; i++) {
+		TriTable[i] = (i << 4) | (i >> 8);
+		TriTable[0x1fff-i] = (i << 4) | (i >> 8);
+	}
+
+#if defined(PRECOMPUTE_RESONANCE) && defined(USE_FIXPOINT_MATHS)
+	// compute lookup table for sin and cos
+	InitFixSinTab();
+#endif
+	return true;
+}
+
 #ifndef EMUL_MOS8580
 // Sampled from a 6581R4
 const uint16 DigitalRenderer::TriSawTable[0x100] = {
@@ -685,6 +786,14 @@ const int16 DigitalRenderer::SampleTab[16] = {
 
 DigitalRenderer::DigitalRenderer(C64 *c64) : the_c64(c64)
 {
+	ready = false;
+	write_head = write_tail = 0;
+	write_overflow = resend_reset = resend_prefs = false;
+	memset(shadow_regs, 0, sizeof(shadow_regs));
+	line_cycle = emul_cycle = play_cycle = play_frac = 0;
+	play_step = PLAY_STEP;
+	fill_error = 0;
+
 	// Link voices together
 	voice[0].mod_by = &voice[2];
 	voice[1].mod_by = &voice[0];
@@ -693,11 +802,14 @@ DigitalRenderer::DigitalRenderer(C64 *c64) : the_c64(c64)
 	voice[1].mod_to = &voice[2];
 	voice[2].mod_to = &voice[0];
 
-	// Calculate triangle table
-	for (int i=0; i<0x1000; i++) {
-		TriTable[i] = (i << 4) | (i >> 8);
-		TriTable[0x1fff-i] = (i << 4) | (i >> 8);
-	}
+	noise_seed = 1;
+	oversample = new_oversample = 1;
+	band_limit = new_band_limit = false;
+
+	// Calculate tables shared by all renderers (function-local static:
+	// done exactly once, even with renderers starting on several threads)
+	static bool tables_ready = init_static_tables();
+	(void)tables_ready;
 
 #ifdef PRECOMPUTE_RESONANCE
 #ifdef USE_FIXPOINT_MATHS
@@ -708,8 +820,6 @@ DigitalRenderer::DigitalRenderer(C64 *c64) : the_c64(c64)
 	}
 	// Pre-compute the quotient. No problem since int-part is small enough
 	sidquot = (int32)((((double)SID_FREQ)*65536) / SAMPLE_FREQ);
-	// compute lookup table for sin and cos
-	InitFixSinTab();
 #else
 	for (int i=0; i<256; i++) {
 	  resonanceLP[i] = CALC_RESONANCE_LP(i);
@@ -720,6 +830,9 @@ DigitalRenderer::DigitalRenderer(C64 *c64) : the_c64(c64)
 
 	Reset();
 
+	// Take over the loaded preferences
+	NewPrefs(&the_c64->ThePrefs);
+
 	// System specific initialization
 	init_sound();
 }
@@ -730,6 +843,16 @@ DigitalRenderer::DigitalRenderer(C64 *c64) : the_c64(c64)
  */
 
 void DigitalRenderer::Reset(void)
+{
+	memset(shadow_regs, 0, sizeof(shadow_regs));
+
+	if (ready)
+		queue_write(DRW_RESET, 0);
+	else
+		reset_state();
+}
+
+void DigitalRenderer::reset_state(void)
 {
 	volume = 0;
 	v3_mute = false;
@@ -756,9 +879,29 @@ void DigitalRenderer::Reset(void)
 	d1 = d2 = g1 = g2 = 0.0;
 	xn1 = xn2 = yn1 = yn2 = 0.0;
 #endif
+	fc_ampl = f_ampl;
+	fc_d1 = d1; fc_d2 = d2;
+	fc_g1 = g1; fc_g2 = g2;
+	f_changed = false;
+	f_ramp = 0;
+
+	memset(os_bus, 0, sizeof(os_bus));
+	os_live[0] = os_live[1] = 0;
+}
+
 
-	sample_in_ptr = 0;
-	memset(sample_buf, 0, SAMPLE_BUF_SIZE);
+/*
+ *  Emulated cycle for the timestamp of a register write. The
+ *  line-based emulation only knows the start of the raster line.
+ */
+
+inline uint32 DigitalRenderer::emulated_cycle(void) const
+{
+#ifdef FRODO_SC
+	return the_c64->CycleCounter;
+#else
+	return line_cycle;
+#endif
 }
 
 
@@ -771,6 +914,75 @@ void DigitalRenderer::WriteRegister(uint16 adr, uint8 byte)
 	if (!ready)
 		return;
 
+	if (adr < 25)
+		shadow_regs[adr] = byte;
+	queue_write(adr, byte);
+}
+
+
+/*
+ *  Queue a register write or command for calc_buffer(). Only called
+ *  by the emulation, calc_buffer() is the only reader of the ring.
+ *  If the audio thread doesn't keep up, the writes are dropped, and
+ *  the dropped commands and all registers are sent again as soon as
+ *  there is room.
+ */
+
+void DigitalRenderer::queue_write(uint8 adr, uint8 byte)
+{
+	uint32 head = write_head;
+	uint32 cycle = emulated_cycle();
+	uint32 used = head - atomic_load32(&write_tail);
+
+	if (!write_overflow && used < WRITE_RING_SIZE) {
+		DRWrite *w = &write_ring[head & (WRITE_RING_SIZE-1)];
+		w->cycle = cycle;
+		w->adr = adr;
+		w->byte = byte;
+		atomic_store32(&write_head, head + 1);
+		return;
+	}
+
+	// Overflow: remember dropped commands (register writes are in
+	// shadow_regs already) and wait for room for the resend
+	write_overflow = true;
+	if (adr == DRW_RESET)
+		resend_reset = true;
+	else if (adr == DRW_NEW_PREFS)
+		resend_prefs = true;
+	if (used > WRITE_RING_SIZE - 27)
+		return;
+
+	DRWrite *w;
+	if (resend_reset) {
+		w = &write_ring[head++ & (WRITE_RING_SIZE-1)];
+		w->cycle = cycle;
+		w->adr = DRW_RESET;
+		w->byte = 0;
+	}
+	if (resend_prefs) {
+		w = &write_ring[head++ & (WRITE_RING_SIZE-1)];
+		w->cycle = cycle;
+		w->adr = DRW_NEW_PREFS;
+		w->byte = 0;
+	}
+	for (int i=0; i<25; i++, head++) {
+		w = &write_ring[head & (WRITE_RING_SIZE-1)];
+		w->cycle = cycle;
+		w->adr = i;
+		w->byte = shadow_regs[i];
+	}
+	write_overflow = resend_reset = resend_prefs = false;
+	atomic_store32(&write_head, head);
+}
+
+
+/*
+ *  Apply a register write (called by calc_buffer())
+ */
+
+void DigitalRenderer::set_register(uint8 adr, uint8 byte)
+{
 	int v = adr/7;	// Voice number
 
 	switch (adr) {
@@ -778,22 +990,14 @@ void DigitalRenderer::WriteRegister(uint16 adr, uint8 byte)
 		case 7:
 		case 14:
 			voice[v].freq = (voice[v].freq & 0xff00) | byte;
-#ifdef USE_FIXPOINT_MATHS
-			voice[v].add = sidquot.imul((int)voice[v].freq);
-#else
-			voice[v].add = (uint32)((float)voice[v].freq * SID_FREQ / SAMPLE_FREQ);
-#endif
+			calc_add(v);
 			break;
 
 		case 1:
 		case 8:
 		case 15:
 			voice[v].freq = (voice[v].freq & 0xff) | (byte << 8);
-#ifdef USE_FIXPOINT_MATHS
-			voice[v].add = sidquot.imul((int)voice[v].freq);
-#else
-			voice[v].add = (uint32)((float)voice[v].freq * SID_FREQ / SAMPLE_FREQ);
-#endif
+			calc_add(v);
 			break;
 
 		case 2:
@@ -842,7 +1046,7 @@ void DigitalRenderer::WriteRegister(uint16 adr, uint8 byte)
 		case 22:
 			if (byte != f_freq) {
 				f_freq = byte;
-				if (ThePrefs.SIDFilters)
+				if (the_c64->ThePrefs.SIDFilters)
 					calc_filter();
 			}
 			break;
@@ -853,7 +1057,7 @@ void DigitalRenderer::WriteRegister(uint16 adr, uint8 byte)
 			voice[2].filter = byte & 4;
 			if ((byte >> 4) != f_res) {
 				f_res = byte >> 4;
-				if (ThePrefs.SIDFilters)
+				if (the_c64->ThePrefs.SIDFilters)
 					calc_filter();
 			}
 			break;
@@ -868,7 +1072,7 @@ void DigitalRenderer::WriteRegister(uint16 adr, uint8 byte)
 #else
 				xn1 = xn2 = yn1 = yn2 = 0.0;
 #endif
-				if (ThePrefs.SIDFilters)
+				if (the_c64->ThePrefs.SIDFilters)
 					calc_filter();
 			}
 			break;
@@ -882,16 +1086,139 @@ void DigitalRenderer::WriteRegister(uint16 adr, uint8 byte)
 
 void DigitalRenderer::NewPrefs(Prefs *prefs)
 {
+	new_oversample = prefs->SIDOversample;
+	new_band_limit = prefs->SIDBandLimit;
+
+	if (ready)
+		queue_write(DRW_NEW_PREFS, 0);
+	else
+		apply_prefs();
+}
+
+
+/*
+ *  Take over the preferences (called by calc_buffer())
+ */
+
+void DigitalRenderer::apply_prefs(void)
+{
+	band_limit = new_band_limit;
+
+	if (new_oversample != oversample) {
+		oversample = new_oversample;
+		for (int v=0; v<3; v++)
+			calc_add(v);
+		calc_decimator();
+		memset(os_bus, 0, sizeof(os_bus));
+		os_live[0] = os_live[1] = 0;
+	}
+
 	calc_filter();
 }
 
 
+/*
+ *  Calculate the counter increment of a voice per internal sample
+ */
+
+void DigitalRenderer::calc_add(int v)
+{
+#ifdef USE_FIXPOINT_MATHS
+	uint32 add = sidquot.imul((int)voice[v].freq) / oversample;
+#else
+	uint32 add = (uint32)((float)voice[v].freq * SID_FREQ / (SAMPLE_FREQ * oversample));
+#endif
+
+	// Follow the playback rate set by calc_buffer()
+	if (play_step != PLAY_STEP)
+		add = (uint32)((uint64)add * play_step / PLAY_STEP);
+	voice[v].add = add;
+}
+
+
+/*
+ *  Calculate the decimation filter for the oversampling factor:
+ *  windowed sinc (Blackman) with the cutoff just below half the
+ *  output sample frequency
+ */
+
+void DigitalRenderer::calc_decimator(void)
+{
+	int taps = DEC_TAPS * oversample;
+	double fc = 0.45 / oversample;
+	double h[DEC_TAPS*MAX_OVERSAMPLE];
+	double sum = 0.0;
+
+	for (int k=0; k<taps; k++) {
+		double x = k - (taps - 1) * 0.5;
+		double w = 0.42 - 0.5 * cos(2.0 * M_PI * k / (taps - 1)) + 0.08 * cos(4.0 * M_PI * k / (taps - 1));
+		h[k] = w * sin(2.0 * M_PI * fc * x) / (M_PI * x);
+		sum += h[k];
+	}
+
+	// Unity gain at DC
+	for (int k=0; k<taps; k++)
+#ifdef USE_FIXPOINT_MATHS
+		dec_coef[k] = (int32)floor(h[k] / sum * 65536.0 + 0.5);
+#else
+		dec_coef[k] = h[k] / sum;
+#endif
+}
+
+
+/*
+ *  Decimate bus b to n output samples (polyphase): output m is the
+ *  sum of dec_coef[j*oversample+q] * phase[oversample-1-q][m-j]. The
+ *  inner loop runs over the outputs, the history for the next block
+ *  is moved to the front of the rows.
+ */
+
+void DigitalRenderer::decimate(int32 *dst, int b, int n)
+{
+	int os = oversample;
+#ifdef USE_FIXPOINT_MATHS
+	int64 acc[BLOCK_SIZE];
+	for (int m=0; m<n; m++)
+		acc[m] = 0;
+	for (int q=0; q<os; q++) {
+		const int32 *x = os_bus[b][os-1-q] + DEC_TAPS;
+		for (int j=0; j<DEC_TAPS; j++) {
+			int64 c = dec_coef[j*os+q];
+			for (int m=0; m<n; m++)
+				acc[m] += c * x[m-j];
+		}
+	}
+	for (int m=0; m<n; m++)
+		dst[m] = (int32)((acc[m] + 0x8000) >> 16);
+#else
+	float acc[BLOCK_SIZE];
+	for (int m=0; m<n; m++)
+		acc[m] = 0.0;
+	for (int q=0; q<os; q++) {
+		const int32 *x = os_bus[b][os-1-q] + DEC_TAPS;
+		for (int j=0; j<DEC_TAPS; j++) {
+			float c = dec_coef[j*os+q];
+			for (int m=0; m<n; m++)
+				acc[m] += c * (float)x[m-j];
+		}
+	}
+	for (int m=0; m<n; m++)
+		dst[m] = (int32)acc[m];
+#endif
+
+	for (int q=0; q<os; q++)
+		memmove(os_bus[b][q], os_bus[b][q] + n, DEC_TAPS * sizeof(int32));
+}
+
+
 /*
  *  Calculate IIR filter coefficients
  */
 
 void DigitalRenderer::calc_filter(void)
 {
+	f_changed = true;
+
 #ifdef USE_FIXPOINT_MATHS
 	FixPoint fr, arg;
 
@@ -1032,150 +1359,453 @@ void DigitalRenderer::calc_filter(void)
 
 void DigitalRenderer::calc_buffer(int16 *buf, long count)
 {
-	// Get filter coefficients, so the emulator won't change
-	// them in the middle of our calculations
-#ifdef USE_FIXPOINT_MATHS
-	FixPoint cf_ampl = f_ampl;
-	FixPoint cd1 = d1, cd2 = d2, cg1 = g1, cg2 = g2;
-#else
-	float cf_ampl = f_ampl;
-	float cd1 = d1, cd2 = d2, cg1 = g1, cg2 = g2;
-#endif
-
-	// Index in sample_buf for reading, 16.16 fixed
-	uint32 sample_count = (sample_in_ptr + SAMPLE_BUF_SIZE/2) << 16;
+	// 16 bit output, count is in bytes. The same sample goes to all
+	// channels.
+	int channels = format.channels;
+	count /= 2 * channels;
+
+	// Fill level: the emulated cycles queued ahead of the output. The
+	// buffer must end behind the emulation, which runs in frame sized
+	// bursts, so the target is the buffer plus a bit more than half a
+	// frame. Resynchronize if the output got too far from that (pauses,
+	// speed changes).
+	int32 buf_cycles = (int32)((uint64)count * SID_FREQ / SAMPLE_FREQ);
+	int32 target = buf_cycles + (int32)FRAME_CYCLES/2 + (int32)FRAME_CYCLES/8;
+	uint32 emul = atomic_load32(&emul_cycle);
+	int32 lag = (int32)(emul - play_cycle);
+	if (lag < buf_cycles - (int32)FRAME_CYCLES/4 || lag > target + 2*(int32)FRAME_CYCLES) {
+		play_cycle = emul - target;
+		play_frac = 0;
+		lag = target;
+		fill_error = 0;
+	}
 
-	count >>= 1;	// 16 bit mono output, count is in bytes
-	while (count--) {
-		int32 sum_output;
-		int32 sum_output_filter = 0;
+	// Playback rate: consume the queued cycles a little faster or slower
+	// so the averaged fill level stays at the target, instead of drifting
+	// into a resync. A constant error is worked off in about two seconds.
+	// The oscillators follow the rate, so the output is resampled rather
+	// than stretched.
+	fill_error += (lag - target - fill_error) / 16;
+	int32 dev = (int32)((int64)fill_error * PLAY_STEP / (2 * SID_FREQ));
+	if (dev > MAX_STEP_DEV)
+		dev = MAX_STEP_DEV;
+	else if (dev < -MAX_STEP_DEV)
+		dev = -MAX_STEP_DEV;
+	if (play_step != PLAY_STEP + dev) {
+		play_step = PLAY_STEP + dev;
+		for (int v=0; v<3; v++)
+			calc_add(v);
+	}
 
-		// Get current master volume from sample buffer,
-		// calculate sampled voice
-		uint8 master_volume = sample_buf[(sample_count >> 16) % SAMPLE_BUF_SIZE];
-		sample_count += ((0x138 * 50) << 16) / SAMPLE_FREQ;
-		sum_output = SampleTab[master_volume] << 8;
+	uint32 tail = write_tail;
+	uint32 head = atomic_load32(&write_head);
+
+	while (count > 0) {
+
+		// Apply the register writes up to this sample
+		if (tail == head)
+			head = atomic_load32(&write_head);
+		if (tail != head && (int32)(write_ring[tail & (WRITE_RING_SIZE-1)].cycle - play_cycle) <= 0) {
+			do {
+				const DRWrite *w = &write_ring[tail & (WRITE_RING_SIZE-1)];
+				if (w->adr == DRW_RESET)
+					reset_state();
+				else if (w->adr == DRW_NEW_PREFS)
+					apply_prefs();
+				else
+					set_register(w->adr, w->byte);
+				tail++;
+				if (tail == head)
+					head = atomic_load32(&write_head);
+			} while (tail != head && (int32)(write_ring[tail & (WRITE_RING_SIZE-1)].cycle - play_cycle) <= 0);
+			atomic_store32(&write_tail, tail);
+		}
 
-		// Loop for all three voices
+		// The registers are constant up to the next queued write, render
+		// that many samples (at most one block) at once
+		bool pending = tail != head;
+		uint32 next_cycle = pending ? write_ring[tail & (WRITE_RING_SIZE-1)].cycle : 0;
+		int n = 0;
+		do {
+			play_frac += play_step;
+			play_cycle += play_frac >> 16;
+			play_frac &= 0xffff;
+			n++;
+		} while (n < count && n < BLOCK_SIZE && !(pending && (int32)(next_cycle - play_cycle) <= 0));
+		count -= n;
+
+		// Oscillators, waveforms and envelopes, one voice at a time
+		uint8 master_volume = volume;
+		int os = oversample;
+		calc_counters(n * os);
 		for (int j=0; j<3; j++) {
-			DRVoice *v = &voice[j];
-
-			// Envelope generators
-			uint16 envelope;
+			calc_wave(j, n * os);
+			calc_envelope(j, n, master_volume);
+		}
 
-			switch (v->eg_state) {
-				case EG_ATTACK:
-					v->eg_level += v->a_add;
-					if (v->eg_level > 0xffffff) {
-						v->eg_level = 0xffffff;
-						v->eg_state = EG_DECAY;
-					}
-					break;
-				case EG_DECAY:
-					if (v->eg_level <= v->s_level || v->eg_level > 0xffffff)
-						v->eg_level = v->s_level;
-					else {
-						v->eg_level -= v->d_sub >> EGDRShift[v->eg_level >> 16];
-						if (v->eg_level <= v->s_level || v->eg_level > 0xffffff)
-							v->eg_level = v->s_level;
-					}
-					break;
-				case EG_RELEASE:
-					v->eg_level -= v->r_sub >> EGDRShift[v->eg_level >> 16];
-					if (v->eg_level > 0xffffff) {
-						v->eg_level = 0;
-						v->eg_state = EG_IDLE;
-					}
-					break;
-				case EG_IDLE:
-					v->eg_level = 0;
-					break;
+		// Mix the voices, the sampled voice comes from the master volume
+		int32 sampled = SampleTab[master_volume] << 8;
+		if (os == 1) {
+			for (int i=0; i<n; i++) {
+				blk_out[i] = sampled;
+				blk_filt[i] = 0;
 			}
-			envelope = (v->eg_level * master_volume) >> 20;
-
-			// Waveform generator
-			uint16 output;
-
-			if (!v->test)
-				v->count += v->add;
-
-			if (v->sync && (v->count > 0x1000000))
-				v->mod_to->count = 0;
-
-			v->count &= 0xffffff;
-
-			switch (v->wave) {
-				case WAVE_TRI:
-					if (v->ring)
-						output = TriTable[(v->count ^ (v->mod_by->count & 0x800000)) >> 11];
-					else
-						output = TriTable[v->count >> 11];
-					break;
-				case WAVE_SAW:
-					output = v->count >> 8;
-					break;
-				case WAVE_RECT:
-					if (v->count > (uint32)(v->pw << 12))
-						output = 0xffff;
-					else
-						output = 0;
-					break;
-				case WAVE_TRISAW:
-					output = TriSawTable[v->count >> 16];
-					break;
-				case WAVE_TRIRECT:
-					if (v->count > (uint32)(v->pw << 12))
-						output = TriRectTable[v->count >> 16];
-					else
-						output = 0;
-					break;
-				case WAVE_SAWRECT:
-					if (v->count > (uint32)(v->pw << 12))
-						output = SawRectTable[v->count >> 16];
-					else
-						output = 0;
-					break;
-				case WAVE_TRISAWRECT:
-					if (v->count > (uint32)(v->pw << 12))
-						output = TriSawRectTable[v->count >> 16];
-					else
-						output = 0;
-					break;
-				case WAVE_NOISE:
-					if (v->count > 0x100000) {
-						output = v->noise = sid_random() << 8;
-						v->count &= 0xfffff;
-					} else
-						output = v->noise;
-					break;
-				default:
-					output = 0x8000;
-					break;
+			for (int j=0; j<3; j++) {
+				int32 *sum = voice[j].filter ? blk_filt : blk_out;
+				const int32 *w = blk_wave[j];
+				const int32 *e = blk_env[j];
+				for (int i=0; i<n; i++)
+					sum[i] += w[i] * e[i];
 			}
-			if (v->filter)
-				sum_output_filter += (int16)(output ^ 0x8000) * envelope;
-			else
-				sum_output += (int16)(output ^ 0x8000) * envelope;
+		} else {
+			int32 *dst[2] = {blk_out, blk_filt};
+			for (int b=0; b<2; b++)
+				for (int k=0; k<os; k++)
+					memset(os_bus[b][k] + DEC_TAPS, 0, n * sizeof(int32));
+			for (int j=0; j<3; j++) {
+				int b = voice[j].filter;
+				const int32 *e = blk_env[j];
+				for (int k=0; k<os; k++) {
+					int32 *sum = os_bus[b][k] + DEC_TAPS;
+					const int32 *w = blk_wave[j] + k;
+					for (int i=0; i<n; i++)
+						sum[i] += w[i*os] * e[i];
+				}
+				os_live[b] = DEC_TAPS + n;
+			}
+
+			// Decimate, unless the bus and its history are silent
+			for (int b=0; b<2; b++) {
+				if (os_live[b] > 0) {
+					decimate(dst[b], b, n);
+					os_live[b] -= n;
+				} else
+					memset(dst[b], 0, n * sizeof(int32));
+			}
+			for (int i=0; i<n; i++)
+				blk_out[i] += sampled;
 		}
 
 		// Filter
-		if (ThePrefs.SIDFilters) {
+		if (the_c64->ThePrefs.SIDFilters)
+			filter_block(n);
+
+		// Write to buffer
+		for (int i=0; i<n; i++) {
+			int16 sample = (blk_out[i] + blk_filt[i]) >> 10;
+			for (int c=0; c<channels; c++)
+				*buf++ = sample;
+		}
+	}
+}
+
+
+/*
+ *  The filter registers changed, let the coefficients in use glide
+ *  to the new ones instead of jumping (zipper noise). Intermediate
+ *  poles stay inside the stable region, as it is convex.
+ */
+
+void DigitalRenderer::glide_filter(void)
+{
+	fs_ampl = (f_ampl - fc_ampl) / FILTER_RAMP;
+	fs_d1 = (d1 - fc_d1) / FILTER_RAMP;
+	fs_d2 = (d2 - fc_d2) / FILTER_RAMP;
+	fs_g1 = (g1 - fc_g1) / FILTER_RAMP;
+	fs_g2 = (g2 - fc_g2) / FILTER_RAMP;
+	f_ramp = FILTER_RAMP;
+	f_changed = false;
+}
+
+
+/*
+ *  Run the IIR filter over the filtered voices of one block
+ */
+
+void DigitalRenderer::filter_block(int n)
+{
+	if (f_changed)
+		glide_filter();
+
+	int i = 0;
+
+	// Coefficients gliding, one sample at a time
+	for (; i<n && f_ramp; i++) {
+		if (--f_ramp) {
+			fc_ampl += fs_ampl;
+			fc_d1 += fs_d1; fc_d2 += fs_d2;
+			fc_g1 += fs_g1; fc_g2 += fs_g2;
+		} else {
+			fc_ampl = f_ampl;
+			fc_d1 = d1; fc_d2 = d2;
+			fc_g1 = g1; fc_g2 = g2;
+		}
 #ifdef USE_FIXPOINT_MATHS
-			int32 xn = cf_ampl.imul(sum_output_filter);
-			int32 yn = xn+cd1.imul(xn1)+cd2.imul(xn2)-cg1.imul(yn1)-cg2.imul(yn2);
-			yn2 = yn1; yn1 = yn; xn2 = xn1; xn1 = xn;
-			sum_output_filter = yn;
+		int32 xn = fc_ampl.imul(blk_filt[i]);
+		int32 yn = xn+fc_d1.imul(xn1)+fc_d2.imul(xn2)-fc_g1.imul(yn1)-fc_g2.imul(yn2);
+		yn2 = yn1; yn1 = yn; xn2 = xn1; xn1 = xn;
+		blk_filt[i] = yn;
 #else
-			float xn = (float)sum_output_filter * cf_ampl;
-			float yn = xn + cd1 * xn1 + cd2 * xn2 - cg1 * yn1 - cg2 * yn2;
-			yn2 = yn1; yn1 = yn; xn2 = xn1; xn1 = xn;
-			sum_output_filter = (int32)yn;
+		float xn = (float)blk_filt[i] * fc_ampl;
+		float yn = xn + fc_d1 * xn1 + fc_d2 * xn2 - fc_g1 * yn1 - fc_g2 * yn2;
+		yn2 = yn1; yn1 = yn; xn2 = xn1; xn1 = xn;
+		blk_filt[i] = (int32)yn;
 #endif
+	}
+	if (i == n)
+		return;
+
+	// Constant coefficients for the rest of the block, keep them and
+	// the filter state in registers
+	int m = n - i;
+	int32 *f = blk_filt + i;
+#ifdef USE_FIXPOINT_MATHS
+	FixPoint a = fc_ampl, b1 = fc_d1, b2 = fc_d2, a1 = fc_g1, a2 = fc_g2;
+	int32 x1 = xn1, x2 = xn2, y1 = yn1, y2 = yn2;
+	for (int k=0; k<m; k++) {
+		int32 xn = a.imul(f[k]);
+		int32 yn = xn+b1.imul(x1)+b2.imul(x2)-a1.imul(y1)-a2.imul(y2);
+		x2 = x1; x1 = xn; y2 = y1; y1 = yn;
+		f[k] = yn;
+	}
+#else
+	float a = fc_ampl, b1 = fc_d1, b2 = fc_d2, a1 = fc_g1, a2 = fc_g2;
+	float x1 = xn1, x2 = xn2, y1 = yn1, y2 = yn2;
+	for (int k=0; k<m; k++) {
+		float xn = (float)f[k] * a;
+		float yn = xn + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+		x2 = x1; x1 = xn; y2 = y1; y1 = yn;
+		f[k] = (int32)yn;
+	}
+#endif
+	xn1 = x1; xn2 = x2; yn1 = y1; yn2 = y2;
+}
+
+
+/*
+ *  Advance the oscillator counters of all voices for one block.
+ *  blk_count[v][0] holds the counter before the block. Without hard
+ *  sync the voices are independent and the counters form a plain
+ *  ramp; with sync they are stepped together as the SID does. The
+ *  noise generator wraps the counter, so its output is calculated
+ *  here, too.
+ */
+
+void DigitalRenderer::calc_counters(int n)
+{
+	for (int j=0; j<3; j++)
+		blk_count[j][0] = voice[j].count;
+
+	if (voice[0].sync || voice[1].sync || voice[2].sync) {
+		for (int i=1; i<=n; i++)
+			for (int j=0; j<3; j++) {
+				DRVoice *v = &voice[j];
+				if (!v->test)
+					v->count += v->add;
+				if (v->sync && (v->count > 0x1000000))
+					v->mod_to->count = 0;
+				v->count &= 0xffffff;
+				if (v->wave == WAVE_NOISE) {
+					if (v->count > 0x100000) {
+						v->noise = sid_random(noise_seed) << 8;
+						v->count &= 0xfffff;
+					}
+					blk_wave[j][i-1] = (int32)v->noise - 0x8000;
+				}
+				blk_count[j][i] = v->count;
+			}
+		return;
+	}
+
+	for (int j=0; j<3; j++) {
+		DRVoice *v = &voice[j];
+		uint32 *c = blk_count[j];
+		uint32 count = v->count;
+		uint32 add = v->test ? 0 : v->add;
+
+		if (v->wave == WAVE_NOISE) {
+			int32 *w = blk_wave[j];
+			for (int i=1; i<=n; i++) {
+				count = (count + add) & 0xffffff;
+				if (count > 0x100000) {
+					v->noise = sid_random(noise_seed) << 8;
+					count &= 0xfffff;
+				}
+				w[i-1] = (int32)v->noise - 0x8000;
+				c[i] = count;
+			}
+		} else {
+			for (int i=1; i<=n; i++)
+				c[i] = (count + add * i) & 0xffffff;
+			count = c[n];
 		}
+		v->count = count;
+	}
+}
 
-		// Write to buffer
-		*buf++ = (sum_output + sum_output_filter) >> 10;
+
+/*
+ *  Polynomial band-limited step (polyBLEP) for a full scale step
+ *  (0x10000) of a waveform, t is the counter relative to the step,
+ *  dt the counter increment per sample. Returns the correction to
+ *  subtract from a falling step (add to a rising one), which is
+ *  only non-zero within one sample on both sides of the step.
+ */
+
+static inline int32 poly_blep(uint32 t, uint32 dt)
+{
+	if (t < dt) {
+		int32 d = 0x8000 - (int32)(((uint64)t << 15) / dt);
+		return -((d * d) >> 15);
+	} else if (t > 0x1000000 - dt) {
+		int32 d = 0x8000 - (int32)(((uint64)(0x1000000 - t) << 15) / dt);
+		return (d * d) >> 15;
 	}
+	return 0;
+}
+
+
+/*
+ *  Calculate the waveform output of one voice for one block,
+ *  centered around 0. With band_limit, the steps of sawtooth and
+ *  pulse are smoothed by polyBLEP to reduce aliasing.
+ */
+
+void DigitalRenderer::calc_wave(int v, int n)
+{
+	DRVoice *vp = &voice[v];
+	const uint32 *c = blk_count[v] + 1;
+	int32 *w = blk_wave[v];
+	uint32 pw = vp->pw << 12;
+
+	switch (vp->wave) {
+		case WAVE_TRI:
+			if (vp->ring) {
+				// Counter of the modulating voice as seen by this one,
+				// voice 1 gets voice 3 of the previous sample
+				const uint32 *m = v ? blk_count[v-1] + 1 : blk_count[2];
+				for (int i=0; i<n; i++)
+					w[i] = TriTable[(c[i] ^ (m[i] & 0x800000)) >> 11] - 0x8000;
+			} else
+				for (int i=0; i<n; i++)
+					w[i] = TriTable[c[i] >> 11] - 0x8000;
+			break;
+		case WAVE_SAW:
+			for (int i=0; i<n; i++)
+				w[i] = (int32)(c[i] >> 8) - 0x8000;
+			if (band_limit) {
+				uint32 dt = vp->add;
+				for (int i=0; i<n; i++)
+					w[i] -= poly_blep(c[i], dt);
+			}
+			break;
+		case WAVE_RECT:
+			for (int i=0; i<n; i++)
+				w[i] = c[i] > pw ? 0x7fff : -0x8000;
+			if (band_limit) {
+				uint32 dt = vp->add;
+				for (int i=0; i<n; i++)
+					w[i] += poly_blep((c[i] - pw) & 0xffffff, dt) - poly_blep(c[i], dt);
+			}
+			break;
+		case WAVE_TRISAW:
+			for (int i=0; i<n; i++)
+				w[i] = TriSawTable[c[i] >> 16] - 0x8000;
+			break;
+		case WAVE_TRIRECT:
+			for (int i=0; i<n; i++)
+				w[i] = (c[i] > pw ? TriRectTable[c[i] >> 16] : 0) - 0x8000;
+			break;
+		case WAVE_SAWRECT:
+			for (int i=0; i<n; i++)
+				w[i] = (c[i] > pw ? SawRectTable[c[i] >> 16] : 0) - 0x8000;
+			break;
+		case WAVE_TRISAWRECT:
+			for (int i=0; i<n; i++)
+				w[i] = (c[i] > pw ? TriSawRectTable[c[i] >> 16] : 0) - 0x8000;
+			break;
+		case WAVE_NOISE:	// Clocked by calc_counters()
+			break;
+		default:
+			memset(w, 0, n * sizeof(int32));
+			break;
+	}
+}
+
+
+/*
+ *  Calculate the envelope of one voice for one block, scaled by
+ *  the master volume. The state only changes at the ends of the
+ *  attack and release ramps.
+ */
+
+void DigitalRenderer::calc_envelope(int v, int n, uint8 master_volume)
+{
+	DRVoice *vp = &voice[v];
+	int32 *e = blk_env[v];
+	uint32 level = vp->eg_level;
+	int i = 0;
+
+	while (i < n) {
+		switch (vp->eg_state) {
+			case EG_ATTACK: {
+				uint32 add = vp->a_add;
+				uint32 ramp = (0xffffff - level) / add;	// Samples below the maximum
+				if (ramp > (uint32)(n - i))
+					ramp = n - i;
+				for (int k=0; k<(int)ramp; k++)
+					e[i+k] = ((level + add * (k+1)) * master_volume) >> 20;
+				level += add * ramp;
+				i += ramp;
+				if (i < n) {
+					level = 0xffffff;
+					e[i++] = (level * master_volume) >> 20;
+					vp->eg_state = EG_DECAY;
+				}
+				break;
+			}
+
+			case EG_DECAY: {
+				uint32 s_level = vp->s_level;
+				for (; i<n && level != s_level; i++) {
+					if (level <= s_level || level > 0xffffff)
+						level = s_level;
+					else {
+						level -= vp->d_sub >> EGDRShift[level >> 16];
+						if (level <= s_level || level > 0xffffff)
+							level = s_level;
+					}
+					e[i] = (level * master_volume) >> 20;
+				}
+
+				// Sustain
+				int32 env = (level * master_volume) >> 20;
+				for (; i<n; i++)
+					e[i] = env;
+				break;
+			}
+
+			case EG_RELEASE:
+				for (; i<n; i++) {
+					level -= vp->r_sub >> EGDRShift[level >> 16];
+					if (level > 0xffffff) {
+						level = 0;
+						e[i++] = 0;
+						vp->eg_state = EG_IDLE;
+						break;
+					}
+					e[i] = (level * master_volume) >> 20;
+				}
+				break;
+
+			default:
+				level = 0;
+				for (; i<n; i++)
+					e[i] = 0;
+				break;
+		}
+	}
+	vp->eg_level = level;
 }
 
 /*
@@ -1217,8 +1847,14 @@ DigitalRenderer::~DigitalRenderer()
 {
     if (ready) {
         ready = false;
-        SDL_CloseAudio();
+        if (!null_sink)
+        {
+            SDL_CloseAudio();
+        }
     }
+
+    delete[] null_buffer;
+    null_buffer = NULL;
 }
 
 void audioCallback(void* userdata, uint8* stream, int len)
@@ -1236,6 +1872,9 @@ void DigitalRenderer::mixAudio(uint8* stream, int len)
 void DigitalRenderer::init_sound()
 {
     ready = false;
+    null_sink = the_c64->isHeadless();
+    null_buffer = NULL;
+    null_lines = 0;
 
     format.freq      = SAMPLE_FREQ;
     format.format    = AUDIO_S16;
@@ -1243,10 +1882,19 @@ void DigitalRenderer::init_sound()
 
     int numSamples  = SAMPLE_FREQ / CALC_FREQ;
 
-    format.samples  = numSamples;
+    format.samples  = DEVICE_SAMPLES;
     format.callback = ::audioCallback;
     format.userdata = this;
 
+    if (null_sink)
+    {
+        // Headless: no device, the buffer is pulled once per frame by EmulateLine()
+        format.size = numSamples * format.channels * sizeof(int16);
+        null_buffer = new int16[format.size / sizeof(int16)];
+        ready = true;
+        return;
+    }
+
     if ( SDL_OpenAudio(&format, NULL) < 0 )
     {
         fprintf(stderr, "Unable to open sound device: %s\n", SDL_GetError());
@@ -1262,8 +1910,14 @@ void DigitalRenderer::EmulateLine()
 	if (!ready)
 		return;
 
-	sample_buf[sample_in_ptr] = volume;
-	sample_in_ptr = (sample_in_ptr + 1) % SAMPLE_BUF_SIZE;
+	line_cycle += CYCLES_PER_LINE;
+	atomic_store32(&emul_cycle, emulated_cycle());
+
+	// Null sink consumes one buffer per emulated frame like the audio callback would
+	if (null_sink && ++null_lines == TOTAL_RASTERS) {
+		null_lines = 0;
+		calc_buffer(null_buffer, format.size);
+	}
 
 }
 
@@ -1275,7 +1929,7 @@ void DigitalRenderer::VBlank()
 
 void DigitalRenderer::Pause()
 {
-	if (!ready)
+	if (!ready || null_sink)
 		return;
 
     SDL_PauseAudio(1);
@@ -1283,7 +1937,7 @@ void DigitalRenderer::Pause()
 
 void DigitalRenderer::Resume()
 {
-	if (!ready)
+	if (!ready || null_sink)
 		return;
 
     SDL_PauseAudio(0);
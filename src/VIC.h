@@ -19,6 +19,9 @@ const unsigned TOTAL_RASTERS = 0x138;
 // Screen refresh frequency (PAL)
 const unsigned SCREEN_FREQ = 50;
 
+// Number of CPU cycles per raster line (PAL)
+const unsigned CYCLES_PER_LINE = 63;
+
 
 class MOS6510;
 class C64Display;
@@ -29,6 +32,9 @@ struct MOS6569State;
 class MOS6569 {
 public:
 	MOS6569(C64 *c64, C64Display *disp, MOS6510 *CPU, uint8 *RAM, uint8 *Char, uint8 *Color);
+#ifndef FRODO_SC
+	~MOS6569();
+#endif
 
 	uint8 ReadRegister(uint16 adr);
 	void WriteRegister(uint16 adr, uint8 byte);
@@ -157,20 +163,64 @@ private:
 
 	uint32 first_ba_cycle;		// Cycle when BA first went low
 #else
+	// State of a raster line as latched by EmulateLine(), with the
+	// graphics data already fetched. Drawing a line only needs this
+	// and the constant tables, so it can happen on the render worker.
+	struct line_record_t {
+		uint8 *dest;			// Line in the bitmap buffer
+		uint8 *dirty;			// Dirty flag of the line
+		int row;				// Row in the bitmap buffer
+		int display_idx;
+		bool display_state;
+		bool border_on;
+		bool border_40_col;
+		uint8 x_scroll;
+		uint8 ec_color;
+		uint8 bc[4];			// b0c..b3c
+		uint8 bc_color[4];		// b0c_color..b3c_color
+		uint8 idle_data;		// Graphics data in idle state
+		uint8 matrix[40];
+		uint8 color[40];
+		uint8 gfx[40];			// Character/bitmap data of the 40 columns
+	};
+
 	uint8 *get_physical(uint16 adr);
-	void make_mc_table(void);
-	void el_std_text(uint8 *p, uint8 *q, uint8 *r);
-	void el_mc_text(uint8 *p, uint8 *q, uint8 *r);
-	void el_std_bitmap(uint8 *p, uint8 *q, uint8 *r);
-	void el_mc_bitmap(uint8 *p, uint8 *q, uint8 *r);
-	void el_ecm_text(uint8 *p, uint8 *q, uint8 *r);
-	void el_std_idle(uint8 *p, uint8 *r);
-	void el_mc_idle(uint8 *p, uint8 *r);
+	void latch_line(line_record_t *l, int raster);
+	void draw_graphics(const line_record_t *l, uint8 *chunky_ptr, uint8 *r, uint8 *text_buf) const;
+	void draw_side_border(const line_record_t *l, uint8 *chunky_ptr) const;
+	void finish_line(const line_record_t *l, uint8 *chunky_ptr) const;
+	void el_std_text(uint8 *p, uint8 *r, const line_record_t *l) const;
+	void el_mc_text(uint8 *p, uint8 *r, const line_record_t *l) const;
+	void el_std_bitmap(uint8 *p, uint8 *r, const line_record_t *l) const;
+	void el_mc_bitmap(uint8 *p, uint8 *r, const line_record_t *l) const;
+	void el_ecm_text(uint8 *p, uint8 *r, const line_record_t *l) const;
+	void el_std_idle(uint8 *p, uint8 *r, const line_record_t *l) const;
+	void el_mc_idle(uint8 *p, uint8 *r, const line_record_t *l) const;
 	void el_sprites(uint8 *chunky_ptr);
 	int el_update_mc(int raster);
 
-	uint16 mc_color_lookup[4];
+	static int line_worker_entry(void *arg);
+	void line_worker(void);
+	void wait_line_worker(void);
+
+	line_record_t line_record;	// Line drawn on the emulation thread
+
+	line_record_t *line_ring;	// Lines for the render worker (NULL: no worker)
+	volatile uint32 line_head;	// Next record to fill, written by EmulateLine()
+	volatile uint32 line_tail;	// Next record to draw, written by the worker
+	volatile uint32 line_quit;	// Flag: Worker shall quit
+	SDL_Thread *line_thread;
+	SDL_sem *line_wake;			// Posted when there are lines to draw
+
+	uint64 colors_wide[256];	// colors[] repeated in 8 bytes
+	uint64 rgba_pairs[256];		// Two RGBA pixels, index is (left & 0x0f) << 4 | (right & 0x0f)
+	uint32 rgba_line_buf[0x180/4];	// Line buffer for RGBA output
+	uint32 skip_line_buf[0x180/4];	// Scratch line for sprite collisions in skipped frames
+	uint8 *dirty_rows;			// Flags for the display: row differs from the last drawn frame
+	uint8 *last_lines;			// Rows of the last drawn frame, for the dirty row flags
 
+	bool simd_lines;			// Flag: Use SIMD line renderers
+	bool rgba_lines;			// Flag: Frame buffer has RGBA pixels, draw into rgba_line_buf
 	bool border_40_col;			// Flag: 40 column border
 	uint8 sprite_on;			// 8 flags: Sprite display/DMA active
 
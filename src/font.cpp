@@ -1,5 +1,5 @@
 /*
- *  texture.cpp - OpenGL texture
+ *  font.cpp - TrueType font with glyph atlas
  *
  *  Frodo (C) 1994-1997,2002 Christian Bauer
  */
@@ -8,12 +8,15 @@
 #if USE_OPENGL
 
 #include "renderer.h"
+#include "texture.h"
 #include "font.h"
 
 Font::Font()
 {
     obj = NULL;
     attached = false;
+    atlas = NULL;
+    memset(glyphs, 0, sizeof(glyphs));
 
     info.ascent = info.descent = info.height = info.lineSkip = 0;
     strcpy(info.family, "");
@@ -23,6 +26,8 @@ Font::Font(const char* name, float logSize)
 {
     obj = NULL;
     attached = false;
+    atlas = NULL;
+    memset(glyphs, 0, sizeof(glyphs));
 
     create(name, logSize);
 }
@@ -32,6 +37,8 @@ Font::Font(const Font& font)
     obj = font.obj;
     info = font.info;
     attached = true;
+    atlas = NULL;
+    memset(glyphs, 0, sizeof(glyphs));
 }
 
 Font::~Font()
@@ -77,6 +84,8 @@ float Font::getHeight()
 
 void Font::free()
 {
+    freeAtlas();
+
     if (!attached && NULL != obj)
     {
         TTF_CloseFont(obj);
@@ -96,4 +105,167 @@ const FontInfo& Font::getInfo()
     return info;
 }
 
+/*
+ *  Glyph atlas: every printable Latin-1 character is rendered once into
+ *  a single texture, so text draws are one textured vertex batch
+ *  without surface or texture allocation per call
+ */
+
+Texture* Font::getAtlas()
+{
+    if (NULL == atlas && NULL != obj)
+    {
+        createAtlas();
+    }
+
+    return atlas;
+}
+
+int Font::getTextWidth(const char* text) const
+{
+    int width = 0;
+    int pen = 0;
+
+    for (const uint8* p = (const uint8*) text; 0 != *p; p++)
+    {
+        const FontGlyph& glyph = glyphs[*p];
+        if (pen + glyph.width > width) width = pen + glyph.width;
+        pen += glyph.advance;
+    }
+
+    return pen > width ? pen : width;
+}
+
+bool Font::createAtlas()
+{
+    SDL_Surface* surfaces[256];
+    int posX[256];
+    int posY[256];
+
+    memset(glyphs, 0, sizeof(glyphs));
+
+    // Render the glyphs as one character strings, so they carry the
+    // vertical placement within the line, and pack them row by row
+    SDL_Color color = {0xff, 0xff, 0xff, 0};
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+
+    for (int c=0; c<256; c++)
+    {
+        surfaces[c] = NULL;
+
+        if (c < 0x20 || (c >= 0x7f && c < 0xa0))
+        {
+            continue;
+        }
+
+        char text[2] = { (char) c, 0 };
+        SDL_Surface* surface = TTF_RenderText_Blended(obj, text, color);
+        if (NULL == surface)
+        {
+            continue;
+        }
+
+        if (surface->format->BytesPerPixel != 4 || surface->w > ATLAS_WIDTH)
+        {
+            SDL_FreeSurface(surface);
+            continue;
+        }
+
+        if (x + surface->w > ATLAS_WIDTH)
+        {
+            x = 0;
+            y += rowHeight + ATLAS_PADDING;
+            rowHeight = 0;
+        }
+
+        surfaces[c] = surface;
+        posX[c] = x;
+        posY[c] = y;
+
+        x += surface->w + ATLAS_PADDING;
+        if (surface->h > rowHeight) rowHeight = surface->h;
+
+        int minx, maxx, miny, maxy, advance;
+        if (0 != TTF_GlyphMetrics(obj, (Uint16) c, &minx, &maxx, &miny, &maxy, &advance))
+        {
+            advance = surface->w;
+        }
+
+        glyphs[c].width = surface->w;
+        glyphs[c].height = surface->h;
+        glyphs[c].advance = advance;
+    }
+
+    int atlasHeight = 1;
+    while (atlasHeight < y + rowHeight)
+    {
+        atlasHeight <<= 1;
+    }
+
+    // White pixels, coverage in alpha, as the blended text surfaces were
+    uint8* pixels = new uint8[ATLAS_WIDTH * atlasHeight * 4];
+    memset(pixels, 0, ATLAS_WIDTH * atlasHeight * 4);
+
+    for (int c=0; c<256; c++)
+    {
+        SDL_Surface* surface = surfaces[c];
+        if (NULL == surface)
+        {
+            continue;
+        }
+
+        SDL_LockSurface(surface);
+
+        const SDL_PixelFormat* format = surface->format;
+        for (int row=0; row<surface->h; row++)
+        {
+            const uint32* src = (const uint32*) ((const uint8*) surface->pixels + row * surface->pitch);
+            uint8* dest = pixels + ((posY[c] + row) * ATLAS_WIDTH + posX[c]) * 4;
+
+            for (int col=0; col<surface->w; col++)
+            {
+                dest[0] = dest[1] = dest[2] = 0xff;
+                dest[3] = (uint8) ((src[col] & format->Amask) >> format->Ashift);
+                dest += 4;
+            }
+        }
+
+        SDL_UnlockSurface(surface);
+        SDL_FreeSurface(surface);
+
+        glyphs[c].u1 = (float) posX[c] / (float) ATLAS_WIDTH;
+        glyphs[c].v1 = (float) posY[c] / (float) atlasHeight;
+        glyphs[c].u2 = (float) (posX[c] + glyphs[c].width) / (float) ATLAS_WIDTH;
+        glyphs[c].v2 = (float) (posY[c] + glyphs[c].height) / (float) atlasHeight;
+    }
+
+    atlas = new Texture();
+    bool status = atlas->create(ATLAS_WIDTH, atlasHeight, 32, pixels);
+    atlas->setAntialias(true);
+
+    delete [] pixels;
+
+    if (!status)
+    {
+        fprintf(stderr, "Can't create glyph atlas for font %s\n", info.family);
+        freeAtlas();
+        return false;
+    }
+
+    return true;
+}
+
+void Font::freeAtlas()
+{
+    if (NULL != atlas)
+    {
+        delete atlas;
+        atlas = NULL;
+    }
+
+    memset(glyphs, 0, sizeof(glyphs));
+}
+
 #endif
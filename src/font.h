@@ -1,5 +1,5 @@
 /*
- *  texture.cpp - OpenGL texture
+ *  font.h - TrueType font with glyph atlas
  *
  *  Frodo (C) 1994-1997,2002 Christian Bauer
  */
@@ -16,13 +16,33 @@ typedef struct
     char family[512];
 } FontInfo;
 
+typedef struct
+{
+    float u1, v1, u2, v2;   // Texture coordinates in the atlas
+    int width;              // Quad size, 0 if the character has no glyph
+    int height;
+    int advance;            // Pen movement to the next character
+} FontGlyph;
+
+class Texture;
+
 class Font
 {
+    private:
+        enum
+        {
+            ATLAS_WIDTH = 512,
+            ATLAS_PADDING = 1
+        };
+
     private:
         TTF_Font* obj;
         FontInfo info;
         bool attached;
 
+        Texture* atlas;         // Built on first use, needs a GL context
+        FontGlyph glyphs[256];  // Latin-1
+
     public:
         Font();
         Font(const char* name, float logSize);
@@ -36,6 +56,14 @@ class Font
         void* getInternal() const;
         float getHeight();
         const FontInfo& getInfo();
+
+        Texture* getAtlas();
+        const FontGlyph& getGlyph(uint8 c) const { return glyphs[c]; }
+        int getTextWidth(const char* text) const;
+
+    private:
+        bool createAtlas();
+        void freeAtlas();
 };
 
 #endif // __FONT_H
@@ -9,14 +9,37 @@
 #include "main.h"
 #include "C64.h"
 #include "Display.h"
+#include "VIC.h"
 #include "Prefs.h"
 #include "SAM.h"
 #include "Input.h"
+#include "Benchmark.h"
 #include "virtual_joystick.h"
 
+#ifdef WIN32
+#include <io.h>
+#endif
+
 bool run_async_emulation = true;
 bool limitFramerate = true;
 
+#ifdef HEADLESS
+bool headless = true;       // Headless build: no display, no audio
+#else
+bool headless = false;      // Set by -headless
+#endif
+
+uint32 maxFrames = 0;       // Quit after this number of frames (0: run forever)
+bool benchmark = false;     // Set by -benchmark, report emulation speed on exit
+char snapshotPath[256];     // Snapshot to load at startup (-snapshot)
+char benchmarkSuite[256];   // Benchmark suite to run instead of the emulator (-benchsuite)
+char benchmarkReport[256];  // CSV report of the benchmark suite (-benchout, default: stdout)
+FILE* benchmarkStdout;      // Original stdout for the report, other output goes to stderr then
+char profilePath[256];      // Per-frame profile dump (-profile, needs PROFILING build)
+bool use_simd = true;       // Cleared by -nosimd, use the scalar graphics code only
+bool rgba_output = false;   // Set by -rgba, the VIC writes RGBA pixels (line-based VIC only)
+bool threaded_vic = false;  // Set by -victhread, lines without sprites are drawn by a worker thread (line-based VIC only)
+
 // Global variables
 char AppDirPath[1024];	// Path of application directory
 Frodo *TheApp = NULL;   // The application.
@@ -40,13 +63,79 @@ bool Frodo::initialize(int argc, char **argv)
 {
     running = false;
 
-	if (argc == 2)
+    prefs_path[0] = 0;
+    snapshotPath[0] = 0;
+    benchmarkSuite[0] = 0;
+    benchmarkReport[0] = 0;
+    profilePath[0] = 0;
+
+    for (int i=1; i<argc; i++)
     {
-		strncpy(prefs_path, argv[1], 255);
+        if (0 == strcmp(argv[i], "-headless"))
+        {
+            headless = true;
+        }
+        else if (0 == strcmp(argv[i], "-frames") && i+1 < argc)
+        {
+            maxFrames = (uint32) atol(argv[++i]);
+        }
+        else if (0 == strcmp(argv[i], "-benchmark") && i+1 < argc)
+        {
+            benchmark = true;
+            headless = true;
+            maxFrames = (uint32) atol(argv[++i]);
+        }
+        else if (0 == strcmp(argv[i], "-snapshot") && i+1 < argc)
+        {
+            strncpy(snapshotPath, argv[++i], 255);
+        }
+        else if (0 == strcmp(argv[i], "-benchsuite") && i+1 < argc)
+        {
+            headless = true;
+            strncpy(benchmarkSuite, argv[++i], 255);
+        }
+        else if (0 == strcmp(argv[i], "-benchout") && i+1 < argc)
+        {
+            strncpy(benchmarkReport, argv[++i], 255);
+        }
+        else if (0 == strcmp(argv[i], "-profile") && i+1 < argc)
+        {
+            strncpy(profilePath, argv[++i], 255);
+        }
+        else if (0 == strcmp(argv[i], "-nosimd"))
+        {
+            use_simd = false;
+        }
+        else if (0 == strcmp(argv[i], "-rgba"))
+        {
+            #ifdef FRODO_SC
+                fprintf(stderr, "-rgba needs the line-based VIC, ignored\n");
+            #else
+                rgba_output = true;
+            #endif
+        }
+        else if (0 == strcmp(argv[i], "-victhread"))
+        {
+            #ifdef FRODO_SC
+                fprintf(stderr, "-victhread needs the line-based VIC, ignored\n");
+            #else
+                threaded_vic = true;
+            #endif
+        }
+        else
+        {
+		    strncpy(prefs_path, argv[i], 255);
+        }
     }
 
 	getcwd(AppDirPath, 256);
 
+    if (benchmarkSuite[0])
+    {
+        // Every workload creates its own C64
+        return true;
+    }
+
 	// Load preferences
 	if (!prefs_path[0])
 	{
@@ -58,15 +147,39 @@ bool Frodo::initialize(int argc, char **argv)
 		strcat(prefs_path, ".frodorc");
 	}
 
-	ThePrefs.Load(prefs_path);
-
-	// Create and start C64
+	// Create C64 and load its preferences
 	TheC64 = new C64;
-    if (false == TheC64->init())
+	TheC64->ThePrefs.Load(prefs_path);
+
+	// Start C64
+    if (false == TheC64->init(headless))
+    {
+        return false;
+    }
+
+    if (snapshotPath[0] && !TheC64->LoadSnapshot(snapshotPath))
+    {
+        fprintf(stderr, "Couldn't load snapshot %s\n", snapshotPath);
+        return false;
+    }
+
+    if (benchmark && 0 == maxFrames)
     {
+        fprintf(stderr, "Benchmark needs a frame count\n");
         return false;
     }
 
+    TheC64->setFrameLimit(maxFrames);
+
+    if (profilePath[0])
+    {
+        #ifdef PROFILING
+            TheC64->profiler.openDump(profilePath);
+        #else
+            fprintf(stderr, "Profiling not compiled in (build with -DPROFILING)\n");
+        #endif
+    }
+
     return true;
 }
 
@@ -80,6 +193,51 @@ void Frodo::run()
 {
     running = true;
 
+    if (benchmarkSuite[0])
+    {
+        FILE* report = benchmarkReport[0] ? fopen(benchmarkReport, "w") : benchmarkStdout;
+        if (NULL == report)
+        {
+            fprintf(stderr, "Can't write benchmark report %s\n", benchmarkReport);
+        }
+        else
+        {
+            BenchmarkSuite suite;
+            if (suite.load(benchmarkSuite))
+            {
+                suite.run(report);
+            }
+
+            if (report != benchmarkStdout)
+            {
+                fclose(report);
+            }
+            else
+            {
+                fflush(report);
+            }
+        }
+        running = false;
+        return;
+    }
+
+    if (headless)
+    {
+        // No display and no events, emulate on the calling thread
+        uint32 startFrame = TheC64->getFrameCount();
+        uint64 startTime = host_time_ns();
+
+        emulationLoop();
+
+        if (benchmark)
+        {
+            reportBenchmark(TheC64->getFrameCount() - startFrame, host_time_ns() - startTime);
+        }
+
+        running = false;
+        return;
+    }
+
     SDL_Thread* emulation_thread = NULL;
     
     if (run_async_emulation)
@@ -89,7 +247,7 @@ void Frodo::run()
 
     Uint32 start = 0;
     Uint32 elapsed = 0;
-    Uint32 maxFramerate = 50 / ThePrefs.SkipFrames;
+    Uint32 maxFramerate = (TheC64->ThePrefs.SkipFrames > 0) ? SCREEN_FREQ / TheC64->ThePrefs.SkipFrames : SCREEN_FREQ;
     Uint32 cycleTime = 1000 / maxFramerate;
     Uint32 cycleTimeOSD = 1000 / 50;
 
@@ -160,6 +318,29 @@ void Frodo::doStep()
     TheC64->doStep();
 }
 
+/*
+ *  Print emulation throughput of a benchmark run
+ */
+
+void Frodo::reportBenchmark(uint32 frames, uint64 elapsed_ns)
+{
+    double seconds = (double) elapsed_ns / 1.0e9;
+    double lines = (double) frames * TOTAL_RASTERS;
+    double cycles = lines * CYCLES_PER_LINE;
+
+    if (0 == frames || seconds <= 0.0)
+    {
+        printf("Benchmark: no frames emulated\n");
+        return;
+    }
+
+    printf("Benchmark: %u frames in %.3f s\n", frames, seconds);
+    printf("  frames/s:       %.1f (%.0f%% of real time)\n", frames / seconds, 100.0 * frames / (seconds * SCREEN_FREQ));
+    printf("  cycles/s:       %.0f\n", cycles / seconds);
+    printf("  ns/raster line: %.1f\n", (double) elapsed_ns / lines);
+    fflush(stdout);
+}
+
 void Frodo::shutdown()
 {
     running = false;
@@ -338,8 +519,36 @@ void Frodo::handleEvent(SDL_Event* event)
 
 int main(int argc, char **argv)
 {
-	// Init SDL
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK ) < 0)
+    bool suite = false, suiteOut = false;
+    for (int i=1; i<argc; i++)
+    {
+        if (0 == strcmp(argv[i], "-headless") || 0 == strcmp(argv[i], "-benchmark") ||
+            0 == strcmp(argv[i], "-benchsuite"))
+        {
+            headless = true;
+        }
+        suite = suite || 0 == strcmp(argv[i], "-benchsuite");
+        suiteOut = suiteOut || 0 == strcmp(argv[i], "-benchout");
+    }
+
+    // A benchmark report on stdout stays machine readable: it gets the
+    // original stdout, everything else printed (the drive emulation is
+    // chatty) goes to stderr
+    benchmarkStdout = stdout;
+    if (suite && !suiteOut)
+    {
+        int fd = dup(fileno(stdout));
+        FILE* report = fd >= 0 ? fdopen(fd, "w") : NULL;
+        if (NULL != report)
+        {
+            benchmarkStdout = report;
+            dup2(fileno(stderr), fileno(stdout));
+        }
+    }
+
+	// Init SDL (headless mode only needs the timer)
+    Uint32 sdlFlags = headless ? SDL_INIT_TIMER : (SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK);
+	if (SDL_Init(sdlFlags) < 0)
 	{
 		fprintf(stderr, "Couldn't initialize SDL (%s)\n", SDL_GetError());
 		return 0;
@@ -350,11 +559,13 @@ int main(int argc, char **argv)
         atexit(PDL_Quit);
     #endif
 
-    if (TTF_Init() == -1)
-    {
-        fprintf(stderr, "Unable to initialize SDL_ttf: %s\n", TTF_GetError());
-        return 0;
-    }
+    #ifndef HEADLESS
+        if (!headless && TTF_Init() == -1)
+        {
+            fprintf(stderr, "Unable to initialize SDL_ttf: %s\n", TTF_GetError());
+            return 0;
+        }
+    #endif
 
     srand( (unsigned)time( NULL ) );
 
@@ -366,6 +577,11 @@ int main(int argc, char **argv)
         printf("Mode: line-based emulation\n");
     #endif
 
+    if (headless)
+    {
+        printf("Mode: headless\n");
+    }
+
 	fflush(stdout);
 
 	TheApp = new Frodo();
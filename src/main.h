@@ -33,6 +33,7 @@ class Frodo
 	    bool loadRomFiles();
         void handleEvent(SDL_Event* event);
         void doStep();
+        void reportBenchmark(uint32 frames, uint64 elapsed_ns);
 };
 
 class InputHandler
@@ -55,6 +56,16 @@ extern Frodo *TheApp;	// Pointer to Frodo object
 
 // Command line options.
 extern bool full_screen;
+extern bool headless;
+extern uint32 maxFrames;
+extern bool benchmark;
+extern char snapshotPath[256];
+extern char benchmarkSuite[256];
+extern char benchmarkReport[256];
+extern char profilePath[256];
+extern bool use_simd;
+extern bool rgba_output;
+extern bool threaded_vic;
 
 #if defined(DEBUG) || defined(_DEBUG)
 
@@ -198,11 +198,11 @@ void OSD::draw(float elapsedTime, resource_list_t* res)
 
     updateLayout(renderer->getWidth(), renderer->getHeight(), elapsedTime, res);
 
-    glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
+    renderer->setColor(0.0f, 0.0f, 0.0f, 1.0f);
 
     renderer->fillRectangle(windowRect.x, windowRect.y, windowRect.w, windowRect.h);
 
-    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    renderer->setColor(1.0f, 1.0f, 1.0f, 1.0f);
 
     renderer->drawTiledTexture(res->backgroundTexture,
                                windowRect.x, windowRect.y,
@@ -322,7 +322,7 @@ void OSD::drawFiles(float elapsedTime, resource_list_t* res)
             entryRect.w = fileListFrame.w-2;
             entryRect.h = itemHeight-2;
 
-            glColor4f(1.0f, 1.0f, 1.0f, 0.1f);
+            renderer->setColor(1.0f, 1.0f, 1.0f, 0.1f);
 
             renderer->drawTiledTexture(res->buttonTexture,
                                        fileListFrame.x,
@@ -330,7 +330,7 @@ void OSD::drawFiles(float elapsedTime, resource_list_t* res)
                                        fileListFrame.w,
                                        itemHeight);
 
-            glColor4f(1.0f, 1.0f, 1.0f, 0.8f);
+            renderer->setColor(1.0f, 1.0f, 1.0f, 0.8f);
 
             if (!fileInfo.isDirectory)
             {
@@ -345,7 +345,7 @@ void OSD::drawFiles(float elapsedTime, resource_list_t* res)
                                       fileListFrame.y+y+(itemHeight-res->iconFolder->getHeight())/2);
             }
 
-            glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+            renderer->setColor(1.0f, 1.0f, 1.0f, 1.0f);
 
             renderer->drawText(fileListFrame.x+28,
                                fileListFrame.y+y+itemHeight/2,
@@ -385,13 +385,13 @@ void OSD::drawToolbar(resource_list_t* res)
             break;
         }
 
-        glColor4f(1.0f, 1.0f, 1.0f, 0.5f);
+        renderer->setColor(1.0f, 1.0f, 1.0f, 0.5f);
 
         renderer->drawTiledTexture((cmd.state == STATE_NORMAL) ? res->buttonTexture : res->buttonPressedTexture,
                                    buttonRect.x, buttonRect.y,
                                    buttonRect.w, buttonRect.h);
 
-        glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+        renderer->setColor(1.0f, 1.0f, 1.0f, 1.0f);
 
         renderer->drawText(buttonRect.x + buttonRect.w/2 ,
                            buttonRect.y + buttonRect.h/2,
@@ -691,7 +691,7 @@ void OSD::onCommand(const OSD::command_t& command)
 {
     // printf("COMMAND: %s\n", command.text.c_str());
 
-    Prefs *prefs = new Prefs(ThePrefs);
+    Prefs *prefs = new Prefs(the_c64->ThePrefs);
 
     bool prefsChanged = false;
     bool commandDispatched = true;
@@ -776,7 +776,7 @@ void OSD::onCommand(const OSD::command_t& command)
     if (prefsChanged)
     {
         the_c64->NewPrefs(prefs);
-	    ThePrefs = *prefs;
+	    the_c64->ThePrefs = *prefs;
     }
 
     delete prefs;
@@ -808,7 +808,7 @@ void OSD::setNewFile(const fileinfo_t& fileInfo)
     }
     else
     {
-	    Prefs *prefs = new Prefs(ThePrefs);
+	    Prefs *prefs = new Prefs(the_c64->ThePrefs);
 
         strcpy(prefs->DrivePath[0], diskPath.c_str());
 
@@ -836,7 +836,7 @@ void OSD::setNewFile(const fileinfo_t& fileInfo)
         prefs->DriveType[0] = driveType;
 
 	    the_c64->NewPrefs(prefs);
-	    ThePrefs = *prefs;
+	    the_c64->ThePrefs = *prefs;
 	    delete prefs;
 
         the_c64->TheDisplay->setStatusMessage("Inserted disk: " + fileInfo.name);
@@ -849,19 +849,19 @@ void OSD::updateCommandState(command_t& command)
     switch (id)
     {
         case CMD_ENABLE_JOYSTICK1:
-            command.state = ThePrefs.JoystickSwap ? STATE_SET : STATE_NORMAL;
+            command.state = the_c64->ThePrefs.JoystickSwap ? STATE_SET : STATE_NORMAL;
             break;
         case CMD_ENABLE_JOYSTICK2:
-            command.state = ThePrefs.JoystickSwap ? STATE_NORMAL : STATE_SET;
+            command.state = the_c64->ThePrefs.JoystickSwap ? STATE_NORMAL : STATE_SET;
             break;
         case CMD_ENABLE_TRUEDRIVE:
-            command.state = ThePrefs.Emul1541Proc ? STATE_SET : STATE_NORMAL;
+            command.state = the_c64->ThePrefs.Emul1541Proc ? STATE_SET : STATE_NORMAL;
             break;
         case CMD_ENABLE_FILTERING:
             command.state = the_c64->TheDisplay->getAntialiasing() ? STATE_SET : STATE_NORMAL;
             break;
         case CMD_WARP:
-            command.state = ThePrefs.LimitSpeed ? STATE_NORMAL : STATE_SET;
+            command.state = the_c64->ThePrefs.LimitSpeed ? STATE_NORMAL : STATE_SET;
             break;
         case CMD_SHOW_ABOUT:
             command.state = the_c64->TheDisplay->isAboutActive() ? STATE_SET : STATE_NORMAL;
@@ -739,7 +739,7 @@ handle_int:
 #include "../CPU_emulline.h"
 
 		// Extension opcode
-		case 0xf2:
+		OPCODE(f2)
 #if PC_IS_POINTER
 			if ((pc-pc_base) < 0xc000) {
 				illegal_op(0xf2, pc-pc_base-1);
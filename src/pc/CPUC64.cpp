@@ -28,6 +28,12 @@
  *    decoding. The read_zp() and write_zp() functions allow
  *    faster access to the zero page, the pop_byte() and
  *    push_byte() macros for the stack.
+ *  - Below $a000 (reads) and $d000 (writes) there is only
+ *    RAM. Above, address decoding uses two tables with a
+ *    pointer per page, rebuilt by map_pages() when the memory
+ *    configuration changes. A NULL pointer sends the access
+ *    to read_byte_io()/write_byte_io() (I/O space and the REU
+ *    trigger at $ff00).
  *  - If a write occurs to addresses 0 or 1, new_config is
  *    called to check whether the memory configuration has
  *    changed
@@ -53,6 +59,17 @@
  *  - The $f2 opcode that would normally crash the 6510 is
  *    used to implement emulator-specific functions, mainly
  *    those for the IEC routines
+ *  - With BLOCK_CACHE, opcodes and operands are not fetched
+ *    with read_byte() but from blocks of pre-decoded
+ *    instructions. A block is a straight-line run within one
+ *    page that ends at the first jump, branch, CLI, PLP, RTI
+ *    or BRK. Blocks are looked up by start address and by
+ *    whether they were decoded from ROM or RAM. A bitmap marks
+ *    the RAM bytes that are part of a cached block; writing
+ *    one of them with write_byte() invalidates the blocks of
+ *    that page. Pages 0 and 1 (written with write_zp() and
+ *    push_byte()), I/O space, $f2 and the jam opcodes are
+ *    never cached but decoded one instruction at a time.
  *
  * Incompatibilities:
  * ------------------
@@ -98,6 +115,25 @@ MOS6510::MOS6510(C64 *c64, uint8 *Ram, uint8 *Basic, uint8 *Kernal, uint8 *Char,
 	i_flag = true;
 	dfff_byte = 0x55;
 	borrowed_cycles = 0;
+
+	// Pages that don't depend on the memory configuration
+	for (int page=0; page<0x100; page++)
+		read_page[page] = write_page[page] = ram + (page << 8);
+	write_page[0xff] = NULL;	// REU trigger at $ff00
+	basic_in = kernal_in = char_in = io_in = false;
+	map_pages();
+
+#if BLOCK_CACHE
+	memset(page_gen, 0, sizeof(page_gen));
+	memset(uop_restart, 0, sizeof(uop_restart));
+	uop_restart[0].len = 1;
+	memset(uop_single, 0, sizeof(uop_single));
+	cur_block = NULL;
+#if SKIP_IDLE_LOOPS
+	idle_block = NULL;
+#endif
+	FlushBlockCache();
+#endif
 }
 
 
@@ -129,11 +165,47 @@ void MOS6510::AsyncNMI(void)
 void MOS6510::new_config(void)
 {
 	uint8 port = ~ram[0] | ram[1];
+	bool bi = basic_in, ki = kernal_in, ci = char_in, ii = io_in;
 
 	basic_in = (port & 3) == 3;
 	kernal_in = port & 2;
 	char_in = (port & 3) && !(port & 4);
 	io_in = (port & 3) && (port & 4);
+
+	if (bi != basic_in || ki != kernal_in || ci != char_in || ii != io_in) {
+		map_pages();
+
+#if BLOCK_CACHE
+		// The rest of a block above $a000 may now be in different memory
+		if (cur_block && (cur_block->tag & 0xffff) >= 0xa000)
+			kill_block();
+#endif
+	}
+}
+
+
+/*
+ *  Set page table entries for $a000-$ffff from memory configuration
+ */
+
+void MOS6510::map_pages(void)
+{
+	int page;
+
+	for (page=0xa0; page<0xc0; page++)
+		read_page[page] = basic_in ? basic_rom + ((page - 0xa0) << 8) : ram + (page << 8);
+
+	for (page=0xd0; page<0xe0; page++) {
+		if (io_in)
+			read_page[page] = write_page[page] = NULL;
+		else {
+			read_page[page] = char_in ? char_rom + ((page - 0xd0) << 8) : ram + (page << 8);
+			write_page[page] = ram + (page << 8);
+		}
+	}
+
+	for (page=0xe0; page<0x100; page++)
+		read_page[page] = kernal_in ? kernal_rom + ((page - 0xe0) << 8) : ram + (page << 8);
 }
 
 
@@ -207,6 +279,10 @@ uint8 MOS6510::read_byte(uint16 adr)
 {
 	if (adr < 0xa000)
 		return ram[adr];
+
+	uint8 *p = read_page[adr >> 8];
+	if (p)
+		return p[adr & 0xff];
 	else
 		return read_byte_io(adr);
 }
@@ -244,43 +320,12 @@ uint8 MOS6510::read_emulator_id(uint16 adr)
 
 inline uint16 MOS6510::read_word(uint16 adr)
 {
-	switch (adr >> 12) {
-		case 0x0:
-		case 0x1:
-		case 0x2:
-		case 0x3:
-		case 0x4:
-		case 0x5:
-		case 0x6:
-		case 0x7:
-		case 0x8:
-		case 0x9:
-			return *(uint16*)&ram[adr];
-			break;
-		case 0xa:
-		case 0xb:
-			if (basic_in)
-				return *(uint16*)&basic_rom[adr & 0x1fff];
-			else
-				return *(uint16*)&ram[adr];
-		case 0xc:
-			return *(uint16*)&ram[adr];
-		case 0xd:
-			if (io_in)
-				return read_byte(adr) | (read_byte(adr+1) << 8);
-			else if (char_in)
-				return *(uint16*)&char_rom[adr & 0x0fff];
-			else
-				return *(uint16*)&ram[adr];
-		case 0xe:
-		case 0xf:
-			if (kernal_in)
-				return *(uint16*)&kernal_rom[adr & 0x1fff];
-			else
-				return *(uint16*)&ram[adr];
-		default:	// Can't happen
-			return 0;
-	}
+	uint8 *p = read_page[adr >> 8];
+
+	if (p && (adr & 0xff) != 0xff)
+		return *(uint16*)&p[adr & 0xff];
+	else
+		return read_byte(adr) | (read_byte(adr+1) << 8);
 }
 
 #else
@@ -301,6 +346,10 @@ void MOS6510::write_byte_io(uint16 adr, uint8 byte)
 {
 	if (adr >= 0xe000) {
 		ram[adr] = byte;
+#if BLOCK_CACHE
+		if (code_map[adr >> 3] & (1 << (adr & 7)))
+			invalidate_code(adr);
+#endif
 		if (adr == 0xff00)
 			TheREU->FF00Trigger();
 	} else if (io_in)
@@ -335,8 +384,13 @@ void MOS6510::write_byte_io(uint16 adr, uint8 byte)
 					TheREU->WriteRegister(adr & 0x0f, byte);
 				return;
 		}
-	else
-		ram[adr] = byte;	
+	else {
+		ram[adr] = byte;
+#if BLOCK_CACHE
+		if (code_map[adr >> 3] & (1 << (adr & 7)))
+			invalidate_code(adr);
+#endif
+	}
 }
 
 
@@ -348,10 +402,23 @@ inline void MOS6510::write_byte(uint16 adr, uint8 byte)
 {
 	if (adr < 0xd000) {
 		ram[adr] = byte;
-		if (adr < 2)
+		if (adr < 2) {
 			new_config();
-	} else
-		write_byte_io(adr, byte);
+			return;
+		}
+	} else {
+		uint8 *p = write_page[adr >> 8];
+		if (!p) {
+			write_byte_io(adr, byte);
+			return;
+		}
+		p[adr & 0xff] = byte;
+	}
+
+#if BLOCK_CACHE
+	if (code_map[adr >> 3] & (1 << (adr & 7)))
+		invalidate_code(adr);
+#endif
 }
 
 
@@ -408,12 +475,14 @@ uint8 MOS6510::ExtReadByte(uint16 adr)
 	kernal_in = ExtConfig & 2;
 	char_in = (ExtConfig & 3) && ~(ExtConfig & 4);
 	io_in = (ExtConfig & 3) && (ExtConfig & 4);
+	map_pages();
 
 	// Read byte
 	uint8 byte = read_byte(adr);
 
 	// Restore old configuration
 	basic_in = bi; kernal_in = ki; char_in = ci; io_in = ii;
+	map_pages();
 
 	return byte;
 }
@@ -433,12 +502,14 @@ void MOS6510::ExtWriteByte(uint16 adr, uint8 byte)
 	kernal_in = ExtConfig & 2;
 	char_in = (ExtConfig & 3) && ~(ExtConfig & 4);
 	io_in = (ExtConfig & 3) && (ExtConfig & 4);
+	map_pages();
 
 	// Write byte
 	write_byte(adr, byte);
 
 	// Restore old configuration
 	basic_in = bi; kernal_in = ki; char_in = ci; io_in = ii;
+	map_pages();
 }
 
 
@@ -519,6 +590,350 @@ inline void MOS6510::jump(uint16 adr)
 #endif
 
 
+#if BLOCK_CACHE
+
+/*
+ *  Instruction lengths, E: ends a block, N: never cached
+ */
+
+enum {
+	E = 0x40,
+	N = 0x80,
+	BLOCK_ROM = 0x10000		// Tag bit for blocks decoded from ROM
+};
+
+static const uint8 uop_length[256] = {
+	1|E, 2, 1|N, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+	2|E, 2, 1|N, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+	3|E, 2, 1|N, 2, 2, 2, 2, 2, 1|E, 2, 1, 2, 3, 3, 3, 3,
+	2|E, 2, 1|N, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+	1|E, 2, 1|N, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3|E, 3, 3, 3,
+	2|E, 2, 1|N, 2, 2, 2, 2, 2, 1|E, 3, 1, 3, 3, 3, 3, 3,
+	1|E, 2, 1|N, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3|E, 3, 3, 3,
+	2|E, 2, 1|N, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+	2|E, 2, 1|N, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+	2|E, 2, 1|N, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+	2|E, 2, 1|N, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+	2|E, 2, 2|N, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3
+};
+
+
+/*
+ *  Invalidate all cached blocks
+ */
+
+void MOS6510::FlushBlockCache(void)
+{
+	kill_block();
+	for (int i=0; i<BLOCK_CACHE_SIZE; i++)
+		blocks[i].tag = 0xffffffff;
+	memset(code_map, 0, sizeof(code_map));
+	cur_uop = uop_restart;
+}
+
+
+/*
+ *  Stop executing the current block after the running instruction
+ */
+
+void MOS6510::kill_block(void)
+{
+	if (cur_block) {
+		for (int i=0; i<BLOCK_UOPS; i++)
+			cur_block->uop[i].len = 0;
+		cur_block->tag = 0xffffffff;
+		cur_block = NULL;
+	}
+}
+
+
+/*
+ *  Cached code in RAM was overwritten, invalidate all blocks of its page
+ */
+
+void MOS6510::invalidate_code(uint16 adr)
+{
+	uint8 page = adr >> 8;
+
+	page_gen[page]++;
+	memset(code_map + (page << 5), 0, 32);
+	if (cur_block && !(cur_block->tag & BLOCK_ROM) && (cur_block->tag >> 8) == page)
+		kill_block();
+}
+
+
+/*
+ *  Decode operand of instruction at adr
+ */
+
+inline void MOS6510::decode_uop(uop_t *u, uint16 adr, uint8 op, int len)
+{
+	u->op = op;
+	u->len = len;
+	if (len == 3)
+		u->operand = read_byte(adr+1) | (read_byte(adr+2) << 8);
+	else if (len == 2)
+		u->operand = read_byte(adr+1);
+	else
+		u->operand = 0;
+}
+
+
+/*
+ *  Find the block starting at adr, decode it if not cached
+ *  Returns the first instruction
+ */
+
+const MOS6510::uop_t *MOS6510::find_block(uint16 adr)
+{
+	uint32 tag = adr;
+	bool cacheable = adr >= 0x0200;
+
+	switch (adr >> 12) {
+		case 0xa:
+		case 0xb:
+			if (basic_in)
+				tag |= BLOCK_ROM;
+			break;
+		case 0xd:
+			if (io_in)
+				cacheable = false;
+			else if (char_in)
+				tag |= BLOCK_ROM;
+			break;
+		case 0xe:
+		case 0xf:
+			if (kernal_in)
+				tag |= BLOCK_ROM;
+			break;
+	}
+
+	block_t *b = &blocks[(adr ^ (adr >> 9)) & (BLOCK_CACHE_SIZE - 1)];
+	if (b->tag == tag && ((tag & BLOCK_ROM) || b->gen == page_gen[adr >> 8])) {
+#if SKIP_IDLE_LOOPS
+		if (!b->idle)
+			idle_block = NULL;
+		else if (idle_block != b) {
+			idle_block = b;
+			idle_cycles = -1;
+		}
+#endif
+		cur_block = b;
+		return b->uop;
+	}
+
+	// Decode up to the first instruction that ends the block
+	uint8 op = read_byte(adr);
+	int n = 0;
+	uint16 end = adr;
+	if (cacheable) {
+		for (;;) {
+			int len = uop_length[op];
+			if ((len & N) || (end & 0xff) + (len & 3) > 0x100)
+				break;
+			decode_uop(&b->uop[n++], end, op, len & 3);
+			end += len & 3;
+			if ((len & E) || !(end & 0xff) || n == BLOCK_UOPS)
+				break;
+			op = read_byte(end);
+		}
+	}
+
+#if SKIP_IDLE_LOOPS
+	idle_block = NULL;
+#endif
+
+	// Not cacheable, execute a single instruction
+	if (n == 0) {
+		decode_uop(&uop_single[0], adr, op, uop_length[op] & 3);
+		cur_block = NULL;
+		return uop_single;
+	}
+
+	b->uop[n].len = 0;
+	b->tag = tag;
+	if (!(tag & BLOCK_ROM)) {
+		b->gen = page_gen[adr >> 8];
+		for (uint16 i=adr; i!=end; i++)
+			code_map[i >> 3] |= 1 << (i & 7);
+	}
+#if SKIP_IDLE_LOOPS
+	if ((b->idle = idle_loop(b->uop, n, adr, end))) {
+		idle_block = b;
+		idle_cycles = -1;
+	}
+#endif
+	cur_block = b;
+	return b->uop;
+}
+
+#if SKIP_IDLE_LOOPS
+
+/*
+ *  Check whether a block is a loop that repeats the same thing until
+ *  an interrupt or the next raster line: it must end with a branch or
+ *  jump to its start and consist only of loads, stores, compares and
+ *  register transfers on fixed addresses. Every register, flag or
+ *  memory location it reads must either not be changed inside the loop
+ *  or be set in the loop before it is read. Then all iterations after
+ *  the first one leave the machine in the same state. Only $d011 and
+ *  $d012 may be read in I/O space (they don't change during a line),
+ *  stores to I/O space, the processor port, $ff00 and the loop itself
+ *  are not allowed.
+ */
+
+enum {
+	IR_A = 1,
+	IR_X = 2,
+	IR_Y = 4,
+	IR_NZ = 8,
+	IR_C = 16,
+	IR_V = 32
+};
+
+bool MOS6510::idle_loop(const uop_t *u, int n, uint16 start, uint16 end)
+{
+	// Loop back to the start?
+	const uop_t *last = &u[n-1];
+	uint8 branch_reads;
+	switch (last->op) {
+		case 0x4c:	// JMP abs
+			if (last->operand != start)
+				return false;
+			branch_reads = 0;
+			break;
+		case 0x10: case 0x30:	// BPL/BMI
+		case 0xd0: case 0xf0:	// BNE/BEQ
+			branch_reads = IR_NZ;
+			goto rel;
+		case 0x50: case 0x70:	// BVC/BVS
+			branch_reads = IR_V;
+			goto rel;
+		case 0x90: case 0xb0:	// BCC/BCS
+			branch_reads = IR_C;
+rel:		if ((uint16)(end + (int8)last->operand) != start)
+				return false;
+			break;
+		default:
+			return false;
+	}
+
+	uint8 reads[BLOCK_UOPS], writes[BLOCK_UOPS];
+	uint8 all_writes = 0;
+	int i, j;
+
+	// Registers and flags used by each instruction, check addresses
+	for (i=0; i<n-1; i++) {
+		uint16 adr = u[i].operand;
+		int mem = 0;	// 1: reads memory, 2: writes memory
+		switch (u[i].op) {
+			case 0xa9: reads[i] = 0; writes[i] = IR_A | IR_NZ; break;			// LDA #imm
+			case 0xa5: case 0xad: reads[i] = 0; writes[i] = IR_A | IR_NZ; mem = 1; break;	// LDA zero/abs
+			case 0xa2: reads[i] = 0; writes[i] = IR_X | IR_NZ; break;			// LDX #imm
+			case 0xa6: case 0xae: reads[i] = 0; writes[i] = IR_X | IR_NZ; mem = 1; break;	// LDX zero/abs
+			case 0xa0: reads[i] = 0; writes[i] = IR_Y | IR_NZ; break;			// LDY #imm
+			case 0xa4: case 0xac: reads[i] = 0; writes[i] = IR_Y | IR_NZ; mem = 1; break;	// LDY zero/abs
+			case 0x85: case 0x8d: reads[i] = IR_A; writes[i] = 0; mem = 2; break;	// STA zero/abs
+			case 0x86: case 0x8e: reads[i] = IR_X; writes[i] = 0; mem = 2; break;	// STX zero/abs
+			case 0x84: case 0x8c: reads[i] = IR_Y; writes[i] = 0; mem = 2; break;	// STY zero/abs
+			case 0xc9: reads[i] = IR_A; writes[i] = IR_NZ | IR_C; break;			// CMP #imm
+			case 0xc5: case 0xcd: reads[i] = IR_A; writes[i] = IR_NZ | IR_C; mem = 1; break;	// CMP zero/abs
+			case 0xe0: reads[i] = IR_X; writes[i] = IR_NZ | IR_C; break;			// CPX #imm
+			case 0xe4: case 0xec: reads[i] = IR_X; writes[i] = IR_NZ | IR_C; mem = 1; break;	// CPX zero/abs
+			case 0xc0: reads[i] = IR_Y; writes[i] = IR_NZ | IR_C; break;			// CPY #imm
+			case 0xc4: case 0xcc: reads[i] = IR_Y; writes[i] = IR_NZ | IR_C; mem = 1; break;	// CPY zero/abs
+			case 0x24: case 0x2c: reads[i] = IR_A; writes[i] = IR_NZ | IR_V; mem = 1; break;	// BIT zero/abs
+			case 0x29: case 0x09: case 0x49: reads[i] = IR_A; writes[i] = IR_A | IR_NZ; break;	// AND/ORA/EOR #imm
+			case 0xaa: reads[i] = IR_A; writes[i] = IR_X | IR_NZ; break;			// TAX
+			case 0xa8: reads[i] = IR_A; writes[i] = IR_Y | IR_NZ; break;			// TAY
+			case 0x8a: reads[i] = IR_X; writes[i] = IR_A | IR_NZ; break;			// TXA
+			case 0x98: reads[i] = IR_Y; writes[i] = IR_A | IR_NZ; break;			// TYA
+			case 0xea: reads[i] = 0; writes[i] = 0; break;						// NOP
+			default:
+				return false;
+		}
+		if (mem == 1 && adr >= 0xd000 && adr < 0xe000 && adr != 0xd011 && adr != 0xd012)
+			return false;
+		if (mem == 2 && (adr < 2 || (adr >= 0xd000 && adr < 0xe000) || adr == 0xff00 || (adr >= start && adr < end)))
+			return false;
+		if (mem == 2)
+			writes[i] |= 0x80;	// Marks a store, checked below
+		else if (mem == 1)
+			reads[i] |= 0x80;
+		all_writes |= writes[i];
+	}
+
+	// Nothing read before it is set in the loop
+	uint8 defined = 0;
+	for (i=0; i<n-1; i++) {
+		if (reads[i] & all_writes & ~defined & 0x7f)
+			return false;
+		if (reads[i] & 0x80) {
+			// Memory: stored later in the loop but not before?
+			bool stored_before = false, stored_after = false;
+			for (j=0; j<n-1; j++)
+				if ((writes[j] & 0x80) && u[j].operand == u[i].operand) {
+					if (j < i)
+						stored_before = true;
+					else
+						stored_after = true;
+				}
+			if (stored_after && !stored_before)
+				return false;
+		}
+		defined |= writes[i];
+	}
+	return !(branch_reads & all_writes & ~defined);
+}
+
+
+/*
+ *  Called when the block lookup entered an idle loop: after the first
+ *  complete iteration in this EmulateLine() call, skip as many further
+ *  iterations as fit into the remaining cycles without a CIA timer
+ *  underflow. Returns the number of cycles skipped.
+ */
+
+int MOS6510::skip_idle(int cycles_left)
+{
+	if (idle_cycles < 0) {
+		idle_cycles = cycles_left;
+		return 0;
+	}
+
+	int iteration = idle_cycles - cycles_left;
+	int skip = cycles_left;
+#if PRECISE_CIA_CYCLES
+	int cia = TheCIA1->CyclesToUnderflow();
+	if (cia < skip)
+		skip = cia;
+	cia = TheCIA2->CyclesToUnderflow();
+	if (cia < skip)
+		skip = cia;
+#endif
+	if (iteration <= 0 || skip < iteration) {
+		idle_cycles = cycles_left;
+		return 0;
+	}
+
+	skip -= skip % iteration;
+#if PRECISE_CIA_CYCLES
+	TheCIA1->EmulateLine(skip);
+	TheCIA2->EmulateLine(skip);
+#endif
+	idle_cycles = cycles_left - skip;
+	return skip;
+}
+
+#endif
+
+#endif
+
+
 /*
  *  Adc instruction
  */
@@ -649,6 +1064,10 @@ void MOS6510::SetState(MOS6510State *s)
 	ram[1] = s->pr;
 	new_config();
 
+#if BLOCK_CACHE
+	FlushBlockCache();
+#endif
+
 	jump(s->pc);
 	sp = s->sp & 0xff;
 
@@ -676,6 +1095,10 @@ void MOS6510::Reset(void)
 	ram[0] = ram[1] = 0;
 	new_config();
 
+#if BLOCK_CACHE
+	FlushBlockCache();
+#endif
+
 	// Clear all interrupt lines
 	interrupt.intr_any = 0;
 	nmi_state = false;
@@ -756,12 +1179,22 @@ int MOS6510::EmulateLine(int cycles_left)
 	uint8 tmp, tmp2;
 	uint16 adr;		// Used by read_adr_abs()!
 	int last_cycles = 0;
+#if BLOCK_CACHE
+	const uop_t *uop = cur_uop;	// Used by read_opcode()!
+#endif
+#if SKIP_IDLE_LOOPS
+	idle_block = NULL;
+#endif
 
 	// Any pending interrupts?
 	if (interrupt.intr_any) {
 handle_int:
-		if (interrupt.intr[INT_RESET])
+		if (interrupt.intr[INT_RESET]) {
 			Reset();
+#if BLOCK_CACHE
+			uop = uop_restart;
+#endif
+		}
 
 		else if (interrupt.intr[INT_NMI]) {
 			interrupt.intr[INT_NMI] = false;	// Simulate an edge-triggered input
@@ -774,6 +1207,9 @@ handle_int:
 			i_flag = true;
 			jump(read_word(0xfffa));
 			last_cycles = 7;
+#if BLOCK_CACHE
+			uop = uop_restart;
+#endif
 
 		} else if ((interrupt.intr[INT_VICIRQ] || interrupt.intr[INT_CIAIRQ]) && !i_flag) {
 #if PC_IS_POINTER
@@ -785,13 +1221,16 @@ handle_int:
 			i_flag = true;
 			jump(read_word(0xfffe));
 			last_cycles = 7;
+#if BLOCK_CACHE
+			uop = uop_restart;
+#endif
 		}
 	}
 
 #include "../CPU_emulline.h"
 
 		// Extension opcode
-		case 0xf2:
+		OPCODE(f2)
 #if PC_IS_POINTER
 			if ((pc-pc_base) < 0xe000) {
 				illegal_op(0xf2, pc-pc_base-1);
@@ -850,6 +1289,9 @@ handle_int:
 			break;
 		}
 	}
+#if BLOCK_CACHE
+	cur_uop = uop;
+#endif
 	return last_cycles;
 }
 
@@ -12,7 +12,19 @@
  *    raster line. It computes one pixel row of the graphics
  *    according to the current VIC register settings and returns
  *    the number of cycles available for the CPU in that line.
- *  - The graphics are output into an 8 bit chunky bitmap
+ *  - The graphics are output into an 8 bit chunky bitmap. With
+ *    -rgba, every line is drawn into rgba_line_buf[] and then
+ *    converted to a 32 bit RGBA bitmap, so the display can upload
+ *    it to the texture without converting it again
+ *  - With -victhread, lines without sprites are only latched
+ *    by EmulateLine() (registers, video matrix and graphics
+ *    data) into a ring of line records, and drawn by a render
+ *    worker thread. Lines with sprites are drawn right away,
+ *    because the collisions are needed at once. vblank() waits
+ *    for the worker before the frame is handed on.
+ *  - On CPUs with SSE2 or NEON, the text and bitmap modes are
+ *    expanded 16 pixels at a time by the simd_*() functions
+ *    (unless disabled with -nosimd)
  *  - The sprite-graphics priority handling and collision
  *    detection is done in a bit-oriented way with masks.
  *    The foreground/background pixel mask for the graphics
@@ -21,9 +33,10 @@
  *    to a bitplane representation (two bit masks) for easier
  *    handling of priorities and collisions.
  *  - The sprite-sprite priority handling and collision
- *    detection is done in with the byte array spr_coll_buf[],
- *    that is used to keep track of which sprites are already
- *    visible at certain X positions.
+ *    detection is done with line-wide bit masks, that are used
+ *    to keep track of which X positions are covered by one or
+ *    more sprites. The sprites are then painted from back to
+ *    front, 8 pixels at a time.
  *
  * Incompatibilities:
  * ------------------
@@ -52,6 +65,28 @@
 #include "../Input.h"
 #include "../Prefs.h"
 
+// SIMD line renderers, used if the CPU supports them
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#include <emmintrin.h>
+#define SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_NEON
+#if defined(__linux__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
+#endif
+
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+#define SIMD_LINES
+#endif
+
+#if defined(SIMD_SSE2) && defined(__i386__) && !defined(__SSE2__)
+#define SIMD_TARGET __attribute__((target("sse2")))
+#else
+#define SIMD_TARGET
+#endif
+
 // First and last displayed line
 const unsigned FIRST_DISP_LINE = 0x10;
 const unsigned LAST_DISP_LINE = 0x11f;
@@ -167,6 +202,231 @@ static union {
 } TextColorTable[16][16][256][2];
 #endif
 
+const int LINE_RING_SIZE = 512;		// Line records for the render worker, power of 2 and more than a frame
+
+/*
+ *  Sprite compositing through bit masks: the sprite pixels of a line
+ *  are collected in a line-wide mask, pixels that are already set go
+ *  into a second mask for the sprite-sprite collisions. Sprites are
+ *  painted 8 pixels at a time with byte masks.
+ */
+
+const int LINE_MASK_WORDS = DISPLAY_X/64 + 1;	// Room for a sprite shifted over the last word
+
+static uint64 hires_mask[256];		// 0xff for every set bit
+
+static void init_hires_mask(void)
+{
+	for (int i=0; i<256; i++) {
+		uint8 *hm = (uint8 *)&hires_mask[i];
+		for (int j=0; j<8; j++)
+			hm[j] = (i & (0x80 >> j)) ? 0xff : 0;
+	}
+}
+
+// Add sprite pixels (leftmost pixel in bit 63) at chunky position pos
+static inline void line_mask_add(uint64 *any, uint64 *multi, int pos, uint64 bits)
+{
+	int w = pos >> 6, sh = pos & 63;
+	uint64 b0 = bits >> sh;
+	uint64 b1 = sh ? bits << (64 - sh) : 0;
+	multi[w] |= any[w] & b0;
+	any[w] |= b0;
+	multi[w+1] |= any[w+1] & b1;
+	any[w+1] |= b1;
+}
+
+// Get 64 pixels from chunky position pos
+static inline uint64 line_mask_get(const uint64 *line, int pos)
+{
+	int w = pos >> 6, sh = pos & 63;
+	return sh ? (line[w] << sh | line[w+1] >> (64 - sh)) : line[w];
+}
+
+// Paint the set pixels in one color
+static inline void paint_sprite_pixels(uint8 *p, uint64 bits, uint8 color)
+{
+	uint64 c = color * 0x0101010101010101ULL;
+	for (; bits; bits <<= 8, p += 8) {
+		uint64 m = hires_mask[bits >> 56];
+		if (m) {
+			uint64 v;
+			memcpy(&v, p, 8);
+			v ^= (v ^ c) & m;
+			memcpy(p, &v, 8);
+		}
+	}
+}
+
+#ifdef SIMD_LINES
+/*
+ *  SIMD line renderers: 16 pixels (two characters) per step. The
+ *  pixels of a character are built from 8 byte masks that select
+ *  between 8 byte wide colors, so the tables stay small enough for
+ *  the L1 cache.
+ */
+
+static uint64 multi_mask[256][4];	// 0xff for every bit pair with the value of the index
+static uint64 hires_multi_mask[256][4];	// hires_mask[] as bit pair value 3, for multicolor text
+
+static void init_simd_tables(void)
+{
+	for (int i=0; i<256; i++) {
+		for (int k=0; k<4; k++) {
+			uint8 *mm = (uint8 *)&multi_mask[i][k];
+			for (int j=0; j<8; j++)
+				mm[j] = ((i >> (6 - (j & 6))) & 3) == k ? 0xff : 0;
+			hires_multi_mask[i][k] = k == 3 ? hires_mask[i] : 0;
+		}
+	}
+}
+
+#if defined(SIMD_SSE2)
+typedef __m128i pixels16;
+
+SIMD_TARGET static inline pixels16 load_pair(const uint64 *left, const uint64 *right)
+{
+	return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)left), _mm_loadl_epi64((const __m128i *)right));
+}
+
+SIMD_TARGET static inline pixels16 fill_pixels(uint8 color)
+{
+	return _mm_set1_epi8(color);
+}
+
+// mask ? a : b
+SIMD_TARGET static inline pixels16 select_pixels(pixels16 mask, pixels16 a, pixels16 b)
+{
+	return _mm_xor_si128(b, _mm_and_si128(mask, _mm_xor_si128(a, b)));
+}
+
+SIMD_TARGET static inline void store_pixels(uint8 *p, pixels16 v)
+{
+	_mm_storeu_si128((__m128i *)p, v);
+}
+#else
+typedef uint8x16_t pixels16;
+
+static inline pixels16 load_pair(const uint64 *left, const uint64 *right)
+{
+	return vcombine_u8(vld1_u8((const uint8 *)left), vld1_u8((const uint8 *)right));
+}
+
+static inline pixels16 fill_pixels(uint8 color)
+{
+	return vdupq_n_u8(color);
+}
+
+// mask ? a : b
+static inline pixels16 select_pixels(pixels16 mask, pixels16 a, pixels16 b)
+{
+	return vbslq_u8(mask, a, b);
+}
+
+static inline void store_pixels(uint8 *p, pixels16 v)
+{
+	vst1q_u8(p, v);
+}
+#endif
+
+// Pixels of a character pair in multicolor mode, m points to 4 masks per character
+SIMD_TARGET static inline pixels16 multi_pair(const uint64 *m0, const uint64 *m1, pixels16 c0, pixels16 c1, pixels16 c2, pixels16 c3)
+{
+	pixels16 v = select_pixels(load_pair(&m0[1], &m1[1]), c1, c0);
+	v = select_pixels(load_pair(&m0[2], &m1[2]), c2, v);
+	return select_pixels(load_pair(&m0[3], &m1[3]), c3, v);
+}
+
+SIMD_TARGET static void simd_std_text(uint8 *p, const uint8 *gp, uint8 *r, const uint8 *cp, const uint64 *cw, uint8 b0c_color)
+{
+	pixels16 bg = fill_pixels(b0c_color);
+
+	for (int i=0; i<40; i+=2, p+=16) {
+		uint8 d0 = r[i] = gp[i];
+		uint8 d1 = r[i+1] = gp[i+1];
+		pixels16 fg = load_pair(&cw[cp[i]], &cw[cp[i+1]]);
+		store_pixels(p, select_pixels(load_pair(&hires_mask[d0], &hires_mask[d1]), fg, bg));
+	}
+}
+
+SIMD_TARGET static void simd_mc_text(uint8 *p, const uint8 *gp, uint8 *r, const uint8 *cp, const uint64 *cw, uint8 b0c_color, uint8 b1c_color, uint8 b2c_color)
+{
+	pixels16 c0 = fill_pixels(b0c_color);
+	pixels16 c1 = fill_pixels(b1c_color);
+	pixels16 c2 = fill_pixels(b2c_color);
+	const uint64 *m[2], *c3[2];
+
+	for (int i=0; i<40; i+=2, p+=16) {
+		for (int j=0; j<2; j++) {
+			uint8 color = cp[i+j];
+			uint8 data = gp[i+j];
+			if (color & 8) {
+				r[i+j] = (data & 0xaa) | (data & 0xaa) >> 1;
+				m[j] = multi_mask[data];
+				c3[j] = &cw[color & 7];
+			} else {	// Standard mode in multicolor mode
+				r[i+j] = data;
+				m[j] = hires_multi_mask[data];
+				c3[j] = &cw[color];
+			}
+		}
+		store_pixels(p, multi_pair(m[0], m[1], c0, c1, c2, load_pair(c3[0], c3[1])));
+	}
+}
+
+SIMD_TARGET static void simd_std_bitmap(uint8 *p, const uint8 *gp, uint8 *r, const uint8 *mp, const uint64 *cw)
+{
+	for (int i=0; i<40; i+=2, p+=16) {
+		uint8 d0 = r[i] = gp[i];
+		uint8 d1 = r[i+1] = gp[i+1];
+		pixels16 fg = load_pair(&cw[mp[i] >> 4], &cw[mp[i+1] >> 4]);
+		pixels16 bg = load_pair(&cw[mp[i] & 15], &cw[mp[i+1] & 15]);
+		store_pixels(p, select_pixels(load_pair(&hires_mask[d0], &hires_mask[d1]), fg, bg));
+	}
+}
+
+SIMD_TARGET static void simd_mc_bitmap(uint8 *p, const uint8 *gp, uint8 *r, const uint8 *mp, const uint8 *cp, const uint64 *cw, uint8 b0c_color)
+{
+	pixels16 c0 = fill_pixels(b0c_color);
+
+	for (int i=0; i<40; i+=2, p+=16) {
+		uint8 d0 = gp[i], d1 = gp[i+1];
+		r[i] = (d0 & 0xaa) | (d0 & 0xaa) >> 1;
+		r[i+1] = (d1 & 0xaa) | (d1 & 0xaa) >> 1;
+		pixels16 c1 = load_pair(&cw[mp[i] >> 4], &cw[mp[i+1] >> 4]);
+		pixels16 c2 = load_pair(&cw[mp[i]], &cw[mp[i+1]]);
+		pixels16 c3 = load_pair(&cw[cp[i]], &cw[cp[i+1]]);
+		store_pixels(p, multi_pair(multi_mask[d0], multi_mask[d1], c0, c1, c2, c3));
+	}
+}
+
+SIMD_TARGET static void simd_ecm_text(uint8 *p, const uint8 *gp, uint8 *r, const uint8 *mp, const uint8 *cp, const uint64 *cw, const uint8 *bcp)
+{
+	for (int i=0; i<40; i+=2, p+=16) {
+		uint8 c0 = r[i] = mp[i];
+		uint8 c1 = r[i+1] = mp[i+1];
+		uint8 d0 = gp[i];
+		uint8 d1 = gp[i+1];
+		pixels16 fg = load_pair(&cw[cp[i]], &cw[cp[i+1]]);
+		pixels16 bg = load_pair(&cw[bcp[(c0 >> 6) & 3]], &cw[bcp[(c1 >> 6) & 3]]);
+		store_pixels(p, select_pixels(load_pair(&hires_mask[d0], &hires_mask[d1]), fg, bg));
+	}
+}
+
+// Can the SIMD line renderers be used on this CPU?
+static bool simd_supported(void)
+{
+#if defined(SIMD_SSE2) && defined(__i386__) && !defined(__SSE2__)
+	return __builtin_cpu_supports("sse2");
+#elif defined(SIMD_NEON) && defined(__linux__) && !defined(__aarch64__)
+	return (getauxval(AT_HWCAP) & (1 << 12)) != 0;	// HWCAP_NEON
+#else
+	return true;
+#endif
+}
+#endif
+
+
 /*
  *  Constructor: Initialize variables
  */
@@ -198,6 +458,18 @@ static void init_text_color_table(uint8 *colors)
 			}
 }
 
+// The color indices from InitColors() are the same for every display,
+// so the tables are shared by all instances and built only once
+static bool init_shared_tables(uint8 *colors)
+{
+	init_text_color_table(colors);
+	init_hires_mask();
+#ifdef SIMD_LINES
+	init_simd_tables();
+#endif
+	return true;
+}
+
 MOS6569::MOS6569(C64 *c64, C64Display *disp, MOS6510 *CPU, uint8 *RAM, uint8 *Char, uint8 *Color)
 	: ram(RAM), char_rom(Char), color_ram(Color), the_c64(c64), the_display(disp), the_cpu(CPU)
 {
@@ -210,6 +482,7 @@ MOS6569::MOS6569(C64 *c64, C64Display *disp, MOS6510 *CPU, uint8 *RAM, uint8 *Ch
 
 	// Get bitmap info
 	chunky_line_start = disp->BitmapBase();
+	dirty_rows = disp->BitmapDirtyRows();
 	xmod = disp->BitmapXMod();
 
 	// Initialize VIC registers
@@ -245,12 +518,70 @@ MOS6569::MOS6569(C64 *c64, C64Display *disp, MOS6510 *CPU, uint8 *RAM, uint8 *Ch
 	// Clear foreground mask
 	memset(fore_mask_buf, 0, DISPLAY_X/8);
 
+	// Nothing drawn yet
+	last_lines = new uint8[DISPLAY_X*DISPLAY_Y];
+	memset(last_lines, 0, DISPLAY_X*DISPLAY_Y);
+
 	// Preset colors to black
 	disp->InitColors(colors);
-	init_text_color_table(colors);
+
+	// Function-local static: initialized exactly once, even with
+	// several instances starting up on different threads
+	static bool tables_ready = init_shared_tables(colors);
+	(void)tables_ready;
+
+	for (i=0; i<256; i++)
+		colors_wide[i] = colors[i] * 0x0101010101010101ULL;
+	uint32 rgba_colors[256];
+	disp->InitRGBAColors(rgba_colors);
+	for (i=0; i<256; i++) {
+		uint32 *pair = (uint32 *)&rgba_pairs[i];
+		pair[0] = rgba_colors[i >> 4];
+		pair[1] = rgba_colors[i & 0x0f];
+	}
+	rgba_lines = disp->BitmapBitsPerPixel() == 32;
+#ifdef SIMD_LINES
+	simd_lines = use_simd && simd_supported();
+#else
+	simd_lines = false;
+#endif
 	ec_color = b0c_color = b1c_color = b2c_color = b3c_color = mm0_color = mm1_color = colors[0];
 	ec_color_long = (ec_color << 24) | (ec_color << 16) | (ec_color << 8) | ec_color;
 	for (i=0; i<8; i++) spr_color[i] = colors[0];
+
+	// Start render worker
+	line_ring = NULL;
+	line_head = line_tail = line_quit = 0;
+	line_thread = NULL;
+	line_wake = NULL;
+	if (threaded_vic) {
+		line_ring = new line_record_t[LINE_RING_SIZE];
+		line_wake = SDL_CreateSemaphore(0);
+		line_thread = SDL_CreateThread(line_worker_entry, this);
+		if (line_thread == NULL) {
+			fprintf(stderr, "Can't start VIC render worker: %s\n", SDL_GetError());
+			SDL_DestroySemaphore(line_wake);
+			delete[] line_ring;
+			line_ring = NULL;
+		}
+	}
+}
+
+
+/*
+ *  Destructor: stop render worker, free buffers
+ */
+
+MOS6569::~MOS6569()
+{
+	if (line_ring != NULL) {
+		atomic_store32(&line_quit, 1);
+		SDL_SemPost(line_wake);
+		SDL_WaitThread(line_thread, NULL);
+		SDL_DestroySemaphore(line_wake);
+		delete[] line_ring;
+	}
+	delete[] last_lines;
 }
 
 
@@ -273,7 +604,6 @@ void MOS6569::ReInitColors(void)
 
 	// Get the new colors.
 	the_display->InitColors(colors);
-	init_text_color_table(colors);
 
 	// Build color translation table.
 	for (i = 0; i < 256; i++)
@@ -311,14 +641,6 @@ void MOS6569::ReInitColors(void)
 }
 */
 
-void MOS6569::make_mc_table(void)
-{
-	mc_color_lookup[0] = b0c_color | (b0c_color << 8);
-	mc_color_lookup[1] = b1c_color | (b1c_color << 8);
-	mc_color_lookup[2] = b2c_color | (b2c_color << 8);
-}
-
-
 /*
  *  Convert video address to pointer
  */
@@ -462,7 +784,6 @@ void MOS6569::SetState(MOS6569State *vd)
 	b1c_color = colors[b1c];
 	b2c_color = colors[b2c];
 	b3c_color = colors[b3c];
-	make_mc_table();
 
 	mm0 = vd->mm0; mm1 = vd->mm1;
 	mm0_color = colors[mm0];
@@ -705,26 +1026,11 @@ void MOS6569::WriteRegister(uint16 adr, uint8 byte)
 			ec_color_long = (ec_color << 24) | (ec_color << 16) | (ec_color << 8) | ec_color;
 			break;
 
-		case 0x21:
-			if (b0c != byte) {
-				b0c_color = colors[b0c = byte & 0xF];
-				make_mc_table();
-			}
-			break;
+		case 0x21: b0c_color = colors[b0c = byte & 0xF]; break;
 
-		case 0x22: 
-			if (b1c != byte) {
-				b1c_color = colors[b1c = byte & 0xF];
-				make_mc_table();
-			}
-			break;
+		case 0x22: b1c_color = colors[b1c = byte & 0xF]; break;
 
-		case 0x23: 
-			if (b2c != byte) {
-				b2c_color = colors[b2c = byte & 0xF];
-				make_mc_table();
-			}
-			break;
+		case 0x23: b2c_color = colors[b2c = byte & 0xF]; break;
 
 		case 0x24: b3c_color = colors[b3c = byte & 0xF]; break;
 		case 0x25: mm0_color = colors[mm0 = byte]; break;
@@ -779,35 +1085,49 @@ inline void MOS6569::vblank(void)
 	raster_y = vc_base = 0;
 	lp_triggered = false;
 
+	// All lines must be in the bitmap before it is handed on
+	wait_line_worker();
+
+	// The time of the frame just finished goes into the cost average
+	// of its kind, and only a drawn frame is shown
+	bool drawn = !frame_skipped;
 	if (!(frame_skipped = --skip_counter))
     {
-		skip_counter = ThePrefs.SkipFrames;
+		skip_counter = the_c64->getSkipFrames();
     }
 
-	the_c64->VBlank(!frame_skipped);
+	the_c64->VBlank(drawn);
 
 	// Get bitmap pointer for next frame. This must be done
 	// after calling the_c64->VBlank() because the preferences
 	// and screen configuration may have been changed there
 	chunky_line_start = the_display->BitmapBase();
+	dirty_rows = the_display->BitmapDirtyRows();
 	xmod = the_display->BitmapXMod();
 }
 
-inline void MOS6569::el_std_text(uint8 *p, uint8 *q, uint8 *r)
+inline void MOS6569::el_std_text(uint8 *p, uint8 *r, const line_record_t *l) const
 {
-	unsigned int b0cc = b0c;
+#ifdef SIMD_LINES
+	if (simd_lines) {
+		simd_std_text(p, l->gfx, r, l->color, colors_wide, l->bc_color[0]);
+		return;
+	}
+#endif
+
+	unsigned int b0cc = l->bc[0];
     #ifdef __POWERPC__
 	    double *dp = (double *)p - 1;
     #else
 	    uint32 *lp = (uint32 *)p;
     #endif
-	uint8 *cp = color_line;
-	uint8 *mp = matrix_line;
+	const uint8 *cp = l->color;
+	const uint8 *gp = l->gfx;
 
 	// Loop for 40 characters
 	for (int i=0; i<40; i++) {
 		uint8 color = cp[i];
-		uint8 data = r[i] = q[mp[i] << 3];
+		uint8 data = r[i] = gp[i];
 
         #ifdef 	__POWERPC__
 		        *++dp = TextColorTable[color][b0cc][data].b;
@@ -819,16 +1139,28 @@ inline void MOS6569::el_std_text(uint8 *p, uint8 *q, uint8 *r)
 }
 
 
-inline void MOS6569::el_mc_text(uint8 *p, uint8 *q, uint8 *r)
+inline void MOS6569::el_mc_text(uint8 *p, uint8 *r, const line_record_t *l) const
 {
+#ifdef SIMD_LINES
+	if (simd_lines) {
+		simd_mc_text(p, l->gfx, r, l->color, colors_wide, l->bc_color[0], l->bc_color[1], l->bc_color[2]);
+		return;
+	}
+#endif
+
 	uint16 *wp = (uint16 *)p;
-	uint8 *cp = color_line;
-	uint8 *mp = matrix_line;
-	uint16 *mclp = mc_color_lookup;
+	const uint8 *cp = l->color;
+	const uint8 *gp = l->gfx;
+	unsigned int b0cc = l->bc[0];
+
+	uint16 mclp[4];
+	mclp[0] = l->bc_color[0] | (l->bc_color[0] << 8);
+	mclp[1] = l->bc_color[1] | (l->bc_color[1] << 8);
+	mclp[2] = l->bc_color[2] | (l->bc_color[2] << 8);
 
 	// Loop for 40 characters
 	for (int i=0; i<40; i++) {
-		uint8 data = q[mp[i] << 3];
+		uint8 data = gp[i];
 
 		if (cp[i] & 8) {
 			uint8 color = colors[cp[i] & 7];
@@ -843,12 +1175,12 @@ inline void MOS6569::el_mc_text(uint8 *p, uint8 *q, uint8 *r)
 			uint8 color = cp[i];
 			r[i] = data;
             #ifdef __POWERPC__
-			    *(double *)wp = TextColorTable[color][b0c][data].b;
+			    *(double *)wp = TextColorTable[color][b0cc][data].b;
 			    wp += 4;
             #else
-			    *(uint32 *)wp = TextColorTable[color][b0c][data][0].b;
+			    *(uint32 *)wp = TextColorTable[color][b0cc][data][0].b;
 			    wp += 2;
-			    *(uint32 *)wp = TextColorTable[color][b0c][data][1].b;
+			    *(uint32 *)wp = TextColorTable[color][b0cc][data][1].b;
 			    wp += 2;
             #endif
 		}
@@ -856,18 +1188,26 @@ inline void MOS6569::el_mc_text(uint8 *p, uint8 *q, uint8 *r)
 }
 
 
-inline void MOS6569::el_std_bitmap(uint8 *p, uint8 *q, uint8 *r)
+inline void MOS6569::el_std_bitmap(uint8 *p, uint8 *r, const line_record_t *l) const
 {
+#ifdef SIMD_LINES
+	if (simd_lines) {
+		simd_std_bitmap(p, l->gfx, r, l->matrix, colors_wide);
+		return;
+	}
+#endif
+
     #ifdef __POWERPC__
 	    double *dp = (double *)p-1;
     #else
 	    uint32 *lp = (uint32 *)p;
     #endif
-	uint8 *mp = matrix_line;
+	const uint8 *mp = l->matrix;
+	const uint8 *gp = l->gfx;
 
 	// Loop for 40 characters
-	for (int i=0; i<40; i++, q+=8) {
-		uint8 data = r[i] = *q;
+	for (int i=0; i<40; i++) {
+		uint8 data = r[i] = gp[i];
 		uint8 color = mp[i] >> 4;
 		uint8 bcolor = mp[i] & 15;
 
@@ -881,12 +1221,20 @@ inline void MOS6569::el_std_bitmap(uint8 *p, uint8 *q, uint8 *r)
 }
 
 
-inline void MOS6569::el_mc_bitmap(uint8 *p, uint8 *q, uint8 *r)
+inline void MOS6569::el_mc_bitmap(uint8 *p, uint8 *r, const line_record_t *l) const
 {
+#ifdef SIMD_LINES
+	if (simd_lines) {
+		simd_mc_bitmap(p, l->gfx, r, l->matrix, l->color, colors_wide, l->bc_color[0]);
+		return;
+	}
+#endif
+
 	uint16 lookup[4];
 	uint16 *wp = (uint16 *)p - 1;
-	uint8 *cp = color_line;
-	uint8 *mp = matrix_line;
+	const uint8 *cp = l->color;
+	const uint8 *mp = l->matrix;
+	const uint8 *gp = l->gfx;
 
     #ifdef __GNU_C__
 	    &lookup; /* Statement with no effect other than preventing GCC from
@@ -894,10 +1242,10 @@ inline void MOS6569::el_mc_bitmap(uint8 *p, uint8 *q, uint8 *r)
 			      * spectacularly bad code. */
     #endif
 
-	lookup[0] = (b0c_color << 8) | b0c_color;
+	lookup[0] = (l->bc_color[0] << 8) | l->bc_color[0];
 
 	// Loop for 40 characters
-	for (int i=0; i<40; i++, q+=8) {
+	for (int i=0; i<40; i++) {
 		uint8 color, acolor, bcolor;
 
 		color = colors[mp[i] >> 4];
@@ -907,7 +1255,7 @@ inline void MOS6569::el_mc_bitmap(uint8 *p, uint8 *q, uint8 *r)
 		acolor = colors[cp[i]];
 		lookup[3] = (acolor << 8) | acolor;
 
-		uint8 data = *q;
+		uint8 data = gp[i];
 		r[i] = (data & 0xaa) | (data & 0xaa) >> 1;
 
 		*++wp = lookup[(data >> 6) & 3];
@@ -917,16 +1265,24 @@ inline void MOS6569::el_mc_bitmap(uint8 *p, uint8 *q, uint8 *r)
 	}
 }
 
-inline void MOS6569::el_ecm_text(uint8 *p, uint8 *q, uint8 *r)
+inline void MOS6569::el_ecm_text(uint8 *p, uint8 *r, const line_record_t *l) const
 {
+#ifdef SIMD_LINES
+	if (simd_lines) {
+		simd_ecm_text(p, l->gfx, r, l->matrix, l->color, colors_wide, l->bc);
+		return;
+	}
+#endif
+
     #ifdef __POWERPC__
 	    double *dp = (double *)p - 1;
     #else
 	    uint32 *lp = (uint32 *)p;
     #endif
-	uint8 *cp = color_line;
-	uint8 *mp = matrix_line;
-	uint8 *bcp = &b0c;
+	const uint8 *cp = l->color;
+	const uint8 *mp = l->matrix;
+	const uint8 *gp = l->gfx;
+	const uint8 *bcp = l->bc;
 
 	// Loop for 40 characters
 	for (int i=0; i<40; i++) {
@@ -934,7 +1290,7 @@ inline void MOS6569::el_ecm_text(uint8 *p, uint8 *q, uint8 *r)
 		uint8 color = cp[i];
 		uint8 bcolor = bcp[(data >> 6) & 3];
 
-		data = q[(data & 0x3f) << 3];
+		data = gp[i];
         #ifdef __POWERPC__
 		    *++dp = TextColorTable[color][bcolor][data].b;
         #else
@@ -945,12 +1301,12 @@ inline void MOS6569::el_ecm_text(uint8 *p, uint8 *q, uint8 *r)
 }
 
 
-inline void MOS6569::el_std_idle(uint8 *p, uint8 *r)
+inline void MOS6569::el_std_idle(uint8 *p, uint8 *r, const line_record_t *l) const
 {
     #ifdef __POWERPC__
-	    uint8 data = *get_physical(ctrl1 & 0x40 ? 0x39ff : 0x3fff);
+	    uint8 data = l->idle_data;
 	    double *dp = (double *)p - 1;
-	    double conv = TextColorTable[0][b0c][data].b;
+	    double conv = TextColorTable[0][l->bc[0]][data].b;
 	    r--;
 
 	    for (int i=0; i<40; i++) {
@@ -958,10 +1314,10 @@ inline void MOS6569::el_std_idle(uint8 *p, uint8 *r)
 		    *++r = data;
 	    }
     #else
-	    uint8 data = *get_physical(ctrl1 & 0x40 ? 0x39ff : 0x3fff);
+	    uint8 data = l->idle_data;
 	    uint32 *lp = (uint32 *)p;
-	    uint32 conv0 = TextColorTable[0][b0c][data][0].b;
-	    uint32 conv1 = TextColorTable[0][b0c][data][1].b;
+	    uint32 conv0 = TextColorTable[0][l->bc[0]][data][0].b;
+	    uint32 conv1 = TextColorTable[0][l->bc[0]][data][1].b;
 
 	    for (int i=0; i<40; i++) {
 		    *lp++ = conv0;
@@ -972,14 +1328,14 @@ inline void MOS6569::el_std_idle(uint8 *p, uint8 *r)
 }
 
 
-inline void MOS6569::el_mc_idle(uint8 *p, uint8 *r)
+inline void MOS6569::el_mc_idle(uint8 *p, uint8 *r, const line_record_t *l) const
 {
-	uint8 data = *get_physical(0x3fff);
+	uint8 data = l->idle_data;
 	uint32 *lp = (uint32 *)p - 1;
 	r--;
 
 	uint16 lookup[4];
-	lookup[0] = (b0c_color << 8) | b0c_color;
+	lookup[0] = (l->bc_color[0] << 8) | l->bc_color[0];
 	lookup[1] = lookup[2] = lookup[3] = colors[0];
 
 	uint16 conv0 = (lookup[(data >> 6) & 3] << 16) | lookup[(data >> 4) & 3];
@@ -994,26 +1350,25 @@ inline void MOS6569::el_mc_idle(uint8 *p, uint8 *r)
 
 inline void MOS6569::el_sprites(uint8 *chunky_ptr)
 {
-	int i;
 	int snum, sbit;		// Sprite number/bit mask
 	int spr_coll=0, gfx_coll=0;
+	uint8 spr_drawn = 0;	// Sprites with pixels in this line
+	int spr_pos[8];			// Chunky position of each sprite
+	uint64 plane0[8], plane1[8];	// Sprite pixels as bitplanes, leftmost pixel in bit 63
+	uint64 line_any[LINE_MASK_WORDS] = {0}, line_multi[LINE_MASK_WORDS] = {0};
 
-	// Draw each active sprite
+	// Convert each active sprite to bitplanes
 	for (snum=0, sbit=1; snum<8; snum++, sbit<<=1)
 		if ((sprite_on & sbit) && mx[snum] < DISPLAY_X-32) {
 			int spr_mask_pos;	// Sprite bit position in fore_mask_buf
 			uint32 sdata, fore_mask;
-
-			uint8 *p = chunky_ptr + mx[snum] + 8;
-			uint8 *q = spr_coll_buf + mx[snum] + 8;
+			uint64 p0, p1, fore;
 
 			uint8 *sdatap = get_physical(matrix_base[0x3f8 + snum] << 6 | mc[snum]);
 			sdata = (*sdatap << 24) | (*(sdatap+1) << 16) | (*(sdatap+2) << 8);
 
-			uint8 color = spr_color[snum];
-
 			spr_mask_pos = mx[snum] + 8 - x_scroll;
-			
+
 			uint8 *fmbp = fore_mask_buf + (spr_mask_pos / 8);
 			int sshift = spr_mask_pos & 7;
 			fore_mask = (((*(fmbp+0) << 24) | (*(fmbp+1) << 16) | (*(fmbp+2) << 8)
@@ -1023,176 +1378,70 @@ inline void MOS6569::el_sprites(uint8 *chunky_ptr)
 				if (mx[snum] >= DISPLAY_X-56)
 					continue;
 
-				uint32 sdata_l = 0, sdata_r = 0, fore_mask_r;
-				fore_mask_r = (((*(fmbp+4) << 24) | (*(fmbp+5) << 16) | (*(fmbp+6) << 8)
+				uint32 fore_mask_r = (((*(fmbp+4) << 24) | (*(fmbp+5) << 16) | (*(fmbp+6) << 8)
 						| (*(fmbp+7))) << sshift) | (*(fmbp+8) >> (8-sshift));
+				fore = (uint64)fore_mask << 32 | fore_mask_r;
 
 				if (mmc & sbit) {	// Multicolor mode
-					uint32 plane0_l, plane0_r, plane1_l, plane1_r;
-
-					// Expand sprite data
-					sdata_l = MultiExpTable[sdata >> 24 & 0xff] << 16 | MultiExpTable[sdata >> 16 & 0xff];
-					sdata_r = MultiExpTable[sdata >> 8 & 0xff] << 16;
-
-					// Convert sprite chunky pixels to bitplanes
-					plane0_l = (sdata_l & 0x55555555) | (sdata_l & 0x55555555) << 1;
-					plane1_l = (sdata_l & 0xaaaaaaaa) | (sdata_l & 0xaaaaaaaa) >> 1;
-					plane0_r = (sdata_r & 0x55555555) | (sdata_r & 0x55555555) << 1;
-					plane1_r = (sdata_r & 0xaaaaaaaa) | (sdata_r & 0xaaaaaaaa) >> 1;
-
-					// Collision with graphics?
-					if ((fore_mask & (plane0_l | plane1_l)) || (fore_mask_r & (plane0_r | plane1_r))) {
-						gfx_coll |= sbit;
-						if (mdp & sbit)	{
-							plane0_l &= ~fore_mask;	// Mask sprite if in background
-							plane1_l &= ~fore_mask;
-							plane0_r &= ~fore_mask_r;
-							plane1_r &= ~fore_mask_r;
-						}
-					}
-
-					// Paint sprite
-					for (i=0; i<32; i++, plane0_l<<=1, plane1_l<<=1) {
-						uint8 col;
-						if (plane1_l & 0x80000000) {
-							if (plane0_l & 0x80000000)
-								col = mm1_color;
-							else
-								col = color;
-						} else {
-							if (plane0_l & 0x80000000)
-								col = mm0_color;
-							else
-								continue;
-						}
-						if (q[i])
-							spr_coll |= q[i] | sbit;
-						else {
-							p[i] = col;
-							q[i] = sbit;
-						}
-					}
-					for (; i<48; i++, plane0_r<<=1, plane1_r<<=1) {
-						uint8 col;
-						if (plane1_r & 0x80000000) {
-							if (plane0_r & 0x80000000)
-								col = mm1_color;
-							else
-								col = color;
-						} else {
-							if (plane0_r & 0x80000000)
-								col = mm0_color;
-							else
-								continue;
-						}
-						if (q[i])
-							spr_coll |= q[i] | sbit;
-						else {
-							p[i] = col;
-							q[i] = sbit;
-						}
-					}
-
+					uint64 sdata_x = (uint64)(uint32)(MultiExpTable[sdata >> 24 & 0xff] << 16 | MultiExpTable[sdata >> 16 & 0xff]) << 32
+						| (uint64)MultiExpTable[sdata >> 8 & 0xff] << 16;
+					p0 = (sdata_x & 0x5555555555555555ULL) | (sdata_x & 0x5555555555555555ULL) << 1;
+					p1 = (sdata_x & 0xaaaaaaaaaaaaaaaaULL) | (sdata_x & 0xaaaaaaaaaaaaaaaaULL) >> 1;
 				} else {			// Standard mode
-
-					// Expand sprite data
-					sdata_l = ExpTable[sdata >> 24 & 0xff] << 16 | ExpTable[sdata >> 16 & 0xff];
-					sdata_r = ExpTable[sdata >> 8 & 0xff] << 16;
-
-					// Collision with graphics?
-					if ((fore_mask & sdata_l) || (fore_mask_r & sdata_r)) {
-						gfx_coll |= sbit;
-						if (mdp & sbit)	{
-							sdata_l &= ~fore_mask;	// Mask sprite if in background
-							sdata_r &= ~fore_mask_r;
-						}
-					}
-
-					// Paint sprite
-					for (i=0; i<32; i++, sdata_l<<=1)
-						if (sdata_l & 0x80000000) {
-							if (q[i])	// Collision with sprite?
-								spr_coll |= q[i] | sbit;
-							else {		// Draw pixel if no collision
-								p[i] = color;
-								q[i] = sbit;
-							}
-						}
-					for (; i<48; i++, sdata_r<<=1)
-						if (sdata_r & 0x80000000) {
-							if (q[i]) 	// Collision with sprite?
-								spr_coll |= q[i] | sbit;
-							else {		// Draw pixel if no collision
-								p[i] = color;
-								q[i] = sbit;
-							}
-						}
+					p0 = 0;
+					p1 = (uint64)(uint32)(ExpTable[sdata >> 24 & 0xff] << 16 | ExpTable[sdata >> 16 & 0xff]) << 32
+						| (uint64)ExpTable[sdata >> 8 & 0xff] << 16;
 				}
 
-			} else					// Unexpanded
+			} else {				// Unexpanded
+				fore = (uint64)fore_mask << 32;
 
 				if (mmc & sbit) {	// Multicolor mode
-					uint32 plane0, plane1;
-
-					// Convert sprite chunky pixels to bitplanes
-					plane0 = (sdata & 0x55555555) | (sdata & 0x55555555) << 1;
-					plane1 = (sdata & 0xaaaaaaaa) | (sdata & 0xaaaaaaaa) >> 1;
-
-					// Collision with graphics?
-					if (fore_mask & (plane0 | plane1)) {
-						gfx_coll |= sbit;
-						if (mdp & sbit) {
-							plane0 &= ~fore_mask;	// Mask sprite if in background
-							plane1 &= ~fore_mask;
-						}
-					}
-
-					// Paint sprite
-					for (i=0; i<24; i++, plane0<<=1, plane1<<=1) {
-						uint8 col;
-						if (plane1 & 0x80000000) {
-							if (plane0 & 0x80000000)
-								col = mm1_color;
-							else
-								col = color;
-						} else {
-							if (plane0 & 0x80000000)
-								col = mm0_color;
-							else
-								continue;
-						}
-						if (q[i])
-							spr_coll |= q[i] | sbit;
-						else {
-							p[i] = col;
-							q[i] = sbit;
-						}
-					}
-
+					p0 = (uint64)((sdata & 0x55555555) | (sdata & 0x55555555) << 1) << 32;
+					p1 = (uint64)((sdata & 0xaaaaaaaa) | (sdata & 0xaaaaaaaa) >> 1) << 32;
 				} else {			// Standard mode
+					p0 = 0;
+					p1 = (uint64)sdata << 32;
+				}
+			}
 
-					// Collision with graphics?
-					if (fore_mask & sdata) {
-						gfx_coll |= sbit;
-						if (mdp & sbit)
-							sdata &= ~fore_mask;	// Mask sprite if in background
-					}
-	
-					// Paint sprite
-					for (i=0; i<24; i++, sdata<<=1)
-						if (sdata & 0x80000000) {
-							if (q[i]) {		// Collision with sprite?
-								spr_coll |= q[i] | sbit;
-							} else {		// Draw pixel if no collision
-								p[i] = color;
-								q[i] = sbit;
-							}
-						}
-
+			// Collision with graphics?
+			if (fore & (p0 | p1)) {
+				gfx_coll |= sbit;
+				if (mdp & sbit) {
+					p0 &= ~fore;	// Mask sprite if in background
+					p1 &= ~fore;
 				}
+			}
+
+			if (p0 | p1) {
+				spr_pos[snum] = mx[snum] + 8;
+				plane0[snum] = p0;
+				plane1[snum] = p1;
+				spr_drawn |= sbit;
+				line_mask_add(line_any, line_multi, spr_pos[snum], p0 | p1);
+			}
 		}
 
-	if (ThePrefs.SpriteCollisions) {
+	// Paint sprites from back to front, so sprite 0 has the highest
+	// priority, and find all sprites with pixels that are also covered
+	// by another sprite
+	for (snum=7, sbit=0x80; snum>=0; snum--, sbit>>=1)
+		if (spr_drawn & sbit) {
+			uint8 *p = chunky_ptr + spr_pos[snum];
+			uint64 p0 = plane0[snum], p1 = plane1[snum];
+
+			if (line_mask_get(line_multi, spr_pos[snum]) & (p0 | p1))
+				spr_coll |= sbit;
+
+			paint_sprite_pixels(p, p1 & ~p0, spr_color[snum]);
+			if (p0) {
+				paint_sprite_pixels(p, p0 & ~p1, mm0_color);
+				paint_sprite_pixels(p, p0 & p1, mm1_color);
+			}
+		}
+
+	if (the_c64->ThePrefs.SpriteCollisions) {
 
 		// Check sprite-sprite collisions
 		if (clx_spr)
@@ -1392,13 +1641,269 @@ static asm void fastcopy(register uchar *dst, register uchar *src)
 #endif
 
 
+/*
+ *  Latch the state of the current line and fetch its graphics data
+ */
+
+void MOS6569::latch_line(line_record_t *l, int raster)
+{
+	l->dest = chunky_line_start;
+	l->row = raster - FIRST_DISP_LINE;
+	l->dirty = dirty_rows + l->row;
+	l->display_idx = display_idx;
+	l->display_state = display_state;
+	l->border_on = border_on;
+	l->border_40_col = border_40_col;
+	l->x_scroll = x_scroll;
+	l->ec_color = ec_color;
+	l->bc[0] = b0c; l->bc[1] = b1c; l->bc[2] = b2c; l->bc[3] = b3c;
+	l->bc_color[0] = b0c_color; l->bc_color[1] = b1c_color;
+	l->bc_color[2] = b2c_color; l->bc_color[3] = b3c_color;
+
+	if (border_on)
+		return;
+
+	if (!display_state) {
+		l->idle_data = *get_physical((display_idx != 3 && (ctrl1 & 0x40)) ? 0x39ff : 0x3fff);
+		return;
+	}
+
+	memcpy(l->matrix, matrix_line, 40);
+	memcpy(l->color, color_line, 40);
+
+	uint8 *gp = l->gfx;
+	switch (display_idx) {
+		case 0:		// Standard text
+		case 1: {	// Multicolor text
+			uint8 *q = char_base + rc;
+			for (int i=0; i<40; i++)
+				gp[i] = q[matrix_line[i] << 3];
+			break;
+		}
+		case 4: {	// ECM text
+			uint8 *q = char_base + rc;
+			for (int i=0; i<40; i++)
+				gp[i] = q[(matrix_line[i] & 0x3f) << 3];
+			break;
+		}
+		case 2:		// Standard bitmap
+		case 3: {	// Multicolor bitmap
+			uint8 *q = bitmap_base + (vc << 3) + rc;
+			for (int i=0; i<40; i++, q+=8)
+				gp[i] = *q;
+			break;
+		}
+	}
+}
+
+
+/*
+ *  Draw the graphics of a latched line (everything but the sprites
+ *  and the left/right border). Only reads the line record and the
+ *  constant tables, so it can run on the render worker.
+ */
+
+void MOS6569::draw_graphics(const line_record_t *l, uint8 *chunky_ptr, uint8 *r, uint8 *text_buf) const
+{
+	if (l->border_on) {
+
+		// Display top/bottom border
+		uint32 *lp = (uint32 *)chunky_ptr - 1;
+		uint32 c = l->ec_color * 0x01010101;
+		for (int i=0; i<DISPLAY_X/4; i++)
+			*++lp = c;
+		return;
+	}
+
+	// Display window contents
+	uint8 *p = chunky_ptr + COL40_XSTART;		// Pointer in chunky display buffer
+	r += COL40_XSTART/8;						// Pointer in foreground mask buffer
+
+	{
+		p--;
+		uint8 b0cc = l->bc_color[0];
+		int limit = l->x_scroll;
+		for (int i=0; i<limit; i++)	// Background on the left if XScroll>0
+			*++p = b0cc;
+		p++;
+	}
+
+	// Graphics that are not aligned go through a buffer on CPUs that
+	// can't access unaligned data
+	uint8 *use_p = p;
+#ifndef CAN_ACCESS_UNALIGNED
+#ifdef ALIGNMENT_CHECK
+	if (((long)p) & 3)
+		use_p = text_buf;
+#else
+	if (l->x_scroll)
+		use_p = text_buf;
+#endif
+#endif
+
+	if (l->display_state) {
+		switch (l->display_idx) {
+			case 0:	// Standard text
+				el_std_text(use_p, r, l);
+				break;
+			case 1:	// Multicolor text
+				el_mc_text(use_p, r, l);
+				break;
+			case 2:	// Standard bitmap
+				el_std_bitmap(use_p, r, l);
+				break;
+			case 3:	// Multicolor bitmap
+				el_mc_bitmap(use_p, r, l);
+				break;
+			case 4:	// ECM text
+				el_ecm_text(use_p, r, l);
+				break;
+			default:	// Invalid mode (all black)
+				memset(use_p, colors[0], 320);
+				memset(r, 0, 40);
+				break;
+		}
+
+	} else {	// Idle state graphics
+		switch (l->display_idx) {
+			case 0:		// Standard text
+			case 1:		// Multicolor text
+			case 4:		// ECM text
+				el_std_idle(use_p, r, l);
+				break;
+			case 3:		// Multicolor bitmap
+				el_mc_idle(use_p, r, l);
+				break;
+			default:	// Invalid mode (all black)
+				memset(use_p, colors[0], 320);
+				memset(r, 0, 40);
+				break;
+		}
+	}
+
+	if (use_p != p)
+		memcpy(p, use_p, 8*40);
+}
+
+
+/*
+ *  Draw the left/right border of a latched line, over the sprites
+ */
+
+void MOS6569::draw_side_border(const line_record_t *l, uint8 *chunky_ptr) const
+{
+	if (l->border_on)
+		return;
+
+	uint32 *lp = (uint32 *)chunky_ptr - 1;
+	uint32 c = l->ec_color * 0x01010101;
+	for (int i=0; i<COL40_XSTART/4; i++)
+		*++lp = c;
+	lp = (uint32 *)(chunky_ptr + COL40_XSTOP) - 1;
+	for (int i=0; i<(DISPLAY_X-COL40_XSTOP)/4; i++)
+		*++lp = c;
+	if (!l->border_40_col) {
+		uint8 *p = chunky_ptr + COL40_XSTART - 1;
+		for (int i=0; i<COL38_XSTART-COL40_XSTART; i++)
+			*++p = l->ec_color;
+		p = chunky_ptr + COL38_XSTOP - 1;
+		for (int i=0; i<COL40_XSTOP-COL38_XSTOP; i++)
+			*++p = l->ec_color;
+	}
+}
+
+
+/*
+ *  Set the dirty flag of a drawn line and move it to the bitmap
+ */
+
+void MOS6569::finish_line(const line_record_t *l, uint8 *chunky_ptr) const
+{
+	// Compare with the last drawn frame, so the display only
+	// uploads changed rows
+	uint8 *last = last_lines + l->row * DISPLAY_X;
+	if (memcmp(last, chunky_ptr, DISPLAY_X)) {
+		memcpy(last, chunky_ptr, DISPLAY_X);
+		*l->dirty = 1;
+	} else
+		*l->dirty = 0;
+
+#ifdef __POWERPC__
+	// Copy temporary buffer to bitmap
+	fastcopy(l->dest, chunky_ptr);
+#else
+	// Convert line buffer to RGBA pixels
+	if (rgba_lines) {
+		uint64 *dp = (uint64 *)l->dest;
+		const uint8 *sp = chunky_ptr;
+		for (int i=0; i<DISPLAY_X/2; i++, sp+=2)
+			dp[i] = rgba_pairs[(sp[0] & 0x0f) << 4 | (sp[1] & 0x0f)];
+	}
+#endif
+}
+
+
+/*
+ *  Render worker: draws the lines without sprites on a second thread
+ *  while the emulation goes on. EmulateLine() is the only producer,
+ *  the worker the only consumer of the ring. A frame fits into the
+ *  ring, vblank() waits until the worker has drawn all lines.
+ */
+
+int MOS6569::line_worker_entry(void *arg)
+{
+	((MOS6569 *)arg)->line_worker();
+	return 0;
+}
+
+void MOS6569::line_worker(void)
+{
+	// The worker's own line buffers
+	double line_buf[DISPLAY_X/8];
+	uint8 mask_buf[DISPLAY_X/8];
+	uint8 text_buf[40*8];
+
+	while (true) {
+		SDL_SemWait(line_wake);
+		if (atomic_load32(&line_quit))
+			break;
+
+		uint32 tail = line_tail;
+		uint32 head = atomic_load32(&line_head);
+		for (; tail != head; tail++) {
+			const line_record_t *l = &line_ring[tail & (LINE_RING_SIZE-1)];
+#ifdef __POWERPC__
+			uint8 *chunky_ptr = (uint8 *)line_buf;
+#else
+			uint8 *chunky_ptr = rgba_lines ? (uint8 *)line_buf : l->dest;
+#endif
+			draw_graphics(l, chunky_ptr, mask_buf, text_buf);
+			draw_side_border(l, chunky_ptr);
+			finish_line(l, chunky_ptr);
+			atomic_store32(&line_tail, tail + 1);
+		}
+	}
+}
+
+void MOS6569::wait_line_worker(void)
+{
+	if (line_ring == NULL)
+		return;
+
+	uint32 head = line_head;
+	SDL_SemPost(line_wake);
+	while (atomic_load32(&line_tail) != head)
+		SDL_Delay(0);
+}
+
+
 /*
  *  Emulate one raster line
  */
 
 int MOS6569::EmulateLine(void)
 {
-	int cycles_left = ThePrefs.NormalCycles;	// Cycles left for CPU
+	int cycles_left = the_c64->ThePrefs.NormalCycles;	// Cycles left for CPU
 	bool is_bad_line = false;
 
 	// Get raster counter into local variable for faster access and increment
@@ -1420,27 +1925,9 @@ int MOS6569::EmulateLine(void)
 	if (raster == 0x30)
 		bad_lines_enabled = ctrl1 & 0x10;
 
-	// Skip frame? Only calculate Bad Lines then
-	if (frame_skipped) 
-    {
-		if (raster >= FIRST_DMA_LINE && raster <= LAST_DMA_LINE && ((raster & 7) == y_scroll) && bad_lines_enabled) 
-        {
-			is_bad_line = true;
-			cycles_left = ThePrefs.BadLineCycles;
-		}
-		goto VIC_nop;
-	}
-
 	// Within the visible range?
 	if (raster >= FIRST_DISP_LINE && raster <= LAST_DISP_LINE) {
 
-		// Our output goes here
-#ifdef __POWERPC__
-		uint8 *chunky_ptr = (uint8 *)chunky_tmp;
-#else
-		uint8 *chunky_ptr = chunky_line_start;
-#endif
-
 		// Set video counter
 		vc = vc_base;
 
@@ -1449,7 +1936,7 @@ int MOS6569::EmulateLine(void)
 
 			// Turn on display
 			display_state = is_bad_line = true;
-			cycles_left = ThePrefs.BadLineCycles;
+			cycles_left = the_c64->ThePrefs.BadLineCycles;
 			rc = 0;
 
 			// Read and latch 40 bytes from video matrix and color RAM
@@ -1470,245 +1957,57 @@ int MOS6569::EmulateLine(void)
 		if (raster == dy_start && (ctrl1 & 0x10)) // Don't turn off border if DEN bit cleared
 			border_on = false;
 
-		if (!border_on) {
-
-			// Display window contents
-			uint8 *p = chunky_ptr + COL40_XSTART;		// Pointer in chunky display buffer
-			uint8 *r = fore_mask_buf + COL40_XSTART/8;	// Pointer in foreground mask buffer
-#ifdef ALIGNMENT_CHECK
-			uint8 *use_p = ((((int)p) & 3) == 0) ? p : text_chunky_buf;
-#endif
-
-			{
-				p--;
-				uint8 b0cc = b0c_color;
-				int limit = x_scroll;
-				for (int i=0; i<limit; i++)	// Background on the left if XScroll>0
-					*++p = b0cc;
-				p++;
-			}
+		// Lines with sprites are drawn right away, the collisions
+		// are needed now. Skipped frames keep the video counters,
+		// Bad Lines and sprite collisions exact, they only draw
+		// lines with sprites, into a scratch line.
+		bool draw_sprites = !border_on && sprite_on && the_c64->ThePrefs.SpritesOn;
 
-			if (display_state) {
-				switch (display_idx) {
+		if (line_ring != NULL && !frame_skipped && !draw_sprites) {
 
-					case 0:	// Standard text
-#ifndef CAN_ACCESS_UNALIGNED
-#ifdef ALIGNMENT_CHECK
-						el_std_text(use_p, char_base + rc, r);
-						if (use_p != p)
-							memcpy(p, use_p, 8*40);
-#else
-						if (x_scroll) {
-							el_std_text(text_chunky_buf, char_base + rc, r);
-							memcpy(p, text_chunky_buf, 8*40);					        
-						} else
-							el_std_text(p, char_base + rc, r);
-#endif
-#else
-						el_std_text(p, char_base + rc, r);
-#endif
-						break;
+			// Leave the pixels to the render worker
+			uint32 head = line_head;
+			latch_line(&line_ring[head & (LINE_RING_SIZE-1)], raster);
+			atomic_store32(&line_head, head + 1);
+			if ((head & 15) == 15)
+				SDL_SemPost(line_wake);
 
-					case 1:	// Multicolor text
-#ifndef CAN_ACCESS_UNALIGNED
-#ifdef ALIGNMENT_CHECK
-						el_mc_text(use_p, char_base + rc, r);
-						if (use_p != p)
-							memcpy(p, use_p, 8*40);
-#else
-						if (x_scroll) {
-							el_mc_text(text_chunky_buf, char_base + rc, r);
-							memcpy(p, text_chunky_buf, 8*40);					        
-						} else
-							el_mc_text(p, char_base + rc, r);
-#endif
-#else
-						el_mc_text(p, char_base + rc, r);
-#endif
-						break;
-
-					case 2:	// Standard bitmap
-#ifndef CAN_ACCESS_UNALIGNED
-#ifdef ALIGNMENT_CHECK
-						el_std_bitmap(use_p, bitmap_base + (vc << 3) + rc, r);
-						if (use_p != p)
-							memcpy(p, use_p, 8*40);
-#else
-						if (x_scroll) {
-							el_std_bitmap(text_chunky_buf, bitmap_base + (vc << 3) + rc, r);
-							memcpy(p, text_chunky_buf, 8*40);					        
-						} else
-							el_std_bitmap(p, bitmap_base + (vc << 3) + rc, r);
-#endif
-#else
-						el_std_bitmap(p, bitmap_base + (vc << 3) + rc, r);
-#endif
-						break;
+		} else if (!frame_skipped || draw_sprites) {
 
-					case 3:	// Multicolor bitmap
-#ifndef CAN_ACCESS_UNALIGNED
-#ifdef ALIGNMENT_CHECK
-						el_mc_bitmap(use_p, bitmap_base + (vc << 3) + rc, r);
-						if (use_p != p)
-							memcpy(p, use_p, 8*40);
-#else
-						if (x_scroll) {
-							el_mc_bitmap(text_chunky_buf, bitmap_base + (vc << 3) + rc, r);
-							memcpy(p, text_chunky_buf, 8*40);					        
-						} else
-							el_mc_bitmap(p, bitmap_base + (vc << 3) + rc, r);
-#endif
+			// Our output goes here
+#ifdef __POWERPC__
+			uint8 *chunky_ptr = (uint8 *)chunky_tmp;
 #else
-						el_mc_bitmap(p, bitmap_base + (vc << 3) + rc, r);
+			uint8 *chunky_ptr = rgba_lines ? (uint8 *)rgba_line_buf : chunky_line_start;
 #endif
-						break;
+			if (frame_skipped)
+				chunky_ptr = (uint8 *)skip_line_buf;
 
-					case 4:	// ECM text
 #ifndef CAN_ACCESS_UNALIGNED
-#ifdef ALIGNMENT_CHECK
-						el_ecm_text(use_p, char_base + rc, r);
-						if (use_p != p)
-							memcpy(p, use_p, 8*40);
+			uint8 *text_buf = text_chunky_buf;
 #else
-						if (x_scroll) {
-							el_ecm_text(text_chunky_buf, char_base + rc, r);
-							memcpy(p, text_chunky_buf, 8*40);					        
-						} else
-							el_ecm_text(p, char_base + rc, r);
+			uint8 *text_buf = NULL;
 #endif
-#else
-						el_ecm_text(p, char_base + rc, r);
-#endif
-						break;
-
-					default:	// Invalid mode (all black)
-						memset(p, colors[0], 320);
-						memset(r, 0, 40);
-						break;
-				}
-				vc += 40;
 
-			} else {	// Idle state graphics
-				switch (display_idx) {
-
-					case 0:		// Standard text
-					case 1:		// Multicolor text
-					case 4:		// ECM text
-#ifndef CAN_ACCESS_UNALIGNED
-#ifdef ALIGNMENT_CHECK
-						el_std_idle(use_p, r);
-						if (use_p != p) {memcpy(p, use_p, 8*40);}
-#else
-						if (x_scroll) {
-							el_std_idle(text_chunky_buf, r);
-							memcpy(p, text_chunky_buf, 8*40);					        
-						} else
-							el_std_idle(p, r);
-#endif
-#else
-						el_std_idle(p, r);
-#endif
-						break;
-
-					case 3:		// Multicolor bitmap
-#ifndef CAN_ACCESS_UNALIGNED
-#ifdef ALIGNMENT_CHECK
-						el_mc_idle(use_p, r);
-						if (use_p != p) {memcpy(p, use_p, 8*40);}
-#else
-						if (x_scroll) {
-							el_mc_idle(text_chunky_buf, r);
-							memcpy(p, text_chunky_buf, 8*40);					        
-						} else
-							el_mc_idle(p, r);
-#endif
-#else
-						el_mc_idle(p, r);
-#endif
-						break;
-
-					default:	// Invalid mode (all black)
-						memset(p, colors[0], 320);
-						memset(r, 0, 40);
-						break;
-				}
-			}
+			latch_line(&line_record, raster);
+			draw_graphics(&line_record, chunky_ptr, fore_mask_buf, text_buf);
 
 			// Draw sprites
-			if (sprite_on && ThePrefs.SpritesOn) {
-
-				// Clear sprite collision buffer
-				uint32 *lp = (uint32 *)spr_coll_buf - 1;
-				for (int i=0; i<DISPLAY_X/4; i++)
-					*++lp = 0;
-
+			if (draw_sprites)
 				el_sprites(chunky_ptr);
-			}
-
-			// Handle left/right border
-			uint32 *lp = (uint32 *)chunky_ptr - 1;
-			uint32 c = ec_color_long;
-			for (int i=0; i<COL40_XSTART/4; i++)
-				*++lp = c;
-			lp = (uint32 *)(chunky_ptr + COL40_XSTOP) - 1;
-			for (int i=0; i<(DISPLAY_X-COL40_XSTOP)/4; i++)
-				*++lp = c;
-			if (!border_40_col) {
-				c = ec_color;
-				p = chunky_ptr + COL40_XSTART - 1;
-				for (int i=0; i<COL38_XSTART-COL40_XSTART; i++)
-					*++p = c;
-				p = chunky_ptr + COL38_XSTOP - 1;
-				for (int i=0; i<COL40_XSTOP-COL38_XSTOP; i++)
-					*++p = c;
-			}
 
-#if 0
-			if (is_bad_line) {
-				chunky_ptr[DISPLAY_X-2] = colors[7];
-				chunky_ptr[DISPLAY_X-3] = colors[7];
-			}
-			if (rc & 1) {
-				chunky_ptr[DISPLAY_X-4] = colors[1];
-				chunky_ptr[DISPLAY_X-5] = colors[1];
-			}
-			if (rc & 2) {
-				chunky_ptr[DISPLAY_X-6] = colors[1];
-				chunky_ptr[DISPLAY_X-7] = colors[1];
-			}
-			if (rc & 4) {
-				chunky_ptr[DISPLAY_X-8] = colors[1];
-				chunky_ptr[DISPLAY_X-9] = colors[1];
-			}
-			if (ctrl1 & 0x40) {
-				chunky_ptr[DISPLAY_X-10] = colors[5];
-				chunky_ptr[DISPLAY_X-11] = colors[5];
-			}
-			if (ctrl1 & 0x20) {
-				chunky_ptr[DISPLAY_X-12] = colors[3];
-				chunky_ptr[DISPLAY_X-13] = colors[3];
-			}
-			if (ctrl2 & 0x10) {
-				chunky_ptr[DISPLAY_X-14] = colors[2];
-				chunky_ptr[DISPLAY_X-15] = colors[2];
-			}
-#endif
-		} else {
+			draw_side_border(&line_record, chunky_ptr);
 
-			// Display top/bottom border
-			uint32 *lp = (uint32 *)chunky_ptr - 1;
-			uint32 c = ec_color_long;
-			for (int i=0; i<DISPLAY_X/4; i++)
-				*++lp = c;
+			if (!frame_skipped)
+				finish_line(&line_record, chunky_ptr);
 		}
 
-#ifdef __POWERPC__
-		// Copy temporary buffer to bitmap
-		fastcopy(chunky_line_start, (uint8 *)chunky_tmp);
-#endif
+		if (display_state && !border_on)
+			vc += 40;
 
 		// Increment pointer in chunky buffer
-		chunky_line_start += xmod;
+		if (!frame_skipped)
+			chunky_line_start += xmod;
 
 		// Increment row counter, go to idle state on overflow
 		if (rc == 7) {
@@ -1721,7 +2020,6 @@ int MOS6569::EmulateLine(void)
 			rc = 0;
 	}
 
-VIC_nop:
 	// Skip this if all sprites are off
 	if (me | sprite_on)
     {
@@ -11,6 +11,8 @@
 #include "font.h"
 #include "renderer.h"
 
+#include <algorithm>
+
 static void clearGlError()
 {
     glGetError();
@@ -30,10 +32,6 @@ static void checkGlErrorImpl(const char* file, int line)
 static bool flipTextureHorizontally = false;
 static bool flipTextureVertically = false;
 
-float Renderer::quadCoords[8]    = { 0.0f };
-float Renderer::quadTexCoords[8] = { 0.0f };
-float Renderer::quadColors[16]   = { 0.0f };
-
 Renderer* Renderer::__instance = NULL;
 
 Renderer::Renderer()
@@ -46,6 +44,10 @@ Renderer::Renderer()
     }
 
     currentFont = NULL;
+
+    currentColor[0] = currentColor[1] = currentColor[2] = currentColor[3] = 1.0f;
+
+    batchCount = 0;
 }
 
 Renderer::~Renderer()
@@ -129,6 +131,8 @@ void Renderer::beginDraw()
 {
     if (disposed) return;
 
+    batchCount = 0;
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // draw
@@ -139,29 +143,33 @@ void Renderer::endDraw()
 {
     if (disposed) return;
 
+    flush();
+
     glPopMatrix();
 
     // swap opengl buffers
     SDL_GL_SwapBuffers();
 }
 
-void Renderer::fillRectangle(float x, float y, float width, float height)
+void Renderer::setColor(float r, float g, float b, float a)
 {
-    float texHorizontalMin = (!flipTextureHorizontally) ? 0.0f : 1.0f;
-    float texHorizontalMax = 1.0f - texHorizontalMin;
-
-    float texVerticalMin = (!flipTextureVertically) ? 0.0f : 1.0f;
-    float texVerticalMax = 1.0f - texVerticalMin;
+    currentColor[0] = r;
+    currentColor[1] = g;
+    currentColor[2] = b;
+    currentColor[3] = a;
+}
 
-    drawQuad(GL_TRIANGLE_FAN,
+void Renderer::fillRectangle(float x, float y, float width, float height)
+{
+    drawQuad(NULL,
              x, y,
              x+width, y,
              x+width, y+height,
              x, y+height,
-             texHorizontalMin, texVerticalMin,
-             texHorizontalMax, texVerticalMin,
-             texHorizontalMax, texVerticalMax,
-             texHorizontalMin, texVerticalMax);
+             0.0f, 0.0f,
+             0.0f, 0.0f,
+             0.0f, 0.0f,
+             0.0f, 0.0f);
 }
 
 void Renderer::draw(int mode, int count, float* coords, float* colors, float* texCoords)
@@ -206,27 +214,107 @@ void Renderer::draw(int mode, int count, float* coords, float* colors, float* te
 }
 
 
-void Renderer::drawQuad(int mode,
-                          float x1, float y1,
-                          float x2, float y2,
-                          float x3, float y3,
-                          float x4, float y4,
-                          float u1, float v1,
-                          float u2, float v2,
-                          float u3, float v3,
-                          float u4, float v4)
+/*
+ *  A quad joins the newest batch with the same texture, as long as it
+ *  does not overlap any batch drawn after that one. Otherwise it starts
+ *  a new batch, so the blending order on screen stays the same.
+ */
+
+void Renderer::drawQuad(Texture* texture,
+                        float x1, float y1,
+                        float x2, float y2,
+                        float x3, float y3,
+                        float x4, float y4,
+                        float u1, float v1,
+                        float u2, float v2,
+                        float u3, float v3,
+                        float u4, float v4)
+{
+    float minX = std::min(std::min(x1, x2), std::min(x3, x4));
+    float maxX = std::max(std::max(x1, x2), std::max(x3, x4));
+    float minY = std::min(std::min(y1, y2), std::min(y3, y4));
+    float maxY = std::max(std::max(y1, y2), std::max(y3, y4));
+
+    draw_batch_t* batch = NULL;
+
+    for (int i=batchCount-1; i>=0; i--)
+    {
+        draw_batch_t& other = batches[i];
+
+        if (other.texture == texture)
+        {
+            batch = &other;
+            break;
+        }
+
+        if (minX < other.x2 && maxX > other.x1 &&
+            minY < other.y2 && maxY > other.y1)
+        {
+            break;
+        }
+    }
+
+    if (NULL == batch)
+    {
+        if (batchCount == (int) batches.size())
+        {
+            batches.push_back(draw_batch_t());
+        }
+
+        batch = &batches[batchCount++];
+        batch->texture = texture;
+        batch->x1 = minX;
+        batch->y1 = minY;
+        batch->x2 = maxX;
+        batch->y2 = maxY;
+        batch->coords.clear();
+        batch->texCoords.clear();
+        batch->colors.clear();
+    }
+    else
+    {
+        if (minX < batch->x1) batch->x1 = minX;
+        if (minY < batch->y1) batch->y1 = minY;
+        if (maxX > batch->x2) batch->x2 = maxX;
+        if (maxY > batch->y2) batch->y2 = maxY;
+    }
+
+    const float coords[12]    = { x1, y1, x2, y2, x3, y3, x1, y1, x3, y3, x4, y4 };
+    const float texCoords[12] = { u1, v1, u2, v2, u3, v3, u1, v1, u3, v3, u4, v4 };
+
+    batch->coords.insert(batch->coords.end(), coords, coords + 12);
+    batch->texCoords.insert(batch->texCoords.end(), texCoords, texCoords + 12);
+
+    for (int i=0; i<6; i++)
+    {
+        batch->colors.insert(batch->colors.end(), currentColor, currentColor + 4);
+    }
+}
+
+void Renderer::flush()
 {
-    quadCoords[0] = x1; quadCoords[1] = y1;
-    quadCoords[2] = x2; quadCoords[3] = y2;
-    quadCoords[4] = x3; quadCoords[5] = y3;
-    quadCoords[6] = x4; quadCoords[7] = y4;
+    for (int i=0; i<batchCount; i++)
+    {
+        draw_batch_t& batch = batches[i];
+
+        if (NULL != batch.texture)
+        {
+            batch.texture->bind();
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
 
-    quadTexCoords[0] = u1; quadTexCoords[1] = v1;
-    quadTexCoords[2] = u2; quadTexCoords[3] = v2;
-    quadTexCoords[4] = u3; quadTexCoords[5] = v3;
-    quadTexCoords[6] = u4; quadTexCoords[7] = v4;
+        draw(GL_TRIANGLES, (int) batch.coords.size() / 2, &batch.coords[0], &batch.colors[0], &batch.texCoords[0]);
 
-    draw(mode, 4, quadCoords, NULL, quadTexCoords);
+        if (NULL != batch.texture)
+        {
+            batch.texture->unbind();
+        }
+    }
+
+    batchCount = 0;
 }
 
 void Renderer::drawTexture(Texture* texture, float x, float y, float width, float height)
@@ -234,9 +322,21 @@ void Renderer::drawTexture(Texture* texture, float x, float y, float width, floa
     if (width < 0.0f) width = texture->getWidth();
     if (height < 0.0f) height = texture->getHeight();
 
-    texture->bind();
-    fillRectangle(x, y, width, height);
-    texture->unbind();
+    float texHorizontalMin = (!flipTextureHorizontally) ? 0.0f : 1.0f;
+    float texHorizontalMax = 1.0f - texHorizontalMin;
+
+    float texVerticalMin = (!flipTextureVertically) ? 0.0f : 1.0f;
+    float texVerticalMax = 1.0f - texVerticalMin;
+
+    drawQuad(texture,
+             x, y,
+             x+width, y,
+             x+width, y+height,
+             x, y+height,
+             texHorizontalMin, texVerticalMin,
+             texHorizontalMax, texVerticalMin,
+             texHorizontalMax, texVerticalMax,
+             texHorizontalMin, texVerticalMax);
 }
 
 void Renderer::drawTiledTexture(Texture* texture,
@@ -244,8 +344,6 @@ void Renderer::drawTiledTexture(Texture* texture,
                                 float width, float height,
                                 bool horizontal, bool vertical)
 {
-    texture->bind();
-
     float w1 = texture->getWidth()/2.0f;
     float h1 = texture->getHeight()/2.0f;
 
@@ -254,7 +352,7 @@ void Renderer::drawTiledTexture(Texture* texture,
 
     if (horizontal && vertical)
     {
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x, y,
                  x+w1, y,
                  x+w1, y+h1,
@@ -264,7 +362,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  0.5f, 0.5f,
                  0.0f, 0.5f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x+w1, y,
                  x+w2, y,
                  x+w2, y+h1,
@@ -274,7 +372,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  0.5f, 0.5f,
                  0.5f, 0.5f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x+w2, y,
                  x+width, y,
                  x+width, y+h1,
@@ -286,7 +384,7 @@ void Renderer::drawTiledTexture(Texture* texture,
 
         /////////////////////////////
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x, y+h1,
                  x+w1, y+h1,
                  x+w1, y+h2,
@@ -296,7 +394,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  0.5f, 0.5f,
                  0.0f, 0.5f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x+w1, y+h1,
                  x+w2, y+h1,
                  x+w2, y+h2,
@@ -306,7 +404,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  0.5f, 0.5f,
                  0.5f, 0.5f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x+w2, y+h1,
                  x+width, y+h1,
                  x+width, y+h2,
@@ -318,7 +416,7 @@ void Renderer::drawTiledTexture(Texture* texture,
 
         /////////////////////////////
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x, y+h2,
                  x+w1, y+h2,
                  x+w1, y+height,
@@ -328,7 +426,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  0.5f, 1.0f,
                  0.0f, 1.0f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x+w1, y+h2,
                  x+w2, y+h2,
                  x+w2, y+height,
@@ -338,7 +436,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  0.5f, 1.0f,
                  0.5f, 1.0f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x+w2, y+h2,
                  x+width, y+h2,
                  x+width, y+height,
@@ -350,7 +448,7 @@ void Renderer::drawTiledTexture(Texture* texture,
     }
     else if (horizontal)
     {
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x, y,
                  x+w1, y,
                  x+w1, y+height,
@@ -360,7 +458,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  0.5f, 1.0f,
                  0.0f, 1.0f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x+w1, y,
                  x+w2, y,
                  x+w2, y+height,
@@ -370,7 +468,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  0.5f, 1.0f,
                  0.5f, 1.0f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x+w2, y,
                  x+width, y,
                  x+width, y+height,
@@ -382,7 +480,7 @@ void Renderer::drawTiledTexture(Texture* texture,
     }
     else if (vertical)
     {
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x, y,
                  x+width, y,
                  x+width, y+h1,
@@ -392,7 +490,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  1.0f, 0.5f,
                  0.0f, 0.5f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x, y+h1,
                  x+width, y+h1,
                  x+width, y+h2,
@@ -402,7 +500,7 @@ void Renderer::drawTiledTexture(Texture* texture,
                  1.0f, 0.5f,
                  0.0f, 0.5f);
 
-        drawQuad(GL_TRIANGLE_FAN,
+        drawQuad(texture,
                  x, y+h2,
                  x+width, y+h2,
                  x+width, y+height,
@@ -412,8 +510,6 @@ void Renderer::drawTiledTexture(Texture* texture,
                  1.0f, 1.0f,
                  0.0f, 1.0f);
     }
-
-    texture->unbind();
 }
 
 
@@ -429,94 +525,69 @@ Font* Renderer::getFont()
 
 void Renderer::drawText(float x, float y, const char* text, int flags)
 {
-    float scaleX = 1.0f;
-    float scaleY = 1.0f;
-    float rotation = 0.0f;
-
-    TTF_Font* font = (TTF_Font*) currentFont->getInternal();
-    if (NULL == font)
+    if (NULL == currentFont)
     {
         return;
     }
 
-    SDL_Color Color = {0xff, 0xff, 0xff};
-
-    SDL_Surface* textSurface = TTF_RenderText_Blended(font, text, Color);
-    if (NULL == textSurface)
+    Texture* atlas = currentFont->getAtlas();
+    if (NULL == atlas)
     {
         return;
     }
 
-    GLuint textTexture = 0;
-    glGenTextures(1, &textTexture);
-    glBindTexture(GL_TEXTURE_2D, textTexture);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textSurface->w, textSurface->h, 0, GL_BGRA, GL_UNSIGNED_BYTE, textSurface->pixels);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    int textWidth = currentFont->getTextWidth(text);
 
-    float xPos = x;
     float translateX = 0.0f;
 
     if ((flags & ALIGN_CENTER) != 0)
     {
-        translateX -= scaleX * (float) (textSurface->w/2);
+        translateX -= (float) (textWidth/2);
     }
     else if ((flags & ALIGN_RIGHT) != 0)
     {
-        translateX -= scaleX * (float) (textSurface->w - 1);
+        translateX -= (float) (textWidth - 1);
     }
 
-    float yPos = y;
     float translateY = 0.0f;
 
     float fontHeight = currentFont->getHeight();
     if ((flags & ALIGN_MIDDLE) != 0)
     {
-        translateY -= scaleY * fontHeight/2.0f;
+        translateY -= fontHeight/2.0f;
     }
     else if ((flags & ALIGN_BOTTOM) != 0)
     {
-        translateY -= scaleY * fontHeight - 1.0f;
+        translateY -= fontHeight - 1.0f;
     }
 
-    float screenScaleX = 1.0f; // getWidth() / (float) getPixelWidth();
-    float screenScaleY = 1.0f; // getHeight() / (float) getPixelHeight();
-
-    float w = (float) (textSurface->w) * screenScaleX;
-    float h = (float) (textSurface->h) * screenScaleY;
-
-    w *= scaleX;
-    h *= scaleY;
-
-    glPushMatrix();
-        glTranslatef(xPos, yPos, 0.0f);
-        glRotatef(rotation, 0.0f, 0.0f, 1.0f);
-        glTranslatef(translateX, translateY, 0.0f);
-
-        /*
-        if ((flags & TEXTMODE_FILL) != 0 || (textMode & TEXTMODE_FILL) != 0)
-        {
-            fillRectangle(0.0f, 0.0f, w, h, gradientBackground);
-        }
-        */
+    float penX = x + translateX;
+    float top = y + translateY;
 
-        glBindTexture(GL_TEXTURE_2D, textTexture);
-        fillRectangle(0.0f, 0.0f, w, h);
-        glBindTexture(GL_TEXTURE_2D, 0);
+    for (const uint8* p = (const uint8*) text; 0 != *p; p++)
+    {
+        const FontGlyph& glyph = currentFont->getGlyph(*p);
 
-        /*
-        if ((flags & TEXTMODE_BORDER) != 0 || (textMode & TEXTMODE_BORDER) != 0)
+        if (glyph.width > 0)
         {
-            drawRectangle(0.0f, 0.0f, w, h, gradientForeground);
+            float x1 = penX;
+            float y1 = top;
+            float x2 = penX + (float) glyph.width;
+            float y2 = top + (float) glyph.height;
+
+            drawQuad(atlas,
+                     x1, y1,
+                     x2, y1,
+                     x2, y2,
+                     x1, y2,
+                     glyph.u1, glyph.v1,
+                     glyph.u2, glyph.v1,
+                     glyph.u2, glyph.v2,
+                     glyph.u1, glyph.v2);
         }
-        */
 
-    glPopMatrix();
-
-    glDeleteTextures(1, &textTexture);
-
-    SDL_FreeSurface(textSurface);
+        penX += (float) glyph.advance;
+    }
 }
 
 int Renderer::getWidth() const
@@ -531,12 +602,16 @@ int Renderer::getHeight() const
 
 void Renderer::enableClipping(int x, int y, int w, int h)
 {
+    flush();
+
     glEnable(GL_SCISSOR_TEST);
     glScissor(x, height-y-h, w, h);
 }
 
 void Renderer::disableClipping()
 {
+    flush();
+
     glDisable(GL_SCISSOR_TEST);
 }
 
@@ -8,6 +8,7 @@
 #define _RENDERER_H
 
 #include <string>
+#include <vector>
 
 class Texture;
 class Font;
@@ -30,15 +31,24 @@ class Renderer
         } PainterFlags;
 
     private:
-        static float quadCoords[8];
-        static float quadTexCoords[8];
-        static float quadColors[16];
+        typedef struct
+        {
+            Texture* texture;               // NULL for plain colored quads
+            float x1, y1, x2, y2;           // Bounding box of all quads
+            std::vector<float> coords;      // Two triangles per quad
+            std::vector<float> texCoords;
+            std::vector<float> colors;
+        } draw_batch_t;
 
     private:
         bool disposed;
         int width;
         int height;
         Font* currentFont;
+        float currentColor[4];
+
+        std::vector<draw_batch_t> batches;  // Kept across frames to reuse the arrays
+        int batchCount;
             
     private:
         static Renderer* __instance;
@@ -65,11 +75,13 @@ class Renderer
         void drawText(float x, float y, const char* text, int flags=0);
 
     public:
-        static void drawTexture(Texture* texture, float x, float y, float width=-1.0f, float height=-1.0f);
-        static void drawTiledTexture(Texture* texture, float x, float y, float width, float height, bool horizontal=true, bool vertical=true);
-        static void fillRectangle(float x, float y, float width, float height);
-        static void draw(int mode, int count, float* coords, float* colors, float* texCoords);
-        static void drawQuad(int mode,
+        // Quads are collected in batches per texture and drawn at
+        // endDraw() or when the clipping changes
+        void setColor(float r, float g, float b, float a);
+        void drawTexture(Texture* texture, float x, float y, float width=-1.0f, float height=-1.0f);
+        void drawTiledTexture(Texture* texture, float x, float y, float width, float height, bool horizontal=true, bool vertical=true);
+        void fillRectangle(float x, float y, float width, float height);
+        void drawQuad(Texture* texture,
                       float x1, float y1,
                       float x2, float y2,
                       float x3, float y3,
@@ -78,6 +90,9 @@ class Renderer
                       float u2, float v2,
                       float u3, float v3,
                       float u4, float v4);
+        void flush();
+
+        static void draw(int mode, int count, float* coords, float* colors, float* texCoords);
 
         void enableClipping(int x, int y, int w, int h);
         void disableClipping();
@@ -13,6 +13,9 @@
 #define RES_ICON_CLOSE          "resources/icon_close.png"
 #define RES_STICK               "resources/stick.png"
 
+class Texture;
+class Font;
+
 typedef struct
 {
     bool initialized;
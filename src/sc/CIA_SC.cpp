@@ -53,9 +53,9 @@ enum {
  *  Constructors
  */
 
-MOS6526::MOS6526(MOS6510 *CPU) : the_cpu(CPU) {}
-MOS6526_1::MOS6526_1(MOS6510 *CPU, MOS6569 *VIC) : MOS6526(CPU), the_vic(VIC) {}
-MOS6526_2::MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541) : MOS6526(CPU), the_vic(VIC), the_cpu_1541(CPU1541) {}
+MOS6526::MOS6526(MOS6510 *CPU, Prefs *prefs) : the_cpu(CPU), the_prefs(prefs), clock(NULL) {}
+MOS6526_1::MOS6526_1(MOS6510 *CPU, MOS6569 *VIC, Prefs *prefs) : MOS6526(CPU, prefs), the_vic(VIC) {}
+MOS6526_2::MOS6526_2(MOS6510 *CPU, MOS6569 *VIC, MOS6502_1541 *CPU1541, Prefs *prefs) : MOS6526(CPU, prefs), the_vic(VIC), the_cpu_1541(CPU1541) {}
 
 
 /*
@@ -81,6 +81,9 @@ void MOS6526::Reset(void)
 
 	ta_irq_next_cycle = tb_irq_next_cycle = false;
 	ta_state = tb_state = T_STOP;
+
+	asleep = false;
+	next_event = *clock;
 }
 
 void MOS6526_1::Reset(void)
@@ -182,6 +185,9 @@ void MOS6526::SetState(MOS6526State *cs)
 
 	ta_state = (cra & 1) ? T_COUNT : T_STOP;
 	tb_state = (crb & 1) ? T_COUNT : T_STOP;
+
+	asleep = false;
+	next_event = *clock;
 }
 
 
@@ -191,6 +197,9 @@ void MOS6526::SetState(MOS6526State *cs)
 
 uint8 MOS6526_1::ReadRegister(uint16 adr)
 {
+	if (adr >= 0x04 && adr <= 0x07)
+		sync();
+
 	switch (adr) {
 		case 0x00: {
 			uint8 ret = pra | ~ddra, tst = (prb | ~ddrb) & Joystick1;
@@ -246,6 +255,9 @@ uint8 MOS6526_1::ReadRegister(uint16 adr)
 
 uint8 MOS6526_2::ReadRegister(uint16 adr)
 {
+	if (adr >= 0x04 && adr <= 0x07)
+		sync();
+
 	switch (adr) {
 		case 0x00:
 			return (pra | ~ddra) & 0x3f
@@ -289,6 +301,9 @@ inline void MOS6526_1::check_lp(void)
 
 void MOS6526_1::WriteRegister(uint16 adr, uint8 byte)
 {
+	if (adr >= 0x04 && adr <= 0x07 || adr >= 0x0e)
+		sync();
+
 	switch (adr) {
 		case 0x0: pra = byte; break;
 		case 0x1:
@@ -378,6 +393,9 @@ void MOS6526_1::WriteRegister(uint16 adr, uint8 byte)
 
 void MOS6526_2::WriteRegister(uint16 adr, uint8 byte)
 {
+	if (adr >= 0x04 && adr <= 0x07 || adr >= 0x0e)
+		sync();
+
 	switch (adr) {
 		case 0x0:{
 			pra = byte;
@@ -667,6 +685,67 @@ tb_idle:
 }
 
 
+/*
+ *  Event scheduling: while no timer is about to underflow and no
+ *  delayed write or interrupt is pending, EmulateCycle() only counts
+ *  the timers down. The CIA then sleeps until the cycle of the next
+ *  underflow and applies the countdown when it wakes up.
+ */
+
+void MOS6526::SetClock(const uint32 *cycle_counter)
+{
+	clock = cycle_counter;
+}
+
+void MOS6526::EmulateEvent(uint32 cycle)
+{
+	Wake(cycle);
+	EmulateCycle();
+	schedule(cycle + 1);
+}
+
+// Apply the countdown of the cycles before the given one
+void MOS6526::Wake(uint32 cycle)
+{
+	if (asleep) {
+		uint16 n = cycle - sleep_cycle;
+		if (ta_state == T_COUNT && ta_cnt_phi2)
+			ta -= n;
+		if (tb_state == T_COUNT && tb_cnt_phi2)
+			tb -= n;
+		asleep = false;
+	}
+	next_event = cycle;
+}
+
+// Find out how long the CIA may sleep, starting with the given cycle
+void MOS6526::schedule(uint32 cycle)
+{
+	next_event = cycle;
+	if (ta_irq_next_cycle || tb_irq_next_cycle || has_new_cra || has_new_crb)
+		return;
+
+	uint32 n = 0x10000;
+	if (ta_state == T_COUNT) {
+		if (ta_cnt_phi2 && ta < n)
+			n = ta;
+	} else if (ta_state != T_STOP)
+		return;
+	if (tb_state == T_COUNT) {
+		if (tb_cnt_phi2 && tb < n)
+			n = tb;
+	} else if (tb_state != T_STOP)
+		return;
+
+	// Timer reaching zero underflows in the next EmulateCycle()
+	if (n > 1) {
+		asleep = true;
+		sleep_cycle = cycle;
+		next_event = cycle + n - 1;
+	}
+}
+
+
 /*
  *  Count CIA TOD clock (called during VBlank)
  */
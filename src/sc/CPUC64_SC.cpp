@@ -34,6 +34,11 @@
  *  - All memory accesses are done with the read_byte() and
  *    write_byte() functions which also do the memory address
  *    decoding.
+ *  - Address decoding uses two tables with a pointer per
+ *    page for reads and writes, rebuilt by map_pages() when
+ *    the memory configuration changes. A NULL pointer sends
+ *    the access to read_byte_io()/write_byte_io() (I/O space,
+ *    the processor port and the REU trigger at $ff00).
  *  - If a write occurs to addresses 0 or 1, new_config is
  *    called to check whether the memory configuration has
  *    changed
@@ -90,6 +95,14 @@ MOS6510::MOS6510(C64 *c64, uint8 *Ram, uint8 *Basic, uint8 *Kernal, uint8 *Char,
 	dfff_byte = 0x55;
 	BALow = false;
 	first_irq_cycle = first_nmi_cycle = 0;
+
+	// Pages that don't depend on the memory configuration
+	for (int page=0; page<0x100; page++)
+		read_page[page] = write_page[page] = ram + (page << 8);
+	read_page[0x00] = write_page[0x00] = NULL;	// Processor port
+	write_page[0xff] = NULL;					// REU trigger at $ff00
+	basic_in = kernal_in = char_in = io_in = false;
+	map_pages();
 }
 
 
@@ -189,11 +202,40 @@ void MOS6510::SetState(MOS6510State *s)
 void MOS6510::new_config(void)
 {
 	uint8 port = ~ddr | pr;
+	bool bi = basic_in, ki = kernal_in, ci = char_in, ii = io_in;
 
 	basic_in = (port & 3) == 3;
 	kernal_in = port & 2;
 	char_in = (port & 3) && !(port & 4);
 	io_in = (port & 3) && (port & 4);
+
+	if (bi != basic_in || ki != kernal_in || ci != char_in || ii != io_in)
+		map_pages();
+}
+
+
+/*
+ *  Set page table entries for $a000-$ffff from memory configuration
+ */
+
+void MOS6510::map_pages(void)
+{
+	int page;
+
+	for (page=0xa0; page<0xc0; page++)
+		read_page[page] = basic_in ? basic_rom + ((page - 0xa0) << 8) : ram + (page << 8);
+
+	for (page=0xd0; page<0xe0; page++) {
+		if (io_in)
+			read_page[page] = write_page[page] = NULL;
+		else {
+			read_page[page] = char_in ? char_rom + ((page - 0xd0) << 8) : ram + (page << 8);
+			write_page[page] = ram + (page << 8);
+		}
+	}
+
+	for (page=0xe0; page<0x100; page++)
+		read_page[page] = kernal_in ? kernal_rom + ((page - 0xe0) << 8) : ram + (page << 8);
 }
 
 
@@ -204,6 +246,13 @@ void MOS6510::new_config(void)
 inline uint8 MOS6510::read_byte_io(uint16 adr)
 {
 	switch (adr >> 12) {
+		case 0x0:	// Processor port
+			if (adr >= 2)
+				return ram[adr];
+			else if (adr == 0)
+				return ddr;
+			else
+				return (ddr & pr) | (~ddr & 0x17);
 		case 0xa:
 		case 0xb:
 			if (basic_in)
@@ -268,14 +317,11 @@ inline
 #endif
 uint8 MOS6510::read_byte(uint16 adr)
 {
-	if (adr < 0xa000) {
-		if (adr >= 2)
-			return ram[adr];
-		else if (adr == 0)
-			return ddr;
-		else
-			return (ddr & pr) | (~ddr & 0x17);
-	} else
+	uint8 *p = read_page[adr >> 8];
+
+	if (p)
+		return p[adr & 0xff];
+	else
 		return read_byte_io(adr);
 }
 
@@ -320,7 +366,19 @@ inline uint16 MOS6510::read_word(uint16 adr)
 
 inline void MOS6510::write_byte_io(uint16 adr, uint8 byte)
 {
-	if (adr >= 0xe000) {
+	if (adr < 0xd000) {
+		if (adr >= 2)
+			ram[adr] = byte;
+		else if (adr == 0) {
+			ddr = byte;
+			ram[0] = TheVIC->LastVICByte;
+			new_config();
+		} else {
+			pr = byte;
+			ram[1] = TheVIC->LastVICByte;
+			new_config();
+		}
+	} else if (adr >= 0xe000) {
 		ram[adr] = byte;
 		if (adr == 0xff00)
 			TheREU->FF00Trigger();
@@ -367,19 +425,11 @@ inline void MOS6510::write_byte_io(uint16 adr, uint8 byte)
 
 void MOS6510::write_byte(uint16 adr, uint8 byte)
 {
-	if (adr < 0xd000) {
-		if (adr >= 2)
-			ram[adr] = byte;
-		else if (adr == 0) {
-			ddr = byte;
-			ram[0] = TheVIC->LastVICByte;
-			new_config();
-		} else {
-			pr = byte;
-			ram[1] = TheVIC->LastVICByte;
-			new_config();
-		}
-	} else
+	uint8 *p = write_page[adr >> 8];
+
+	if (p)
+		p[adr & 0xff] = byte;
+	else
 		write_byte_io(adr, byte);
 }
 
@@ -398,12 +448,14 @@ uint8 MOS6510::ExtReadByte(uint16 adr)
 	kernal_in = ExtConfig & 2;
 	char_in = (ExtConfig & 3) && ~(ExtConfig & 4);
 	io_in = (ExtConfig & 3) && (ExtConfig & 4);
+	map_pages();
 
 	// Read byte
 	uint8 byte = read_byte(adr);
 
 	// Restore old configuration
 	basic_in = bi; kernal_in = ki; char_in = ci; io_in = ii;
+	map_pages();
 
 	return byte;
 }
@@ -423,12 +475,14 @@ void MOS6510::ExtWriteByte(uint16 adr, uint8 byte)
 	kernal_in = ExtConfig & 2;
 	char_in = (ExtConfig & 3) && ~(ExtConfig & 4);
 	io_in = (ExtConfig & 3) && (ExtConfig & 4);
+	map_pages();
 
 	// Write byte
 	write_byte(adr, byte);
 
 	// Restore old configuration
 	basic_in = bi; kernal_in = ki; char_in = ci; io_in = ii;
+	map_pages();
 }
 
 
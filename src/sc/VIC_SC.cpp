@@ -1269,7 +1269,7 @@ inline void MOS6569::draw_sprites(void)
 		}
 	}
 
-	if (ThePrefs.SpriteCollisions) {
+	if (the_c64->ThePrefs.SpriteCollisions) {
 
 		// Check sprite-sprite collisions
 		if (clx_spr)
@@ -1547,12 +1547,15 @@ bool MOS6569::EmulateCycle(void)
 				ref_cnt = 0xff;
 				lp_triggered = vblanking = false;
 
+				// The time of the frame just finished goes into the cost average
+				// of its kind, and only a drawn frame is shown
+				bool drawn = !frame_skipped;
 				if (!(frame_skipped = --skip_counter))
                 {
-					skip_counter = ThePrefs.SkipFrames;
+					skip_counter = the_c64->getSkipFrames();
                 }
 
-				the_c64->VBlank(!frame_skipped);
+				the_c64->VBlank(drawn);
 
 				// Get bitmap pointer for next frame. This must be done
 				// after calling the_c64->VBlank() because the preferences
@@ -1896,7 +1899,7 @@ bool MOS6569::EmulateCycle(void)
 			if (draw_this_line) {
 
 				// Draw sprites
-				if (spr_draw && ThePrefs.SpritesOn)
+				if (spr_draw && the_c64->ThePrefs.SpritesOn)
 					draw_sprites();
 
 				// Draw border
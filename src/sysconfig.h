@@ -4,7 +4,11 @@
  *  Frodo (C) 1994-1997,2002 Christian Bauer
  */
 
+#ifdef HEADLESS
+#define USE_OPENGL 0	// No display, renderer, textures or fonts
+#else
 #define USE_OPENGL 1
+#endif
 
 #if defined(WIN32)
     #include "./sysconfig_WIN32.h"
@@ -11,7 +11,9 @@ extern "C"
 {
 #include <SDL.h>
 #include <SDL_thread.h>
+#ifndef HEADLESS
 #include <SDL_ttf.h>
+#endif
 #include <SDL_audio.h>
 #include <time.h>
 
@@ -40,8 +42,10 @@ extern "C"
     #pragma comment(lib, "winmm.lib")
     #pragma comment(lib, "SDLmain.lib")
     #pragma comment(lib, "SDL.lib")
-    #pragma comment(lib, "SDL_image.lib")
-    #pragma comment(lib, "SDL_ttf.lib")
+    #ifndef HEADLESS
+        #pragma comment(lib, "SDL_image.lib")
+        #pragma comment(lib, "SDL_ttf.lib")
+    #endif
     #if USE_OPENGL
         #pragma comment(lib, "opengl32.lib")
     #endif
@@ -216,5 +220,81 @@ typedef long int32;
 #error No 4 byte type, you lose.
 #endif
 
+#ifdef _MSC_VER
+typedef unsigned __int64 uint64;
+typedef __int64 int64;
+#else
+typedef unsigned long long uint64;
+typedef long long int64;
+#endif
+
 #define UNUSED(x) (x = x)
 }
+
+
+/*
+ *  High resolution monotonic host clock in nanoseconds
+ */
+
+inline uint64 host_time_ns(void)
+{
+#ifdef WIN32
+	static LARGE_INTEGER freq = {0};
+	LARGE_INTEGER now;
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (uint64)((double)now.QuadPart * 1.0e9 / (double)freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000000000ULL + (uint64)ts.tv_nsec;
+#endif
+}
+
+
+/*
+ *  Atomic operations for data that is handed between threads without
+ *  locks. Swap and add are full barriers, loads have acquire and
+ *  stores release semantics.
+ */
+
+inline uint32 atomic_swap32(volatile uint32 *p, uint32 v)
+{
+#ifdef WIN32
+	return (uint32)InterlockedExchange((volatile LONG *)p, (LONG)v);
+#else
+	__sync_synchronize();
+	return __sync_lock_test_and_set(p, v);
+#endif
+}
+
+inline uint32 atomic_add32(volatile uint32 *p, uint32 v)
+{
+#ifdef WIN32
+	return (uint32)InterlockedExchangeAdd((volatile LONG *)p, (LONG)v) + v;
+#else
+	return __sync_add_and_fetch(p, v);
+#endif
+}
+
+inline uint32 atomic_load32(const volatile uint32 *p)
+{
+	uint32 v = *p;
+#ifdef WIN32
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+	return v;
+}
+
+inline void atomic_store32(volatile uint32 *p, uint32 v)
+{
+#ifdef WIN32
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+	*p = v;
+}
@@ -34,6 +34,218 @@ static void checkGlErrorImpl(const char* file, int line)
 #define GL_GENERATE_MIPMAP_HINT 0x8192
 #endif
 
+#ifndef HAVE_GLES
+
+/*
+ *  Indexed textures hold the 8 bit frame buffer as is, a fragment
+ *  shader looks up the colors in a palette texture. The GL 2.0 entry
+ *  points are fetched at runtime, without them the frame buffer is
+ *  converted to RGBA on the CPU as before.
+ */
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+
+#ifndef GL_TEXTURE1
+#define GL_TEXTURE1 0x84C1
+#endif
+
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#endif
+
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER 0x8B31
+#endif
+
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+
+typedef struct
+{
+    bool loaded;                    // Tried to set up the shader
+    GLuint program;                 // 0 if not available
+
+    GLint indexTexture;             // Uniform locations
+    GLint paletteTexture;
+    GLint textureSize;
+    GLint paletteSize;
+    GLint filtering;
+
+    void   (APIENTRY *activeTexture)(GLenum);
+    GLuint (APIENTRY *createShader)(GLenum);
+    void   (APIENTRY *shaderSource)(GLuint, GLsizei, const char**, const GLint*);
+    void   (APIENTRY *compileShader)(GLuint);
+    void   (APIENTRY *getShaderiv)(GLuint, GLenum, GLint*);
+    void   (APIENTRY *getShaderInfoLog)(GLuint, GLsizei, GLsizei*, char*);
+    void   (APIENTRY *deleteShader)(GLuint);
+    GLuint (APIENTRY *createProgram)(void);
+    void   (APIENTRY *attachShader)(GLuint, GLuint);
+    void   (APIENTRY *linkProgram)(GLuint);
+    void   (APIENTRY *getProgramiv)(GLuint, GLenum, GLint*);
+    void   (APIENTRY *deleteProgram)(GLuint);
+    void   (APIENTRY *useProgram)(GLuint);
+    GLint  (APIENTRY *getUniformLocation)(GLuint, const char*);
+    void   (APIENTRY *uniform1i)(GLint, GLint);
+    void   (APIENTRY *uniform1f)(GLint, GLfloat);
+    void   (APIENTRY *uniform2f)(GLint, GLfloat, GLfloat);
+} palette_shader_t;
+
+static palette_shader_t paletteShader;
+
+static const char* paletteVertexSource =
+    "void main()\n"
+    "{\n"
+    "    gl_Position = ftransform();\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "}\n";
+
+// Values in the frame buffer are used modulo the palette size, like
+// the CPU conversion does. Filtering blends the looked up colors of
+// the four nearest texels.
+static const char* paletteFragmentSource =
+    "uniform sampler2D indexTexture;\n"
+    "uniform sampler2D paletteTexture;\n"
+    "uniform vec2 textureSize;\n"
+    "uniform float paletteSize;\n"
+    "uniform float filtering;\n"
+    "\n"
+    "vec4 lookup(vec2 texel)\n"
+    "{\n"
+    "    texel = clamp(texel, vec2(0.0), textureSize - 1.0);\n"
+    "    float i = floor(texture2D(indexTexture, (texel + 0.5) / textureSize).r * 255.0 + 0.5);\n"
+    "    return texture2D(paletteTexture, vec2((mod(i, paletteSize) + 0.5) / paletteSize, 0.5));\n"
+    "}\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 pos = gl_TexCoord[0].st * textureSize;\n"
+    "    vec4 color;\n"
+    "    if (filtering > 0.5)\n"
+    "    {\n"
+    "        pos -= 0.5;\n"
+    "        vec2 texel = floor(pos);\n"
+    "        vec2 f = pos - texel;\n"
+    "        color = mix(mix(lookup(texel), lookup(texel + vec2(1.0, 0.0)), f.x),\n"
+    "                    mix(lookup(texel + vec2(0.0, 1.0)), lookup(texel + vec2(1.0, 1.0)), f.x), f.y);\n"
+    "    }\n"
+    "    else\n"
+    "    {\n"
+    "        color = lookup(floor(pos));\n"
+    "    }\n"
+    "    gl_FragColor = color * gl_Color;\n"
+    "}\n";
+
+static GLuint compilePaletteShader(GLenum type, const char* source)
+{
+    palette_shader_t& s = paletteShader;
+
+    GLuint shader = s.createShader(type);
+    s.shaderSource(shader, 1, &source, NULL);
+    s.compileShader(shader);
+
+    GLint status = 0;
+    s.getShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status)
+    {
+        char log[512];
+        log[0] = 0;
+        s.getShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "Can't compile palette shader: %s\n", log);
+        s.deleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+static bool initPaletteShader()
+{
+    palette_shader_t& s = paletteShader;
+
+    if (s.loaded)
+    {
+        return (0 != s.program);
+    }
+
+    s.loaded = true;
+    s.program = 0;
+
+    #define LOAD_GL_PROC(member, name) \
+        *(void**) &s.member = SDL_GL_GetProcAddress(name); \
+        if (NULL == s.member) return false
+
+    LOAD_GL_PROC(activeTexture,         "glActiveTexture");
+    LOAD_GL_PROC(createShader,          "glCreateShader");
+    LOAD_GL_PROC(shaderSource,          "glShaderSource");
+    LOAD_GL_PROC(compileShader,         "glCompileShader");
+    LOAD_GL_PROC(getShaderiv,           "glGetShaderiv");
+    LOAD_GL_PROC(getShaderInfoLog,      "glGetShaderInfoLog");
+    LOAD_GL_PROC(deleteShader,          "glDeleteShader");
+    LOAD_GL_PROC(createProgram,         "glCreateProgram");
+    LOAD_GL_PROC(attachShader,          "glAttachShader");
+    LOAD_GL_PROC(linkProgram,           "glLinkProgram");
+    LOAD_GL_PROC(getProgramiv,          "glGetProgramiv");
+    LOAD_GL_PROC(deleteProgram,         "glDeleteProgram");
+    LOAD_GL_PROC(useProgram,            "glUseProgram");
+    LOAD_GL_PROC(getUniformLocation,    "glGetUniformLocation");
+    LOAD_GL_PROC(uniform1i,             "glUniform1i");
+    LOAD_GL_PROC(uniform1f,             "glUniform1f");
+    LOAD_GL_PROC(uniform2f,             "glUniform2f");
+
+    #undef LOAD_GL_PROC
+
+    GLuint vertexShader = compilePaletteShader(GL_VERTEX_SHADER, paletteVertexSource);
+    GLuint fragmentShader = compilePaletteShader(GL_FRAGMENT_SHADER, paletteFragmentSource);
+    if (0 == vertexShader || 0 == fragmentShader)
+    {
+        if (0 != vertexShader) s.deleteShader(vertexShader);
+        if (0 != fragmentShader) s.deleteShader(fragmentShader);
+        return false;
+    }
+
+    GLuint program = s.createProgram();
+    s.attachShader(program, vertexShader);
+    s.attachShader(program, fragmentShader);
+    s.linkProgram(program);
+
+    // The program keeps the shaders until it is deleted
+    s.deleteShader(vertexShader);
+    s.deleteShader(fragmentShader);
+
+    GLint status = 0;
+    s.getProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status)
+    {
+        fprintf(stderr, "Can't link palette shader\n");
+        s.deleteProgram(program);
+        return false;
+    }
+
+    s.indexTexture   = s.getUniformLocation(program, "indexTexture");
+    s.paletteTexture = s.getUniformLocation(program, "paletteTexture");
+    s.textureSize    = s.getUniformLocation(program, "textureSize");
+    s.paletteSize    = s.getUniformLocation(program, "paletteSize");
+    s.filtering      = s.getUniformLocation(program, "filtering");
+
+    s.program = program;
+
+    return true;
+}
+
+#endif /* HAVE_GLES */
+
 Texture::Texture()
 {
     init();
@@ -69,6 +281,9 @@ void Texture::init()
     paletteSize = 0;
     paletteRed = paletteGreen = paletteBlue = NULL;
 
+    paletteTextureId = 0;
+    indexedColors = 0;
+
     filtering = false;
 }
 
@@ -176,6 +391,58 @@ bool Texture::create(int width, int height, int bitsPerPixel, const void* pixels
 
 }
 
+/*
+ *  8 bit texture whose values are looked up in the palette by a
+ *  shader. Fails if shaders are not available.
+ */
+
+bool Texture::createIndexed(int width, int height, const uint32* palette, int paletteSize)
+{
+    #ifdef HAVE_GLES
+        return false;
+    #else
+        if (!initPaletteShader())
+        {
+            return false;
+        }
+
+        this->width = width;
+        this->height = height;
+        this->bitsPerPixel = 8;
+        this->pitch = width;
+        this->size = height * pitch;
+
+        internalFormat = GL_LUMINANCE;
+        format = GL_LUMINANCE;
+
+        clearGlError();
+
+        textureId = 0;
+        glGenTextures(1, &textureId);
+        glBindTexture(GL_TEXTURE_2D, textureId);
+        glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
+
+        // RGBA palette as a one row texture
+        paletteTextureId = 0;
+        glGenTextures(1, &paletteTextureId);
+        glBindTexture(GL_TEXTURE_2D, paletteTextureId);
+        glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, paletteSize, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, palette);
+        checkGlError();
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        indexedColors = paletteSize;
+
+        // Rows of one byte per pixel are not padded
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        return true;
+    #endif
+}
+
 void Texture::free()
 {
     if (0 != textureId)
@@ -184,6 +451,14 @@ void Texture::free()
         textureId = 0;
     }
 
+    if (0 != paletteTextureId)
+    {
+        glDeleteTextures(1, &paletteTextureId);
+        paletteTextureId = 0;
+    }
+
+    indexedColors = 0;
+
     if (NULL != buffer)
     {
         delete [] buffer;
@@ -212,10 +487,37 @@ int Texture::getBitsPerPixel() const
     return bitsPerPixel;
 }
 
+bool Texture::isIndexed() const
+{
+    return (0 != paletteTextureId);
+}
+
 void Texture::bind()
 {
     glBindTexture(GL_TEXTURE_2D, textureId);
 
+    #ifndef HAVE_GLES
+        if (isIndexed())
+        {
+            // Filtering is done in the shader, after the lookup
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+            palette_shader_t& s = paletteShader;
+            s.activeTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, paletteTextureId);
+            s.activeTexture(GL_TEXTURE0);
+
+            s.useProgram(s.program);
+            s.uniform1i(s.indexTexture, 0);
+            s.uniform1i(s.paletteTexture, 1);
+            s.uniform2f(s.textureSize, (float) width, (float) height);
+            s.uniform1f(s.paletteSize, (float) indexedColors);
+            s.uniform1f(s.filtering, filtering ? 1.0f : 0.0f);
+            return;
+        }
+    #endif
+
     if (filtering)
     {
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -233,6 +535,17 @@ void Texture::bind()
 
 void Texture::unbind()
 {
+    #ifndef HAVE_GLES
+        if (isIndexed())
+        {
+            palette_shader_t& s = paletteShader;
+            s.useProgram(0);
+            s.activeTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            s.activeTexture(GL_TEXTURE0);
+        }
+    #endif
+
     glBindTexture(GL_TEXTURE_2D, 0);
 
     disablePalette();
@@ -298,7 +611,7 @@ void Texture::freePalette()
 
 }
 
-void Texture::updateData(const void* pixels, int bitsPerPixel, uint32* palette)
+void Texture::updateData(const void* pixels, int bitsPerPixel, const uint32* palette, const uint8* dirtyRows)
 {
     clearGlError();
 
@@ -331,6 +644,13 @@ void Texture::updateData(const void* pixels, int bitsPerPixel, uint32* palette)
 
         for (int y=0; y<height; y++)
         {
+            if (valid && NULL != dirtyRows && !dirtyRows[y])
+            {
+                srcLine  += src_pitch;
+                destLine += texture_pitch;
+                continue;
+            }
+
             uint8*  src  = srcLine;
             uint32* dest = (uint32*) destLine;
 
@@ -362,6 +682,10 @@ void Texture::updateData(const void* pixels, int bitsPerPixel, uint32* palette)
         checkGlError();
         valid = true;
     }
+    else if (NULL != dirtyRows)
+    {
+        storeDirtyRows(texture_data, dirtyRows);
+    }
     else
     {
         glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
@@ -376,10 +700,16 @@ bool Texture::hasPalette() const
     return (paletteSize > 0);
 }
 
-void Texture::updateData(const void* pixels)
+void Texture::updateData(const void* pixels, const uint8* dirtyRows)
 {
     if (0 == textureId || NULL == pixels) return;
 
+    if (valid && NULL != dirtyRows && !hasPalette())
+    {
+        storeDirtyRows(pixels, dirtyRows);
+        return;
+    }
+
     enablePalette();
 
     storePixelData(pixels);
@@ -387,6 +717,35 @@ void Texture::updateData(const void* pixels)
     disablePalette();
 }
 
+/*
+ *  Upload each run of rows with dirtyRows[y] set as one sub-image
+ */
+
+void Texture::storeDirtyRows(const void* pixels, const uint8* dirtyRows)
+{
+    clearGlError();
+
+    int y = 0;
+    while (y < height)
+    {
+        if (!dirtyRows[y])
+        {
+            y++;
+            continue;
+        }
+
+        int first = y;
+        while (y < height && dirtyRows[y])
+        {
+            y++;
+        }
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, width, y-first, format, GL_UNSIGNED_BYTE,
+                        (const uint8*) pixels + first*pitch);
+        checkGlError();
+    }
+}
+
 void Texture::storePixelData(const void* pixels)
 {
     clearGlError();
@@ -35,6 +35,9 @@ class Texture
         float* paletteGreen;
         float* paletteBlue;
 
+        GLuint paletteTextureId;    // Palette of an indexed texture, looked up by a shader
+        int indexedColors;
+
 
     public:
         Texture();
@@ -45,10 +48,11 @@ class Texture
     public:
         bool load(const char* name);
         bool create(int width, int height, int bitsPerPixel, const void* pixels=NULL, SDL_Color* palette=NULL, int paletteSize=0);
+        bool createIndexed(int width, int height, const uint32* palette, int paletteSize);
         void free();
         void* getBuffer();
-        void updateData(const void* pixels);
-        void updateData(const void* pixels, int bitsPerPixel, uint32* palette);
+        void updateData(const void* pixels, const uint8* dirtyRows=NULL);
+        void updateData(const void* pixels, int bitsPerPixel, const uint32* palette, const uint8* dirtyRows=NULL);
         void setAntialias(bool enabled=true);
         bool isAntialiased() const;
 
@@ -56,6 +60,7 @@ class Texture
         int getWidth() const;
         int getHeight() const;
         int getBitsPerPixel() const;
+        bool isIndexed() const;
 
     public:
         void bind();
@@ -64,6 +69,7 @@ class Texture
     private:
         void init();
         void storePixelData(const void* pixels);
+        void storeDirtyRows(const void* pixels, const uint8* dirtyRows);
         bool hasPalette() const;
         void enablePalette();
         void disablePalette();
@@ -7,9 +7,11 @@
 #include "sysdeps.h"
 
 #include "main.h"
+#if USE_OPENGL
 #include "renderer.h"
 #include "texture.h"
 #include "font.h"
+#endif
 #include "resources.h"
 #include "Display.h"
 #include "Input.h"
@@ -83,6 +85,7 @@ void VirtualJoystick::layout(int x, int y, int w, int h)
     rectDeadZone.h = deadZoneHeight;
 }
 
+#if USE_OPENGL
 void VirtualJoystick::draw(Renderer* renderer, resource_list_t* res)
 {
     if (MODE_MOUSE != mode)
@@ -111,10 +114,11 @@ void VirtualJoystick::draw(Renderer* renderer, resource_list_t* res)
     else alpha = 0.2f - (float) (elapsedTicks-4000) / 5000.0f;                              // 0,2..0
     if (alpha < 0.0f) alpha = 0.0f;
 
-    glColor4f(1.0f, 1.0f, 1.0f, alpha);
+    renderer->setColor(1.0f, 1.0f, 1.0f, alpha);
     renderer->drawTexture(res->stickTexture, x, y);
-    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    renderer->setColor(1.0f, 1.0f, 1.0f, 1.0f);
 }
+#endif
 
 uint8 VirtualJoystick::getState()
 {
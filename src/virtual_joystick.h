@@ -53,7 +53,9 @@ class VirtualJoystick : public InputHandler
         void create();
         void show(bool doShow);
         bool isShown();
+    #if USE_OPENGL
         void draw(Renderer* renderer, resource_list_t* res);
+    #endif
         //int updateState(int buttons, int x, int y);
         void keyInput(int key);
 